@@ -0,0 +1,179 @@
+// Compile throughput of libapx on a generated (or given) APX program, one
+// number per phase, printed as JSON so runs can be diffed:
+//
+//   lexer    tokens/s  Lexer::NextToken until Eof
+//   parser   nodes/s   Parser::ParseProgram, which lexes as it goes
+//   codegen  bytes/s   Sema + CodeGenerator::Generate (NASM text)
+//   object   bytes/s   Sema + CodeGenerator::Lower + x86::Encode + elf::WriteObject
+//
+//   apx_bench [--seed n] [--functions n] [--depth n] [--iterations n]
+//             [--emit out.apx] [file.apx]
+//
+// Each phase runs --iterations times on fresh state and reports the fastest.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "CodeGenerator.h"
+#include "CorpusGenerator.h"
+#include "ElfWriter.h"
+#include "ErrorReporter.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Sema.h"
+#include "SourceFile.h"
+#include "X86Encoder.h"
+
+namespace {
+    struct Measurement {
+        const char* name;
+        const char* unit;
+        size_t amount = 0;
+        double seconds = 0;
+    };
+
+    // Fastest of iterations runs of body, which returns the amount processed
+    template<typename Body>
+    Measurement Measure(const char* name, const char* unit, const long iterations, Body&& body) {
+        Measurement measurement{name, unit};
+        for (long i = 0; i < iterations; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            measurement.amount = body();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (i == 0 || elapsed.count() < measurement.seconds) {
+                measurement.seconds = elapsed.count();
+            }
+        }
+        return measurement;
+    }
+
+    std::unique_ptr<Program> ParseOrThrow(const std::string_view source, StringInterner& interner, size_t* nodes) {
+        Lexer lexer(source, interner);
+        ErrorReporter errorReporter;
+        Parser parser(lexer, errorReporter);
+        auto program = parser.ParseProgram();
+        if (errorReporter.HasErrors()) {
+            throw std::runtime_error("Parse error: " + errorReporter.GetErrors().front().message);
+        }
+        if (nodes) {
+            *nodes = 0;
+            for (const size_t count : parser.GetNodeCounts()) {
+                *nodes += count;
+            }
+        }
+        return program;
+    }
+
+    bool ParseCount(const char* text, long& value) {
+        char* end = nullptr;
+        value = std::strtol(text, &end, 10);
+        return *text && *end == 0 && value > 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    CorpusOptions corpus;
+    corpus.functions = 1000;
+    long iterations = 5;
+    std::string inputFile;
+    std::string emitFile;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        long value = 0;
+        if (std::strcmp(arg, "--seed") == 0 && hasValue) {
+            corpus.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(arg, "--functions") == 0 && hasValue && ParseCount(argv[++i], value)) {
+            corpus.functions = static_cast<size_t>(value);
+        } else if (std::strcmp(arg, "--depth") == 0 && hasValue && ParseCount(argv[++i], value)) {
+            corpus.expressionDepth = static_cast<int>(value);
+        } else if (std::strcmp(arg, "--iterations") == 0 && hasValue && ParseCount(argv[++i], value)) {
+            iterations = value;
+        } else if (std::strcmp(arg, "--emit") == 0 && hasValue) {
+            emitFile = argv[++i];
+        } else if (arg[0] != '-' && inputFile.empty()) {
+            inputFile = arg;
+        } else {
+            fmt::print(stderr, "Invalid argument: {}\n", arg);
+            return 1;
+        }
+    }
+
+    std::string source;
+    if (inputFile.empty()) {
+        source = GenerateCorpus(corpus);
+    } else {
+        SourceFile file;
+        if (!file.Open(inputFile)) {
+            fmt::print(stderr, "Could not open input file: {}\n", inputFile);
+            return 1;
+        }
+        source = std::string(file.GetContents());
+    }
+    if (!emitFile.empty()) {
+        std::ofstream out(emitFile, std::ios::binary);
+        out << source;
+        if (!out) {
+            fmt::print(stderr, "Could not write {}\n", emitFile);
+            return 1;
+        }
+    }
+
+    std::vector<Measurement> measurements;
+    try {
+        measurements.push_back(Measure("lexer", "tokens", iterations, [&] {
+            StringInterner interner;
+            Lexer lexer(source, interner);
+            size_t tokens = 0;
+            while (lexer.NextToken().type != TokenType::Eof) {
+                ++tokens;
+            }
+            return tokens;
+        }));
+
+        measurements.push_back(Measure("parser", "nodes", iterations, [&] {
+            StringInterner interner;
+            size_t nodes = 0;
+            ParseOrThrow(source, interner, &nodes);
+            return nodes;
+        }));
+
+        StringInterner interner;
+        const auto program = ParseOrThrow(source, interner, nullptr);
+        measurements.push_back(Measure("codegen", "bytes", iterations, [&] {
+            Sema(interner).Check(*program);
+            return CodeGenerator().Generate(*program, APXC_OPERATION::APXC_COMPILE_W_ENTRY).size();
+        }));
+        measurements.push_back(Measure("object", "bytes", iterations, [&] {
+            Sema(interner).Check(*program);
+            const MachineModule module = CodeGenerator().Lower(*program, APXC_OPERATION::APXC_COMPILE_W_ENTRY);
+            return elf::WriteObject(x86::Encode(module)).size();
+        }));
+    } catch (const std::runtime_error& e) {
+        fmt::print(stderr, "{}\n", e.what());
+        return 1;
+    }
+
+    fmt::print("{{\n");
+    if (inputFile.empty()) {
+        fmt::print("  \"corpus\": {{\"seed\": {}, \"functions\": {}, \"depth\": {}}},\n",
+                   corpus.seed, corpus.functions, corpus.expressionDepth);
+    } else {
+        fmt::print("  \"input\": \"{}\",\n", inputFile);
+    }
+    fmt::print("  \"source_bytes\": {},\n", source.size());
+    fmt::print("  \"iterations\": {},\n", iterations);
+    for (size_t i = 0; i < measurements.size(); ++i) {
+        const Measurement& m = measurements[i];
+        fmt::print("  \"{}\": {{\"{}\": {}, \"seconds\": {:.6f}, \"{}_per_second\": {:.0f}}}{}\n", m.name, m.unit,
+                   m.amount, m.seconds, m.unit, static_cast<double>(m.amount) / m.seconds,
+                   i + 1 < measurements.size() ? "," : "");
+    }
+    fmt::print("}}\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include "CorpusGenerator.h"
+#include <fmt/format.h>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+    constexpr const char* INFIX_OPERATORS[] = {"+", "-", "*", "/", "==", "!=", "<", ">", "<=", ">="};
+    constexpr const char* INTEGER_TYPES[] = {"i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64"};
+
+    class Generator {
+    public:
+        explicit Generator(const CorpusOptions& options) : options(options), random(options.seed) {}
+
+        std::string Run() {
+            out.reserve(options.functions * options.statementsPerFunction * 64);
+            out += fmt::format("// Generated by apx_bench, seed {}\n\n", options.seed);
+            for (size_t i = 0; i < options.globals; ++i) {
+                GenerateGlobal(i);
+            }
+            out += '\n';
+            for (size_t i = 0; i < options.functions; ++i) {
+                GenerateFunction(i);
+            }
+            GenerateMain();
+            return std::move(out);
+        }
+
+    private:
+        struct Function {
+            std::string name;
+            size_t parameterCount;
+        };
+
+        size_t Below(const size_t bound) { return std::uniform_int_distribution<size_t>(0, bound - 1)(random); }
+        bool Chance(const double probability) { return std::bernoulli_distribution(probability)(random); }
+
+        void GenerateGlobal(const size_t index) {
+            std::string name = fmt::format("g_{}", index);
+            switch (Below(3)) {
+            case 0:
+                out += fmt::format("const {}: i32 = {};\n", name, Literal());
+                break;
+            case 1:
+                out += fmt::format("{} := {};\n", name, Literal());
+                break;
+            default:
+                out += fmt::format("{}: i32 = {};\n", name, Literal());
+                break;
+            }
+            globals.push_back(std::move(name));
+        }
+
+        const char* IntegerType() { return INTEGER_TYPES[Below(std::size(INTEGER_TYPES))]; }
+
+        std::string Literal() {
+            const uint64_t value = Below(5000);
+            return Chance(0.2) ? fmt::format("0x{:X}", value) : fmt::format("{}", value);
+        }
+
+        const std::string& AnyVariable() {
+            if (!locals.empty() && (globals.empty() || Chance(0.8))) {
+                return locals[Below(locals.size())];
+            }
+            return globals[Below(globals.size())];
+        }
+
+        std::string Expression(const int depth) {
+            if (depth <= 0 || Chance(0.15)) {
+                return Chance(0.6) && (!locals.empty() || !globals.empty()) ? AnyVariable() : Literal();
+            }
+            switch (Below(8)) {
+            case 0:
+                return "-" + Expression(depth - 1);
+            case 1:
+                return "!" + Expression(depth - 1);
+            default: {
+                // The corpus is only compiled, never run, so divisors go unguarded
+                const char* op = INFIX_OPERATORS[Below(std::size(INFIX_OPERATORS))];
+                std::string left = Expression(depth - 1);
+                return fmt::format("({} {} {})", left, op, Expression(depth - 1));
+            }
+            }
+        }
+
+        std::string Declare() {
+            std::string name = fmt::format("v{}", nextLocal++);
+            locals.push_back(name);
+            return name;
+        }
+
+        void Indent(const int level) { out.append(static_cast<size_t>(level) * 4, ' '); }
+
+        void GenerateCall(const int level) {
+            const Function& callee = functions[Below(functions.size())];
+            std::string arguments;
+            for (size_t i = 0; i < callee.parameterCount; ++i) {
+                arguments += (i ? ", " : "") + Expression(2);
+            }
+            Indent(level);
+            if (Chance(0.7)) {
+                out += fmt::format("{} := {}({});\n", Declare(), callee.name, arguments);
+            } else {
+                out += fmt::format("{}({});\n", callee.name, arguments);
+            }
+        }
+
+        void GenerateBlock(const int level, const size_t statements) {
+            const size_t scope = locals.size();
+            for (size_t i = 0; i < statements; ++i) {
+                GenerateStatement(level);
+            }
+            locals.resize(scope);
+        }
+
+        void GenerateStatement(int level) {
+            const bool canNest = level <= options.blockDepth;
+            const size_t choice = Below(100);
+            if (choice < 25 || locals.empty()) {
+                const std::string value = Expression(options.expressionDepth);
+                Indent(level);
+                if (Chance(0.3)) {
+                    out += fmt::format("{}: {} = {};\n", Declare(), IntegerType(), value);
+                } else {
+                    out += fmt::format("{} := {};\n", Declare(), value);
+                }
+            } else if (choice < 45) {
+                const std::string& target = locals[Below(locals.size())];
+                Indent(level);
+                out += fmt::format("{} = {};\n", target, Expression(options.expressionDepth));
+            } else if (choice < 58 && canNest) {
+                // if / else if chain
+                const size_t arms = 1 + Below(4);
+                Indent(level);
+                for (size_t arm = 0; arm < arms; ++arm) {
+                    out += fmt::format("if {} {{\n", Expression(3));
+                    GenerateBlock(level + 1, 1 + Below(3));
+                    Indent(level);
+                    if (arm + 1 < arms) {
+                        out += "} else {\n";
+                        Indent(++level);
+                    }
+                }
+                for (size_t arm = 1; arm < arms; ++arm) {
+                    out += "}\n";
+                    Indent(--level);
+                }
+                out += "}\n";
+            } else if (choice < 68 && canNest) {
+                const std::string counter = Declare();
+                Indent(level);
+                out += fmt::format("{} := 0;\n", counter);
+                Indent(level);
+                out += fmt::format("while {} < {} {{\n", counter, 1 + Below(64));
+                GenerateBlock(level + 1, 1 + Below(4));
+                Indent(level + 1);
+                out += fmt::format("{} = {} + 1;\n", counter, counter);
+                Indent(level);
+                out += "}\n";
+            } else if (choice < 76 && canNest) {
+                const std::string target = locals[Below(locals.size())];
+                Indent(level);
+                out += "unsafe {\n";
+                // Kept out of locals: there is no arithmetic on pointers
+                const std::string pointer = fmt::format("v{}", nextLocal++);
+                Indent(level + 1);
+                out += fmt::format("{} := &{};\n", pointer, target);
+                Indent(level + 1);
+                out += fmt::format("*{} = *{} + {};\n", pointer, pointer, Expression(2));
+                GenerateBlock(level + 1, Below(2));
+                Indent(level);
+                out += "}\n";
+            } else if (choice < 80) {
+                Indent(level);
+                out += "asm {\n";
+                Indent(level + 1);
+                out += fmt::format("mov rax, {}!\n", Below(100000));
+                Indent(level + 1);
+                out += Chance(0.5) ? "mov rbx, rax!\n" : "nop!\n";
+                Indent(level);
+                out += "}\n";
+            } else if (!functions.empty()) {
+                GenerateCall(level);
+            } else {
+                const std::string value = Expression(options.expressionDepth);
+                Indent(level);
+                out += fmt::format("{} := {};\n", Declare(), value);
+            }
+        }
+
+        void GenerateFunction(const size_t index) {
+            Function function{fmt::format("f_{}", index), Below(4)};
+            locals.clear();
+            nextLocal = 0;
+
+            std::string parameters;
+            for (size_t i = 0; i < function.parameterCount; ++i) {
+                std::string name = fmt::format("p{}", i);
+                parameters += fmt::format("{}{}: {}", i ? ", " : "", name, IntegerType());
+                locals.push_back(std::move(name));
+            }
+            if (Chance(0.5)) {
+                out += "#[global]\n";
+            }
+            out += fmt::format("fn {}({}) -> {} {{\n", function.name, parameters, IntegerType());
+            GenerateBlock(1, options.statementsPerFunction);
+            out += fmt::format("    return {};\n}}\n\n", Expression(options.expressionDepth));
+            functions.push_back(std::move(function));
+        }
+
+        void GenerateMain() {
+            locals.clear();
+            nextLocal = 0;
+            out += "#[global]\nfn main() -> i32 {\n";
+            for (size_t i = 0; i < functions.size() && i < 16; ++i) {
+                GenerateCall(1);
+            }
+            out += "    return 0;\n}\n";
+        }
+
+        const CorpusOptions& options;
+        std::mt19937_64 random;
+        std::string out;
+        std::vector<std::string> globals;
+        std::vector<std::string> locals;
+        std::vector<Function> functions;
+        size_t nextLocal = 0;
+    };
+}
+
+std::string GenerateCorpus(const CorpusOptions& options) {
+    return Generator(options).Run();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Seeded generator of synthetic APX programs for the compile benchmarks. The
+// output uses every construct in main.apx (constants and typed globals,
+// #[global] functions with parameters, nested if/else chains, while loops,
+// unsafe blocks with pointers, inline asm, hex literals and calls) and always
+// parses and checks cleanly. The same options always produce the same text.
+struct CorpusOptions {
+    uint64_t seed = 1;
+    size_t functions = 2000;
+    size_t globals = 32;
+    // Statements at the top of each function body
+    size_t statementsPerFunction = 12;
+    // Nesting of parenthesised infix expressions
+    int expressionDepth = 6;
+    // Nesting of if/while/unsafe blocks
+    int blockDepth = 3;
+};
+
+std::string GenerateCorpus(const CorpusOptions& options);
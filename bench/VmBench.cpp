@@ -0,0 +1,80 @@
+// Throughput of the bytecode interpreter against native code from the x86
+// encoder. Every function without parameters in the input is called
+// repeatedly both ways; results must agree.
+//
+//   apx_vm_bench [file.apx] [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include "Bytecode.h"
+#include "CodeGenerator.h"
+#include "Compiler.h"
+#include "Interpreter.h"
+#include "JitModule.h"
+#include "Sema.h"
+#include "SourceFile.h"
+#include "X86Encoder.h"
+
+namespace {
+    template<typename Body>
+    double NanosecondsPerCall(const long iterations, Body&& body) {
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; ++i) {
+            body();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "main.apx";
+    const long iterations = argc > 2 ? std::atol(argv[2]) : 200000;
+
+    SourceFile source;
+    if (!source.Open(path)) {
+        fmt::print(stderr, "Could not open input file: {}\n", path);
+        return 1;
+    }
+    const auto unit = apx::Parse(std::string(source.GetContents()));
+    if (!unit->diagnostics.empty()) {
+        fmt::print(stderr, "{}: {}\n", path, unit->diagnostics.front().message);
+        return 1;
+    }
+
+    try {
+        Sema sema(unit->interner);
+        sema.Check(*unit->program);
+
+        const BytecodeModule bytecode = BytecodeCompiler().Compile(*unit->program);
+        const JitModule native(x86::Encode(CodeGenerator().Lower(*unit->program, APXC_OPERATION::APXC_COMPILE_WO_ENTRY)));
+        Interpreter interpreter(bytecode);
+
+        fmt::print("{:<24} {:>12} {:>12} {:>8}\n", "function", "native ns", "interp ns", "ratio");
+        bool agree = true;
+        for (uint32_t i = 0; i < bytecode.functions.size(); ++i) {
+            const BytecodeFunction& function = bytecode.functions[i];
+            if (function.parameterCount != 0) {
+                continue;
+            }
+            void* entry = native.Lookup(function.name);
+            const int64_t nativeResult = native.Call(entry);
+            const int64_t interpretedResult = interpreter.Call(i);
+
+            volatile int64_t sink = 0;
+            const double nativeTime = NanosecondsPerCall(iterations, [&] { sink = native.Call(entry); });
+            const double interpretedTime = NanosecondsPerCall(iterations, [&] { sink = interpreter.Call(i); });
+            (void)sink;
+
+            fmt::print("{:<24} {:>12.1f} {:>12.1f} {:>7.1f}x{}\n", function.name, nativeTime, interpretedTime,
+                       interpretedTime / nativeTime,
+                       nativeResult == interpretedResult ? "" : fmt::format("  MISMATCH {} != {}", interpretedResult, nativeResult));
+            agree = agree && nativeResult == interpretedResult;
+        }
+        return agree ? 0 : 1;
+    } catch (const std::runtime_error& e) {
+        fmt::print(stderr, "{}\n", e.what());
+        return 1;
+    }
+}
@@ -29,39 +29,74 @@ if(APX_FOUND)
     function(apx_compile_file input_file output_file)
         add_custom_command(
             OUTPUT ${output_file}
-            COMMAND ${APX_EXECUTABLE} -i ${input_file} -o ${output_file}
+            COMMAND ${APX_EXECUTABLE} ${input_file} -o ${output_file}
             DEPENDS ${input_file}
             COMMENT "Compiling APX file ${input_file}"
         )
     endfunction()
 
+    # Number of files one apxc invocation compiles in parallel, 0 = all cores
+    set(APX_JOBS 0 CACHE STRING "Parallel jobs for batch APX compilation")
+    # Outputs of unchanged sources are reused from here; empty disables it
+    set(APX_CACHE_DIR "${CMAKE_BINARY_DIR}/apx-cache" CACHE PATH "Content-addressed APX compile cache")
+    # apxc writes ELF objects itself; set this to go through NASM source instead
+    option(APX_USE_NASM "Assemble APX output with nasm instead of apxc's built-in encoder" OFF)
+
     function(apx_add_library target_name)
         set(output_files "")
-        set(asm_files "")
+        set(generated_files "")
+        set(input_files "")
+        set(apx_arguments "")
         foreach(source_file ${ARGN})
             get_filename_component(basename ${source_file} NAME_WE)
-            set(generated_asm "${CMAKE_CURRENT_BINARY_DIR}/${basename}.s")
+            set(input_file "${CMAKE_CURRENT_SOURCE_DIR}/${source_file}")
             set(generated_obj "${CMAKE_CURRENT_BINARY_DIR}/${basename}.o")
 
-            apx_compile_file(${CMAKE_CURRENT_SOURCE_DIR}/${source_file} ${generated_asm})
-
-            add_custom_command(
-                OUTPUT ${generated_obj}
-                COMMAND nasm -f elf64 ${generated_asm} -o ${generated_obj}
-                DEPENDS ${generated_asm}
-                COMMENT "Assembling ${generated_asm}"
-            )
+            if(APX_USE_NASM)
+                set(generated_asm "${CMAKE_CURRENT_BINARY_DIR}/${basename}.s")
+                list(APPEND apx_arguments ${input_file} -o ${generated_asm})
+                add_custom_command(
+                    OUTPUT ${generated_obj}
+                    COMMAND nasm -f elf64 ${generated_asm} -o ${generated_obj}
+                    DEPENDS ${generated_asm}
+                    COMMENT "Assembling ${generated_asm}"
+                )
+                list(APPEND generated_files ${generated_asm})
+            else()
+                list(APPEND apx_arguments ${input_file} -o ${generated_obj})
+                list(APPEND generated_files ${generated_obj})
+            endif()
             list(APPEND output_files ${generated_obj})
-            list(APPEND asm_files ${generated_asm})
+            list(APPEND input_files ${input_file})
         endforeach()
 
+        set(format_arguments -f obj)
+        if(APX_USE_NASM)
+            set(format_arguments -f nasm)
+        endif()
+
+        set(cache_arguments "")
+        if(APX_CACHE_DIR)
+            set(cache_arguments --cache-dir ${APX_CACHE_DIR})
+        endif()
+
+        # One apxc process compiles every source of the library on its worker
+        # pool. apxc leaves outputs whose contents did not change untouched,
+        # so only the sources that actually changed are relinked.
+        add_custom_command(
+            OUTPUT ${generated_files}
+            COMMAND ${APX_EXECUTABLE} -j ${APX_JOBS} ${format_arguments} ${cache_arguments} ${apx_arguments}
+            DEPENDS ${input_files} ${APX_EXECUTABLE}
+            COMMENT "Compiling APX sources for ${target_name}"
+        )
+
         add_library(${target_name} STATIC ${output_files})
         
-        # Add a custom target to clean the generated assembly files
+        # Deletes the generated files on request; not a dependency of the
+        # library, which would force a full rebuild every time
         add_custom_target(Clean${target_name}
-            COMMAND ${CMAKE_COMMAND} -E remove ${asm_files} ${output_files}
+            COMMAND ${CMAKE_COMMAND} -E remove ${generated_files} ${output_files}
             COMMENT "Cleaning generated files for ${target_name}"
         )
-        add_dependencies(${target_name} Clean${target_name})
     endfunction()
 endif()
@@ -1,186 +1,298 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
-#include <memory>
+#include "Arena.h"
+#include "StringInterner.h"
+#include "Type.h"
 
-// Forward declaration
-class Attribute;
+// Every concrete node type, in NodeKind order. Expressions and statements are
+// kept contiguous so their base classes can test membership with a range check.
+#define APX_AST_NODES(X) \
+    X(Program) \
+    X(Attribute) \
+    X(Identifier) \
+    X(IntegerLiteral) \
+    X(FloatLiteral) \
+    X(CallExpression) \
+    X(InfixExpression) \
+    X(PrefixExpression) \
+    X(DereferenceExpression) \
+    X(AddressOfExpression) \
+    X(VariableDeclaration) \
+    X(ReturnStatement) \
+    X(BlockStatement) \
+    X(FunctionDeclaration) \
+    X(ExpressionStatement) \
+    X(IfStatement) \
+    X(WhileStatement) \
+    X(AssignmentStatement) \
+    X(UnsafeStatement) \
+    X(DereferenceAssignmentStatement) \
+    X(InlineAssemblyStatement) \
+    X(ImportDeclaration)
 
-// Base class for all nodes in the AST
+enum class NodeKind : uint8_t {
+#define APX_NODE_KIND(Name) Name,
+    APX_AST_NODES(APX_NODE_KIND)
+#undef APX_NODE_KIND
+};
+
+#define APX_NODE_COUNT(Name) +1
+constexpr size_t NODE_KIND_COUNT = 0 APX_AST_NODES(APX_NODE_COUNT);
+#undef APX_NODE_COUNT
+
+const char* NodeKindName(NodeKind kind);
+
+// Base class for all nodes in the AST. Nodes are allocated in the owning
+// Program's arena and are never destroyed individually, so every node type
+// must stay trivially destructible: children are plain pointers, lists are
+// ArenaLists and text is a string_view into arena-owned storage.
+// Passes dispatch on kind (see AstVisitor.h) rather than through a vtable.
 class Node {
 public:
-    virtual ~Node() = default;
-    virtual std::string ToString() const = 0;
-    std::vector<std::unique_ptr<Attribute>> attributes;
+    const NodeKind kind;
+    // Prints the subtree through AstPrinter, on one line
+    std::string ToString() const;
+
+protected:
+    explicit Node(const NodeKind kind) : kind(kind) {}
+    ~Node() = default;
+};
+
+// Stamps a concrete node type with its kind
+template<NodeKind K, typename Base>
+class NodeOf : public Base {
+public:
+    static constexpr NodeKind Kind = K;
+    static bool ClassOf(const NodeKind kind) { return kind == K; }
+
+protected:
+    NodeOf() : Base(K) {}
 };
 
+// Kind-checked replacements for dynamic_cast
+template<typename T>
+bool Is(const Node* node) {
+    return node && T::ClassOf(node->kind);
+}
+
+template<typename T>
+T* DynCast(Node* node) {
+    return Is<T>(node) ? static_cast<T*>(node) : nullptr;
+}
+
+template<typename T>
+const T* DynCast(const Node* node) {
+    return Is<T>(node) ? static_cast<const T*>(node) : nullptr;
+}
+
 // Represents an attribute like #[align(16)] or #[global]
-class Attribute : public Node {
+class Attribute : public NodeOf<NodeKind::Attribute, Node> {
 public:
-    std::string name;
-    std::vector<std::string> arguments;
-    std::string ToString() const override;
+    std::string_view name;
+    ArenaList<std::string_view> arguments;
 };
 
 // Base class for all expressions
-class Expression : public Node {};
+class Expression : public Node {
+public:
+    static bool ClassOf(const NodeKind kind) {
+        return kind >= NodeKind::Identifier && kind <= NodeKind::AddressOfExpression;
+    }
+
+    // Filled in by Sema; sits in padding after kind
+    mutable Type type;
+
+protected:
+    using Node::Node;
+};
 
 // Base class for all statements
-class Statement : public Node {};
+class Statement : public Node {
+public:
+    static bool ClassOf(const NodeKind kind) {
+        return kind >= NodeKind::VariableDeclaration && kind <= NodeKind::ImportDeclaration;
+    }
+
+protected:
+    using Node::Node;
+};
 
 // Represents the entire program
-class Program : public Node {
+class Program final : public NodeOf<NodeKind::Program, Node> {
 public:
-    std::vector<std::unique_ptr<Statement>> statements;
-    std::string ToString() const override;
+    Arena arena; // Owns every node reachable from statements
+    std::vector<Statement*> statements;
+    // Attributes are rare, so they live in a side table instead of on every node
+    std::unordered_map<const Node*, ArenaList<Attribute*>> attributes;
+
+    [[nodiscard]] ArenaList<Attribute*> GetAttributes(const Node& node) const;
+};
+
+// Where a resolved identifier lives at run time
+enum class StorageKind : uint8_t {
+    Unresolved,
+    Global, // Addressed by name in the data section
+    Frame,  // [rbp + offset]: locals are negative, parameters positive
+};
+
+// What an operator's spelling means, so the back ends switch on it instead
+// of comparing strings
+enum class Operator : uint8_t {
+    Unknown,
+    Add, Sub, Mul, Div,
+    Eq, Ne, Lt, Gt, Le, Ge,
+    Neg, Not,
 };
 
 // Represents an identifier
-class Identifier : public Expression {
+class Identifier : public NodeOf<NodeKind::Identifier, Expression> {
 public:
-    std::string value;
-    std::string ToString() const override;
+    std::string_view value; // Owned by the StringInterner
+    Symbol symbol = INVALID_SYMBOL;
+    // Annotations filled in by Sema on an otherwise immutable tree
+    mutable StorageKind storage = StorageKind::Unresolved;
+    mutable int32_t offset = 0;
 };
 
 // Represents an integer literal
-class IntegerLiteral : public Expression {
+class IntegerLiteral : public NodeOf<NodeKind::IntegerLiteral, Expression> {
 public:
-    int64_t value;
-    std::string ToString() const override;
+    int64_t value = 0;
 };
 
 // Represents a float literal
-class FloatLiteral : public Expression {
+class FloatLiteral : public NodeOf<NodeKind::FloatLiteral, Expression> {
 public:
-    double value;
-    std::string ToString() const override;
+    double value = 0;
 };
 
 // Represents a variable declaration (e.g., x := 10 or x: i32 = 10)
-class VariableDeclaration : public Statement {
+class VariableDeclaration : public NodeOf<NodeKind::VariableDeclaration, Statement> {
 public:
-    std::unique_ptr<Identifier> name;
-    std::unique_ptr<Identifier> type; // Optional type annotation
-    std::unique_ptr<Expression> value;
+    Identifier* name = nullptr;
+    Identifier* type = nullptr; // Optional type annotation
+    Expression* value = nullptr;
     bool isConst = false;
     bool isGlobal = false; // Set by #[global] attribute
     int alignment = 0; // Set by #[align(x)] attribute
-    std::string ToString() const override;
 };
 
 // Legacy alias for compatibility
 using LetStatement = VariableDeclaration;
 
-class ReturnStatement : public Statement {
+class ReturnStatement : public NodeOf<NodeKind::ReturnStatement, Statement> {
 public:
-    std::unique_ptr<Expression> returnValue;
-    std::string ToString() const override;
+    Expression* returnValue = nullptr;
 };
 
-class BlockStatement : public Statement {
+class BlockStatement : public NodeOf<NodeKind::BlockStatement, Statement> {
 public:
-    std::vector<std::unique_ptr<Statement>> statements;
-    std::string ToString() const override;
+    ArenaList<Statement*> statements;
 };
 
-class FunctionDeclaration : public Statement {
+class FunctionDeclaration : public NodeOf<NodeKind::FunctionDeclaration, Statement> {
 public:
-    std::unique_ptr<Identifier> name;
-    std::vector<std::unique_ptr<Identifier>> parameters;
-    std::unique_ptr<Identifier> returnType;
-    std::unique_ptr<BlockStatement> body;
-    std::string ToString() const override;
+    Identifier* name = nullptr;
+    ArenaList<Identifier*> parameters;
+    ArenaList<Identifier*> parameterTypes; // One per parameter, i32 when not given
+    Identifier* returnType = nullptr;
+    BlockStatement* body = nullptr;
+    bool isGlobal = false; // Set by #[global] attribute
+    mutable int32_t frameSize = 0; // Bytes of local variable slots, set by Sema
 };
 
-class CallExpression : public Expression {
+class CallExpression : public NodeOf<NodeKind::CallExpression, Expression> {
 public:
-    std::unique_ptr<Identifier> function;
-    std::vector<std::unique_ptr<Expression>> arguments;
-    std::string ToString() const override;
+    Identifier* function = nullptr;
+    ArenaList<Expression*> arguments;
 };
 
-class InfixExpression : public Expression {
+class InfixExpression : public NodeOf<NodeKind::InfixExpression, Expression> {
 public:
-    std::unique_ptr<Expression> left;
-    std::string op;
-    std::unique_ptr<Expression> right;
-    std::string ToString() const override;
+    Expression* left = nullptr;
+    std::string_view op;
+    Expression* right = nullptr;
+    // Set by Sema: op, and the type both operands are converted to
+    mutable Operator operation = Operator::Unknown;
+    mutable Type operandType;
 };
 
 // Represents an expression statement (e.g., function calls as statements)
-class ExpressionStatement : public Statement {
+class ExpressionStatement : public NodeOf<NodeKind::ExpressionStatement, Statement> {
 public:
-    std::unique_ptr<Expression> expression;
-    std::string ToString() const override;
+    Expression* expression = nullptr;
 };
 
 // Represents a prefix expression (e.g., -x, !x)
-class PrefixExpression : public Expression {
+class PrefixExpression : public NodeOf<NodeKind::PrefixExpression, Expression> {
 public:
-    std::string op;
-    std::unique_ptr<Expression> right;
-    std::string ToString() const override;
+    std::string_view op;
+    Expression* right = nullptr;
+    mutable Operator operation = Operator::Unknown; // Set by Sema
 };
 
 // Represents an if statement
-class IfStatement : public Statement {
+class IfStatement : public NodeOf<NodeKind::IfStatement, Statement> {
 public:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<BlockStatement> consequence;
-    std::unique_ptr<BlockStatement> alternative; // Optional else block
-    std::string ToString() const override;
+    Expression* condition = nullptr;
+    BlockStatement* consequence = nullptr;
+    BlockStatement* alternative = nullptr; // Optional else block
 };
 
 // Represents a while loop
-class WhileStatement : public Statement {
+class WhileStatement : public NodeOf<NodeKind::WhileStatement, Statement> {
 public:
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<BlockStatement> body;
-    std::string ToString() const override;
+    Expression* condition = nullptr;
+    BlockStatement* body = nullptr;
 };
 
 // Represents an assignment statement (e.g., x = 5)
-class AssignmentStatement : public Statement {
+class AssignmentStatement : public NodeOf<NodeKind::AssignmentStatement, Statement> {
 public:
-    std::unique_ptr<Identifier> name;
-    std::unique_ptr<Expression> value;
-    std::string ToString() const override;
+    Identifier* name = nullptr;
+    Expression* value = nullptr;
 };
 
 // Represents an unsafe block
-class UnsafeStatement : public Statement {
+class UnsafeStatement : public NodeOf<NodeKind::UnsafeStatement, Statement> {
 public:
-    std::unique_ptr<BlockStatement> body;
-    std::string ToString() const override;
+    BlockStatement* body = nullptr;
 };
 
 // Represents pointer dereference (*ptr)
-class DereferenceExpression : public Expression {
+class DereferenceExpression : public NodeOf<NodeKind::DereferenceExpression, Expression> {
 public:
-    std::unique_ptr<Expression> operand;
-    std::string ToString() const override;
+    Expression* operand = nullptr;
 };
 
 // Represents address-of (&var)
-class AddressOfExpression : public Expression {
+class AddressOfExpression : public NodeOf<NodeKind::AddressOfExpression, Expression> {
 public:
-    std::unique_ptr<Expression> operand;
-    std::string ToString() const override;
+    Expression* operand = nullptr;
 };
 
 // Represents dereferenced assignment (*ptr = value)
-class DereferenceAssignmentStatement : public Statement {
+class DereferenceAssignmentStatement : public NodeOf<NodeKind::DereferenceAssignmentStatement, Statement> {
 public:
-    std::unique_ptr<Expression> pointer;
-    std::unique_ptr<Expression> value;
-    std::string ToString() const override;
+    Expression* pointer = nullptr;
+    Expression* value = nullptr;
 };
 
 // Represents inline assembly block
-class InlineAssemblyStatement : public Statement {
+class InlineAssemblyStatement : public NodeOf<NodeKind::InlineAssemblyStatement, Statement> {
+public:
+    std::string_view assembly_code;
+};
+
+// Represents `import name;`, which makes the exported declarations of the
+// module compiled from name.apx available through its name.apxi interface
+class ImportDeclaration : public NodeOf<NodeKind::ImportDeclaration, Statement> {
 public:
-    std::string assembly_code;
-    std::string ToString() const override;
+    Identifier* module = nullptr;
 };
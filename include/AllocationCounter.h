@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Process-wide heap allocation counts for apxc --stats. They are collected by
+// replacing the global operator new, which only happens in executables built
+// with APX_COUNT_ALLOCATIONS defined; libapx itself never replaces it.
+namespace memory {
+
+    struct AllocationCounts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0; // Requested, not counting allocator overhead
+    };
+
+    // False when built without the counting hook; the counts stay zero then
+    bool IsCountingAllocations();
+    AllocationCounts GetAllocationCounts();
+
+} // namespace memory
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed-size list whose elements live in an Arena. It is a plain pointer and
+// a 32-bit count, so nodes that embed one stay trivially destructible.
+template<typename T>
+class ArenaList {
+public:
+    ArenaList() = default;
+    ArenaList(T* data, uint32_t count) : items(data), count(count) {}
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    std::reverse_iterator<T*> rbegin() const { return std::reverse_iterator<T*>(end()); }
+    std::reverse_iterator<T*> rend() const { return std::reverse_iterator<T*>(begin()); }
+    T& operator[](size_t index) const { return items[index]; }
+
+private:
+    T* items = nullptr;
+    uint32_t count = 0;
+};
+
+// Bump allocator that owns every object placed in it. Memory is carved out of
+// large blocks and released all at once when the arena dies; destructors are
+// never run, so only trivially destructible types may be allocated here.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    // A moved-from arena is empty: its cursor must not point into blocks it
+    // no longer owns
+    Arena(Arena&& other) noexcept
+        : blocks(std::move(other.blocks)), cursor(std::exchange(other.cursor, nullptr)),
+          limit(std::exchange(other.limit, nullptr)), bytesUsed(std::exchange(other.bytesUsed, 0)),
+          bytesReserved(std::exchange(other.bytesReserved, 0)) {
+        other.blocks.clear();
+    }
+    Arena& operator=(Arena&& other) noexcept {
+        if (this != &other) {
+            blocks = std::move(other.blocks);
+            other.blocks.clear();
+            cursor = std::exchange(other.cursor, nullptr);
+            limit = std::exchange(other.limit, nullptr);
+            bytesUsed = std::exchange(other.bytesUsed, 0);
+            bytesReserved = std::exchange(other.bytesReserved, 0);
+        }
+        return *this;
+    }
+
+    void* Allocate(size_t size, size_t alignment) {
+        auto current = reinterpret_cast<uintptr_t>(cursor);
+        auto aligned = (current + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+            return AllocateSlow(size, alignment);
+        }
+        cursor = reinterpret_cast<std::byte*>(aligned + size);
+        bytesUsed += size;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    template<typename T, typename... Args>
+    T* New(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena never runs destructors");
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copies the characters into the arena and returns a view of the copy
+    std::string_view CopyString(std::string_view text);
+
+    template<typename T>
+    ArenaList<T> CopyList(const T* values, const size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena never runs destructors");
+        if (count == 0) {
+            return {};
+        }
+        T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        std::uninitialized_copy(values, values + count, data);
+        return {data, static_cast<uint32_t>(count)};
+    }
+
+    template<typename T>
+    ArenaList<T> CopyList(const std::vector<T>& values) {
+        return CopyList(values.data(), values.size());
+    }
+
+    // Takes over every block of other, so what was allocated there lives as
+    // long as this arena; other is left empty
+    void Adopt(Arena&& other);
+
+    [[nodiscard]] size_t GetBytesUsed() const { return bytesUsed; }
+    [[nodiscard]] size_t GetBytesReserved() const { return bytesReserved; }
+
+private:
+    void* AllocateSlow(size_t size, size_t alignment);
+
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    size_t bytesUsed = 0;
+    size_t bytesReserved = 0;
+};
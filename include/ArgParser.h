@@ -1,12 +1,38 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "CodeGenerator.h"
 
 struct CompileConfiguration {
     APXC_OPERATION operation = APXC_OPERATION::APXC_UNKNOWN;
-    std::string inputFile;
-    std::string outputFile;
+    APXC_OUTPUT_FORMAT format = APXC_OUTPUT_FORMAT::APXC_NASM;
+    std::vector<std::string> inputFiles;
+    // Either empty or one entry per input file, paired in order
+    std::vector<std::string> outputFiles;
+    // Searched for imported modules after the input's and output's directories
+    std::vector<std::string> importPaths;
+    // Write each input's module interface next to its output
+    bool emitInterface = false;
+    // Worker threads for batch compilation, 0 = one per hardware thread
+    unsigned jobs = 1;
+    // Execute the input in process instead of writing output, natively or
+    // on the bytecode interpreter
+    bool run = false;
+    bool interpret = false;
+    // Recompile the inputs whenever they are saved, until interrupted
+    bool watch = false;
+    // Run as a compile server, or forward compiles to one
+    bool server = false;
+    bool connect = false;
+    std::string socketPath;
+    // Print per-phase timings / write a Chrome trace when set
+    bool timeReport = false;
+    std::string traceFile;
+    // Print memory and size statistics after compiling
+    bool stats = false;
+    // On-disk output cache, disabled when empty
+    std::string cacheDir;
     bool showHelp = false;
     bool hasError = false;
     bool showVersion = false;
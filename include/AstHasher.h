@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include "AST.h"
+#include "AstVisitor.h"
+#include "ContentHash.h"
+
+// Structural hash of a subtree: node kinds, names, operators, literal bits and
+// list lengths, but not source positions, comments or layout. Two subtrees
+// with the same hash generate the same code as long as the names they use
+// are bound the same way. Used by apxc --watch to find the functions an edit
+// changed.
+class AstHasher : private AstVisitor<AstHasher> {
+public:
+    uint64_t Hash(const Node& node);
+
+private:
+    friend class AstVisitor<AstHasher>;
+
+    template<typename T>
+    void Mix(const T value) {
+        hash = HashBytes(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)), hash);
+    }
+    // Length first, so adjacent strings cannot run into each other
+    void MixString(const std::string_view text) {
+        Mix(text.size());
+        hash = HashBytes(text, hash);
+    }
+    void MixKind(const Node& node) { Mix(node.kind); }
+    // Absent optional children hash differently from every node
+    void HashOptional(const Node* node);
+    void HashStatements(const ArenaList<Statement*>& statements);
+    void HashExpression(const Expression& expression) { WalkExpression(expression, expressionStack); }
+    const Expression* ResumeExpression(const Expression& expression, uint32_t step);
+
+    void VisitProgram(const Program& program);
+    void VisitAttribute(const Attribute& attribute);
+    void VisitIdentifier(const Identifier& ident);
+    void VisitIntegerLiteral(const IntegerLiteral& intLiteral);
+    void VisitFloatLiteral(const FloatLiteral& floatLiteral);
+    void VisitVariableDeclaration(const VariableDeclaration& varDecl);
+    void VisitReturnStatement(const ReturnStatement& returnStmt);
+    void VisitBlockStatement(const BlockStatement& block);
+    void VisitFunctionDeclaration(const FunctionDeclaration& funcDecl);
+    void VisitExpressionStatement(const ExpressionStatement& exprStmt);
+    void VisitIfStatement(const IfStatement& ifStmt);
+    void VisitWhileStatement(const WhileStatement& whileStmt);
+    void VisitAssignmentStatement(const AssignmentStatement& assignStmt);
+    void VisitUnsafeStatement(const UnsafeStatement& unsafeStmt);
+    void VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign);
+    void VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt);
+    void VisitImportDeclaration(const ImportDeclaration& importDecl);
+
+    uint64_t hash = 0;
+    std::vector<ExpressionStep> expressionStack;
+};
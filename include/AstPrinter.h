@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include "AST.h"
+#include "AstVisitor.h"
+
+// Prints an AST back as APX-like source (the -E output) in one traversal,
+// appending to a caller-owned buffer instead of building a string per node,
+// so the cost is linear in the size of the tree and the buffer can be reused
+// or flushed between top-level statements.
+//
+// With indent 0 everything is printed on one line, the historical -E format;
+// otherwise every statement gets its own line, nested blocks indented by
+// that many spaces per level.
+class AstPrinter : private AstVisitor<AstPrinter> {
+public:
+    explicit AstPrinter(std::string& out, int indent = 0) : out(out), indent(indent) {}
+
+    void Print(const Node& node);
+
+private:
+    friend class AstVisitor<AstPrinter>;
+
+    void PrintBody(const BlockStatement& block);
+    void PrintStatements(const std::vector<Statement*>& statements);
+    void PrintStatements(const ArenaList<Statement*>& statements);
+    void PrintStatement(const Statement& statement);
+    void PrintExpression(const Expression& expression) { WalkExpression(expression, expressionStack); }
+    const Expression* ResumeExpression(const Expression& expression, uint32_t step);
+
+    void VisitProgram(const Program& program);
+    void VisitAttribute(const Attribute& attribute);
+    void VisitIdentifier(const Identifier& ident);
+    void VisitIntegerLiteral(const IntegerLiteral& intLiteral);
+    void VisitFloatLiteral(const FloatLiteral& floatLiteral);
+    void VisitVariableDeclaration(const VariableDeclaration& varDecl);
+    void VisitReturnStatement(const ReturnStatement& returnStmt);
+    void VisitBlockStatement(const BlockStatement& block);
+    void VisitFunctionDeclaration(const FunctionDeclaration& funcDecl);
+    void VisitExpressionStatement(const ExpressionStatement& exprStmt);
+    void VisitIfStatement(const IfStatement& ifStmt);
+    void VisitWhileStatement(const WhileStatement& whileStmt);
+    void VisitAssignmentStatement(const AssignmentStatement& assignStmt);
+    void VisitUnsafeStatement(const UnsafeStatement& unsafeStmt);
+    void VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign);
+    void VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt);
+    void VisitImportDeclaration(const ImportDeclaration& importDecl);
+
+    std::string& out;
+    const int indent;
+    int depth = 0;
+    std::vector<ExpressionStep> expressionStack;
+};
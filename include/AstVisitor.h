@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "AST.h"
+
+// One node of an expression being walked by AstVisitor::WalkExpression, with
+// the number of times it has been resumed so far
+struct ExpressionStep {
+    const Expression* node;
+    uint32_t step;
+};
+
+// Kind-switched dispatch shared by every pass over the AST. A pass derives
+// from AstVisitor<Pass, R> and defines Visit<NodeType> for the node types it
+// handles; everything else lands in VisitDefault, which returns R{} unless
+// the pass provides its own (typically generic) VisitDefault.
+template<typename Derived, typename R = void>
+class AstVisitor {
+public:
+    R Visit(const Node& node) {
+        switch (node.kind) {
+#define APX_VISIT_CASE(Name) \
+            case NodeKind::Name: return Self().Visit##Name(static_cast<const Name&>(node));
+            APX_AST_NODES(APX_VISIT_CASE)
+#undef APX_VISIT_CASE
+        }
+        return Self().VisitDefault(node);
+    }
+
+#define APX_VISIT_DEFAULT(Name) \
+    R Visit##Name(const Name& node) { return Self().VisitDefault(node); }
+    APX_AST_NODES(APX_VISIT_DEFAULT)
+#undef APX_VISIT_DEFAULT
+
+    template<typename T>
+    R VisitDefault(const T&) {
+        if constexpr (!std::is_void_v<R>) {
+            return R{};
+        }
+    }
+
+protected:
+    // Walks an expression depth first on an explicit stack rather than the
+    // native one, so machine-generated expressions nested hundreds of
+    // thousands deep cost heap instead of overflowing. The pass's
+    // ResumeExpression(node, step) is called with step 0, 1, 2, ... and does
+    // whatever is due before its step-th child, returning that child or
+    // nullptr once the node is finished. stack is scratch space the pass
+    // keeps between walks; it is left as it was found.
+    void WalkExpression(const Expression& root, std::vector<ExpressionStep>& stack) {
+        const size_t base = stack.size();
+        stack.push_back({&root, 0});
+        try {
+            while (stack.size() > base) {
+                const ExpressionStep current = stack.back();
+                ++stack.back().step;
+                if (const Expression* child = Self().ResumeExpression(*current.node, current.step)) {
+                    stack.push_back({child, 0});
+                } else {
+                    stack.pop_back();
+                }
+            }
+        } catch (...) {
+            stack.resize(base);
+            throw;
+        }
+    }
+
+private:
+    Derived& Self() { return static_cast<Derived&>(*this); }
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "AST.h"
+#include "AstVisitor.h"
+
+// Register bytecode for the interpreter. Every function works on a window of
+// 64-bit registers: parameters first, then one register per local variable,
+// then temporaries. A register always holds its value extended to 64 bits as
+// its static type says, so narrow values are truncated with Extend wherever
+// the native code would drop their upper bits. A call passes its arguments in consecutive registers at
+// the top of the caller's window, and the callee's window starts right there,
+// so arguments are never copied; the result comes back in the first of them.
+//
+// Operands a, b and c are register numbers unless noted. Jump targets are
+// indices into BytecodeModule::code.
+#define APX_BYTECODE_OPS(X) \
+    X(LoadImm)      /* a = b | c << 32 */ \
+    X(Move)         /* a = b */ \
+    X(LoadGlobal)   /* a = globals[b] */ \
+    X(StoreGlobal)  /* globals[a] = b */ \
+    X(AddrLocal)    /* a = &b */ \
+    X(AddrGlobal)   /* a = &globals[b] */ \
+    X(Load)         /* a = *b, read as the integer type c (a BaseType; None reads 64 bits) */ \
+    X(Store)        /* *a = b */ \
+    X(Add)          /* a = b + c */ \
+    X(Sub) \
+    X(Mul) \
+    X(Div) \
+    X(Div32)        /* a = b / c as 32-bit integers */ \
+    X(DivU)         /* a = b / c as unsigned integers */ \
+    X(Eq)           /* a = b == c */ \
+    X(Ne) \
+    X(Lt) \
+    X(Gt) \
+    X(Le) \
+    X(Ge) \
+    X(LtU)          /* a = b < c as unsigned integers */ \
+    X(GtU) \
+    X(LeU) \
+    X(GeU) \
+    X(Neg)          /* a = -b */ \
+    X(Not)          /* a = !b */ \
+    X(Extend)       /* a = b truncated to the integer type c (a BaseType), as Truncate does */ \
+    X(Jump)         /* goto a */ \
+    X(JumpIfZero)   /* if !a goto b */ \
+    X(JumpIfEq)     /* if a == b goto c */ \
+    X(JumpIfNe) \
+    X(JumpIfLt) \
+    X(JumpIfGt) \
+    X(JumpIfLe) \
+    X(JumpIfGe) \
+    X(Call)         /* a = functions[b](a, a + 1, ...) */ \
+    X(Return)       /* return a */
+
+enum class BytecodeOp : uint8_t {
+#define APX_BYTECODE_OP(Name) Name,
+    APX_BYTECODE_OPS(APX_BYTECODE_OP)
+#undef APX_BYTECODE_OP
+};
+
+struct BytecodeInstruction {
+    BytecodeOp op;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+};
+
+struct BytecodeFunction {
+    std::string_view name;
+    uint32_t entry = 0;         // index of the first instruction
+    uint32_t parameterCount = 0;
+    uint32_t frameSize = 0;     // registers the window needs
+};
+
+// A compiled program. Names are views into the Program it was compiled from.
+struct BytecodeModule {
+    std::vector<BytecodeInstruction> code;
+    std::vector<BytecodeFunction> functions;
+    std::vector<std::string_view> globalNames;
+    std::vector<int64_t> globals;   // initial values
+    // Inline assembly has no meaning for the interpreter; its blocks are
+    // skipped and counted here so callers can warn about them
+    size_t skippedAssemblyBlocks = 0;
+
+    // Index into functions, or -1
+    [[nodiscard]] int FindFunction(std::string_view name) const;
+};
+
+// Lowers a checked Program to bytecode, making the same decisions as
+// CodeGenerator: the same frame slots, evaluation order and defaults.
+class BytecodeCompiler : private AstVisitor<BytecodeCompiler, uint32_t> {
+public:
+    BytecodeModule Compile(const Program& program);
+
+private:
+    friend class AstVisitor<BytecodeCompiler, uint32_t>;
+
+    void CompileFunction(const FunctionDeclaration& funcDecl);
+    void CompileStatement(const Statement& statement);
+    void CompileBlock(const BlockStatement& block);
+    // Evaluates an expression into some register and returns it
+    uint32_t CompileExpression(const Expression& expression);
+    // Evaluates an expression into register target
+    void CompileInto(const Expression& expression, uint32_t target);
+    // Gets the value of register value into register target
+    void MoveInto(uint32_t value, uint32_t target);
+    // Register holding the value of register value, of type from, as type to
+    uint32_t Convert(uint32_t value, Type from, Type to);
+    // Gets the value of register value, of type from, into register target as type to
+    void ConvertInto(uint32_t value, Type from, Type to, uint32_t target);
+    // Emits a jump taken when condition is false; its target is set later
+    // with PatchJump
+    size_t CompileBranchIfFalse(const Expression& condition);
+    // Points the jump at index jump to the next instruction emitted
+    void PatchJump(size_t jump);
+
+    uint32_t Temporary();
+    [[nodiscard]] uint32_t RegisterOf(const Identifier& ident) const;
+    [[nodiscard]] uint32_t GlobalOf(const Identifier& ident) const;
+    size_t Emit(BytecodeOp op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    [[nodiscard]] uint32_t Here() const { return static_cast<uint32_t>(module.code.size()); }
+
+    // Statements
+    uint32_t VisitVariableDeclaration(const VariableDeclaration& varDecl);
+    uint32_t VisitReturnStatement(const ReturnStatement& returnStmt);
+    uint32_t VisitExpressionStatement(const ExpressionStatement& exprStmt);
+    uint32_t VisitIfStatement(const IfStatement& ifStmt);
+    uint32_t VisitWhileStatement(const WhileStatement& whileStmt);
+    uint32_t VisitAssignmentStatement(const AssignmentStatement& assignStmt);
+    uint32_t VisitUnsafeStatement(const UnsafeStatement& unsafeStmt);
+    uint32_t VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign);
+    uint32_t VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt);
+
+    // Expressions, driven by WalkExpression: each finished operand leaves its
+    // register on values for the expression it belongs to. Leaves go through
+    // Visit.
+    const Expression* ResumeExpression(const Expression& expression, uint32_t step);
+    uint32_t VisitIntegerLiteral(const IntegerLiteral& intLiteral);
+    uint32_t VisitIdentifier(const Identifier& ident);
+    uint32_t VisitAddressOfExpression(const AddressOfExpression& addrOf);
+
+    template<typename T>
+    uint32_t VisitDefault(const T&) {
+        if constexpr (std::is_base_of_v<Expression, T>) {
+            throw std::runtime_error("Unknown expression type");
+        } else {
+            throw std::runtime_error("Unknown statement type");
+        }
+    }
+
+    BytecodeModule module;
+    // Function index and global index by interned name
+    std::vector<int32_t> functionIndex;
+    std::vector<int32_t> globalIndex;
+    // Declarations by function index, for the types of their parameters
+    std::vector<const FunctionDeclaration*> declarations;
+    // Register window of the function being compiled
+    uint32_t parameterCount = 0;
+    uint32_t firstTemporary = 0;
+    uint32_t nextTemporary = 0;
+    uint32_t frameSize = 0;
+    Type returnType;
+    std::vector<ExpressionStep> expressionStack;
+    std::vector<uint32_t> values;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Locale-independent character classification and bulk scanning kernels used
+// by the Lexer. The kernels process 32 (AVX2) or 16 (SSE2) bytes per step when
+// the compiler targets those instruction sets and fall back to a table-driven
+// scalar loop otherwise; they never read past the end of the view.
+namespace scan {
+
+    enum CharClass : uint8_t {
+        SPACE = 1 << 0,       // ' ', \t, \n, \v, \f, \r
+        IDENT_START = 1 << 1, // [A-Za-z_]
+        IDENT = 1 << 2,       // [A-Za-z0-9_]
+        DIGIT = 1 << 3,       // [0-9]
+        HEX_DIGIT = 1 << 4,   // [0-9A-Fa-f]
+        STRUCTURAL = 1 << 5,  // " / { } ; and NUL
+    };
+
+    constexpr std::array<uint8_t, 256> BuildCharClassTable() {
+        std::array<uint8_t, 256> table{};
+        for (int c = 0; c < 256; ++c) {
+            uint8_t bits = 0;
+            const bool lower = c >= 'a' && c <= 'z';
+            const bool upper = c >= 'A' && c <= 'Z';
+            const bool digit = c >= '0' && c <= '9';
+            if (c == ' ' || (c >= '\t' && c <= '\r')) bits |= SPACE;
+            if (lower || upper || c == '_') bits |= IDENT_START | IDENT;
+            if (digit) bits |= IDENT | DIGIT | HEX_DIGIT;
+            if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) bits |= HEX_DIGIT;
+            if (c == '"' || c == '/' || c == '{' || c == '}' || c == ';' || c == 0) bits |= STRUCTURAL;
+            table[c] = bits;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 256> CHAR_CLASS = BuildCharClassTable();
+
+    constexpr bool Is(const char c, const uint8_t classes) {
+        return (CHAR_CLASS[static_cast<unsigned char>(c)] & classes) != 0;
+    }
+
+    // Returns the first position at or after pos that is not whitespace
+    size_t SkipWhitespace(std::string_view text, size_t pos);
+
+    // Returns the first position at or after pos that is not an identifier character
+    size_t SkipIdentifier(std::string_view text, size_t pos);
+
+    // Returns the position of the first '\n' at or after pos, or text.size()
+    size_t FindNewline(std::string_view text, size_t pos);
+
+    // Returns the first position at or after pos of a STRUCTURAL character,
+    // or text.size(); these are all ParallelParser's pre-scan looks at
+    size_t FindStructural(std::string_view text, size_t pos);
+
+    // Name of the kernel set compiled in ("avx2", "sse2" or "scalar")
+    const char* KernelName();
+
+} // namespace scan
@@ -1,10 +1,16 @@
 
 #pragma once
 
-#include <sstream>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
 #include "AST.h"
+#include "AstVisitor.h"
+#include "MachineCode.h"
+#include "ModuleInterface.h"
+#include "OutputSink.h"
+#include "ThreadPool.h"
 #include <string>
-#include "SymbolTable.h"
 
 enum class APXC_OPERATION {
     APXC_COMPILE_W_ENTRY,
@@ -13,15 +19,107 @@ enum class APXC_OPERATION {
     APXC_UNKNOWN,
 };
 
-class CodeGenerator {
+enum class APXC_OUTPUT_FORMAT {
+    APXC_NASM,      // NASM source
+    APXC_OBJECT,    // ELF64 relocatable object
+    APXC_FORMAT_UNKNOWN,
+};
+
+class CodeGenerator : private AstVisitor<CodeGenerator> {
 public:
+    // With a pool, function bodies are generated concurrently and joined in
+    // source order; the output is identical either way.
+    explicit CodeGenerator(ThreadPool* pool = nullptr) : pool(pool) {}
+
+    // Declares the exports of an imported module as external symbols
+    void Import(const ModuleInterface& module);
+
+    // Lowers the program to machine code; the result refers into program
+    MachineModule Lower(const Program& program, APXC_OPERATION operation);
+    // Only generates the functions whose flag in stale is set, or that are
+    // past its end; the others are left named but empty, for a caller that
+    // kept their code from an earlier compile
+    MachineModule Lower(const Program& program, APXC_OPERATION operation, const std::vector<bool>& stale);
+    // Lowers the program and prints it as NASM source
     std::string Generate(const Program& program, APXC_OPERATION operation);
+    // Prints to out as functions are generated, so the whole text never has
+    // to be held in memory
+    void Generate(const Program& program, APXC_OPERATION operation, OutputSink& out);
 
 private:
-    void GenerateStatement(const Statement& statement);
-    void GenerateExpression(const Expression& expression);
+    friend class AstVisitor<CodeGenerator>;
+
+    void GenerateStatement(const Statement& statement) { Visit(statement); }
+    void GenerateExpression(const Expression& expression) { WalkExpression(expression, expressionStack); }
+    // Receives each generated function with its index in source order. With a
+    // pool it is called from several threads, and the function is scratch
+    // space that is reused once the call returns.
+    using FunctionConsumer = std::function<void(size_t, MachineFunction&)>;
+
+    MachineModule LowerDeclarations(const Program& program, APXC_OPERATION operation,
+                                    std::vector<const FunctionDeclaration*>& declarations, bool& hasMain);
+    void LowerEntry(MachineFunction& entry, bool hasMain);
+    [[nodiscard]] bool UsesPool(size_t functionCount) const;
+    void GenerateFunctions(const std::vector<const FunctionDeclaration*>& declarations,
+                           const FunctionConsumer& consume);
+    void GenerateFunction(const FunctionDeclaration& declaration, MachineFunction& generated);
+
+    void Emit(const Opcode op, const Operand& dst = {}, const Operand& src = {}) {
+        function->code.push_back({op, Cond::E, dst, src});
+    }
+    void Emit(const Opcode op, const Cond cond, const Operand& dst) {
+        function->code.push_back({op, cond, dst, {}});
+    }
+
+    // Statements
+    void VisitVariableDeclaration(const VariableDeclaration& varDecl);
+    void VisitReturnStatement(const ReturnStatement& returnStmt);
+    void VisitFunctionDeclaration(const FunctionDeclaration& funcDecl);
+    void VisitExpressionStatement(const ExpressionStatement& exprStmt);
+    void VisitIfStatement(const IfStatement& ifStmt);
+    void VisitWhileStatement(const WhileStatement& whileStmt);
+    void VisitAssignmentStatement(const AssignmentStatement& assignStmt);
+    void VisitUnsafeStatement(const UnsafeStatement& unsafeStmt);
+    void VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign);
+    void VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt);
+
+    // Expressions, driven by WalkExpression; leaves go through Visit
+    const Expression* ResumeExpression(const Expression& expression, uint32_t step);
+    void EmitInfixOperator(const InfixExpression& infix);
+    void EmitPrefixOperator(const PrefixExpression& prefix);
+    // Sets the flags for a value of type in rax being zero
+    void EmitTest(Type type);
+    // Reads a value of type into rax, extended to 64 bits
+    void EmitLoad(Operand source, Type type);
+    // Writes value, just generated into rax, to a variable of type
+    void EmitStore(Operand target, const Expression& value, Type type);
+    // Extends value, just generated into rax, when it is a 32-bit result
+    // that is used as a 64-bit value
+    void Widen(const Expression& value, Type to);
+    // Converts value, just generated into rax, to an extended value of type
+    // to, as it is returned
+    void Extend(const Expression& value, Type to);
+    void VisitIntegerLiteral(const IntegerLiteral& intLiteral);
+    void VisitIdentifier(const Identifier& ident);
+    void VisitAddressOfExpression(const AddressOfExpression& addrOf);
+
+    template<typename T>
+    void VisitDefault(const T&) {
+        if constexpr (std::is_base_of_v<Expression, T>) {
+            throw std::runtime_error("Unknown expression type");
+        } else {
+            throw std::runtime_error("Unknown statement type");
+        }
+    }
 
-    std::stringstream output;
-    SymbolTable symbolTable;
-    std::unordered_map<std::string, const FunctionDeclaration*> functions;
+    ThreadPool* pool;
+    std::vector<std::string_view> externs;
+    // Function currently being generated
+    MachineFunction* function = nullptr;
+    // Label numbers restart in every function: .else/.loop labels are NASM
+    // local labels scoped to the enclosing function label
+    int labelCounter = 0;
+    int loopCounter = 0;
+    Type returnType;
+    std::vector<ExpressionStep> expressionStack;
 };
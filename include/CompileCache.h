@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CodeGenerator.h"
+#include "ModuleInterface.h"
+
+// Content-addressed store of compiler outputs in a directory. Entries are
+// keyed by the source text, the operation, the output format, whether the
+// module interface is produced and a compiler identity string, so
+// a different compiler build or different flags never hit an older entry.
+// The cache is best effort: any I/O failure reads as a miss and is otherwise
+// ignored, and concurrent writers from several processes are safe because
+// entries are written to a temporary file and renamed into place.
+//
+// An entry also records the hash of every module interface the compile read,
+// and is a miss once any of them changed, so importers are rebuilt when a
+// module's exports change but not when only its function bodies do.
+class CompileCache {
+public:
+    CompileCache(std::string directory, std::string compilerIdentity);
+
+    [[nodiscard]] std::string Key(std::string_view source, APXC_OPERATION operation, APXC_OUTPUT_FORMAT format,
+                                  bool emitInterface) const;
+    bool Load(const std::string& key, const ModuleLoader& modules, std::string& output, std::string& interface) const;
+    void Store(const std::string& key, const std::vector<ModuleLoader::Dependency>& dependencies,
+               std::string_view output, std::string_view interface) const;
+
+private:
+    [[nodiscard]] std::string PathOf(const std::string& key) const;
+
+    std::string directory;
+    std::string compilerIdentity;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Compiler.h"
+
+// apxc --server keeps parsed sources and their outputs in memory across
+// compiles; apxc --connect forwards each input to it over a Unix socket.
+//
+// Every message on the socket is a native-endian uint32 byte count followed
+// by that many bytes. A request is an operation byte, a format byte and the source text; a
+// response is a success byte, the output text, the module interface and the
+// diagnostics, each string again length-prefixed. A connection may carry any
+// number of request/response pairs.
+//
+// The server has no import path, so sources that import modules fail there.
+
+// $XDG_RUNTIME_DIR/apxc.sock, or /tmp/apxc-<uid>.sock without it
+std::string DefaultServerSocketPath();
+
+class CompileServer {
+public:
+    explicit CompileServer(std::string socketPath);
+
+    // Serves until the process is terminated; returns nonzero if the socket
+    // could not be set up
+    int Run();
+
+private:
+    // One parsed source and the results already produced from it
+    struct CacheEntry {
+        std::mutex mutex;
+        std::unique_ptr<apx::ParsedUnit> unit;
+        std::optional<apx::CompileResult> results[static_cast<int>(APXC_OPERATION::APXC_UNKNOWN)]
+                                                 [static_cast<int>(APXC_OUTPUT_FORMAT::APXC_FORMAT_UNKNOWN)];
+        // Memory charged to the cache for it, guarded by cacheMutex; an
+        // evicted entry still in use by a connection is no longer charged
+        size_t bytes = 0;
+        bool cached = false;
+    };
+
+    void Serve(int client);
+    apx::CompileResult Compile(std::string source, APXC_OPERATION operation, APXC_OUTPUT_FORMAT format);
+    std::shared_ptr<CacheEntry> Lookup(std::string source);
+    // Adds bytes to what entry is charged and evicts the least recently used entries
+    // until the cache fits again; needs cacheMutex
+    void Charge(CacheEntry& entry, size_t bytes);
+
+    // Sources, ASTs and outputs kept in memory, roughly
+    static constexpr size_t MAX_CACHE_BYTES = size_t{512} << 20;
+
+    std::string socketPath;
+    std::mutex cacheMutex;
+    size_t cacheBytes = 0;
+    // Most recently used first; the map points into the list
+    std::list<std::pair<uint64_t, std::shared_ptr<CacheEntry>>> recent;
+    std::unordered_map<uint64_t, decltype(recent)::iterator> cache;
+};
+
+class CompileClient {
+public:
+    CompileClient() = default;
+    ~CompileClient();
+    CompileClient(const CompileClient&) = delete;
+    CompileClient& operator=(const CompileClient&) = delete;
+
+    bool Connect(const std::string& socketPath);
+    // Returns false if the server could not be reached or hung up
+    bool Compile(std::string_view source, APXC_OPERATION operation, APXC_OUTPUT_FORMAT format,
+                 apx::CompileResult& result);
+
+private:
+    int fd = -1;
+};
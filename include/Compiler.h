@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AST.h"
+#include "CodeGenerator.h"
+#include "ErrorReporter.h"
+#include "ModuleInterface.h"
+#include "OutputSink.h"
+#include "StringInterner.h"
+#include "ThreadPool.h"
+
+// Embeddable entry point of libapx.
+//
+// apx::Compile is reentrant: every call owns its interner, AST arena, Sema
+// and code generator, nothing is printed and no global state is touched, so
+// any number of threads may compile concurrently in one process. Objects are
+// encoded in process; only inline assembly the built-in encoder does not
+// understand is handed to an external `nasm`.
+namespace apx {
+
+    // Sizes of one compile's intermediate data, for apxc --stats. Token and
+    // node counts are only known when the call parses the source itself.
+    struct CompileStatistics {
+        size_t sourceBytes = 0;
+        size_t tokens = 0;
+        std::array<size_t, NODE_KIND_COUNT> nodes{};
+        size_t astBytesUsed = 0;
+        size_t astBytesReserved = 0;
+        size_t internedStrings = 0;
+        size_t functions = 0;
+        size_t globalSymbols = 0;
+        size_t peakLocalSymbols = 0;
+        size_t outputBytes = 0;
+    };
+
+    struct CompileOptions {
+        APXC_OPERATION operation = APXC_OPERATION::APXC_COMPILE_W_ENTRY;
+        APXC_OUTPUT_FORMAT format = APXC_OUTPUT_FORMAT::APXC_NASM;
+        // Optional pool for parsing large sources and for function-parallel
+        // code generation. It may be shared between concurrent calls, but
+        // must not be one whose worker is running this call (the call blocks
+        // waiting on the pool).
+        ThreadPool* pool = nullptr;
+        // Filled in when set
+        CompileStatistics* statistics = nullptr;
+        // When set, the output is appended here as it is produced instead of
+        // being returned in CompileResult::output. It is not flushed, and may
+        // hold partial output when the compile fails.
+        OutputSink* output = nullptr;
+        // Finds the interfaces of imported modules; without one, importing
+        // anything is an error
+        ModuleLoader* modules = nullptr;
+        // Also return the interface of the module's exports
+        bool emitInterface = false;
+    };
+
+    struct CompileResult {
+        bool success = false;
+        // NASM source or object file bytes, or the AST dump for APXC_PREPROCESS;
+        // empty when CompileOptions::output is set
+        std::string output;
+        // The .apxi bytes when CompileOptions::emitInterface is set and the
+        // module exports anything
+        std::string interface;
+        // Parse errors in source order, otherwise at most one semantic error
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    CompileResult Compile(std::string_view source, const CompileOptions& options = {});
+
+    // A parsed source that can be compiled repeatedly. It owns a copy of the
+    // source and the interner the AST points into, so it outlives the input.
+    struct ParsedUnit {
+        std::string source;
+        StringInterner interner;
+        std::unique_ptr<Program> program;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    // A pool, when given, parses large sources in parallel
+    std::unique_ptr<ParsedUnit> Parse(std::string source, ThreadPool* pool = nullptr);
+
+    // Compiling annotates the unit's AST, so calls on the same unit must not
+    // overlap; distinct units are independent.
+    CompileResult Compile(const ParsedUnit& unit, const CompileOptions& options = {});
+
+    // Compiles source to machine code in memory and calls its main; on
+    // success exitCode is main's return value. Runs entirely in process, so
+    // inline assembly the built-in encoder does not understand is an error.
+    // options.operation and options.format are ignored.
+    CompileResult Run(std::string_view source, int& exitCode, const CompileOptions& options = {});
+
+    // Like Run, but executes the program on the bytecode interpreter, which
+    // needs no executable memory. Inline assembly is skipped; when any was,
+    // the successful result carries a diagnostic saying so.
+    CompileResult Interpret(std::string_view source, int& exitCode);
+
+    // Identifies the build of libapx this is, from the path, size and
+    // modification time of the file its code was loaded from, so caches of
+    // compiled output can tell a rebuilt or updated library from the old one
+    std::string BuildIdentity();
+
+    // Compiles successive versions of one source, as apxc --watch does. Each
+    // compile parses and checks the whole source, but only generates the
+    // functions whose AST changed since the previous successful compile, or
+    // whose globals or callees changed meaning; the others keep the code
+    // generated then. The output is the same as a fresh Compile's.
+    // options.output and options.statistics are ignored.
+    class IncrementalCompiler {
+    public:
+        explicit IncrementalCompiler(const CompileOptions& options);
+
+        // Interfaces can change between compiles, so modules, when set, is
+        // used instead of options.modules, letting each compile load them
+        // afresh
+        CompileResult Compile(std::string_view source, ModuleLoader* modules = nullptr);
+
+        // Functions the last Compile generated and reused
+        [[nodiscard]] size_t GetGeneratedCount() const { return generatedCount; }
+        [[nodiscard]] size_t GetReusedCount() const { return reusedCount; }
+
+    private:
+        // NASM text for the NASM format, machine code for objects
+        struct CachedFunction {
+            uint64_t hash = 0;
+            std::string text;
+            MachineFunction code;
+        };
+
+        CachedFunction Cache(uint64_t hash, const MachineFunction& function);
+
+        CompileOptions options;
+        // Owns the names the cached code refers to, which outlive the
+        // Program they were generated from
+        StringInterner names;
+        std::unordered_map<std::string_view, CachedFunction> functions;
+        size_t generatedCount = 0;
+        size_t reusedCount = 0;
+    };
+
+} // namespace apx
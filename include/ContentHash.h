@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a. Used to key caches by file contents; callers that cannot
+// tolerate a collision compare the stored bytes on a hit.
+constexpr uint64_t HashBytes(const std::string_view bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (const char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
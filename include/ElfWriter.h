@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include "X86Encoder.h"
+
+// Writes an encoded module as an ELF64 relocatable object (ET_REL), the same
+// kind of file `nasm -f elf64` produces, ready for ld or cc to link
+namespace elf {
+
+    std::string WriteObject(const x86::EncodedModule& module);
+
+} // namespace elf
@@ -1,19 +1,25 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+struct Diagnostic {
+    std::string message;
+    // -1 when the error has no source position
+    int line = -1;
+    int column = -1;
+};
+
 class ErrorReporter {
 public:
     void AddError(const std::string& message, int line, int column);
     [[nodiscard]] bool HasErrors() const;
-    void PrintErrors() const;
+    [[nodiscard]] const std::vector<Diagnostic>& GetErrors() const { return errors; }
+    // Prefixes each message with source when it is not empty
+    void PrintErrors(std::string_view source = {}) const;
+    static void Print(const Diagnostic& diagnostic, std::string_view source = {});
 
 private:
-    struct Error {
-        std::string message;
-        int line;
-        int column;
-    };
-    std::vector<Error> errors;
-};
\ No newline at end of file
+    std::vector<Diagnostic> errors;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Waits for files to be saved, for apxc --watch. It watches the directories
+// the files are in rather than the files themselves: many editors save by
+// writing a new file and renaming it over the old one, which would end a
+// watch on the old file.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // False when inotify is unavailable or the file's directory cannot be
+    // watched
+    bool Add(const std::string& path);
+
+    // Blocks until at least one file was written, then until the burst of
+    // events a save produces has settled. Returns the indices, in the order
+    // they were added, of the files that changed; empty when waiting failed.
+    std::vector<size_t> Wait();
+
+private:
+    struct WatchedFile {
+        int directory;
+        std::string name;
+    };
+
+    int fd;
+    std::vector<WatchedFile> files;
+};
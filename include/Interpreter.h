@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "Bytecode.h"
+
+// Runs BytecodeModule functions. Dispatch is threaded through a table of
+// label addresses (computed goto) where the compiler supports it, and falls
+// back to a switch elsewhere or when APX_VM_NO_COMPUTED_GOTO is defined.
+//
+// Values behave like the native code's: wrapping arithmetic at the width of
+// their type, and pointers are real addresses of registers and globals, so &x
+// and *p work as they do natively. Stores through pointers write the whole
+// 8-byte cell, which only differs from native code when a cell is written
+// through a pointer to a narrower type than its own. Globals keep their values from one Call to the next.
+class Interpreter {
+public:
+    // Registers available to all active frames together
+    static constexpr size_t DEFAULT_STACK_REGISTERS = 1u << 20;
+
+    explicit Interpreter(const BytecodeModule& module, size_t stackRegisters = DEFAULT_STACK_REGISTERS);
+
+    // Calls functions[function] and returns its result. Throws
+    // std::runtime_error on division by zero or when the stack runs out.
+    int64_t Call(uint32_t function, std::initializer_list<int64_t> arguments = {});
+
+private:
+    struct Frame {
+        const BytecodeInstruction* returnAddress;
+        int64_t* registers;
+    };
+
+    int64_t Execute(const BytecodeFunction& function);
+
+    const BytecodeModule& module;
+    std::vector<int64_t> globals;
+    std::vector<int64_t> stack;
+    std::vector<Frame> frames;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "X86Encoder.h"
+
+// An encoded module loaded into executable memory of this process. Code and
+// data are copied into fresh pages and relocated while writable, then the
+// code pages are flipped to read+execute, so no page is ever writable and
+// executable at once. The memory is unmapped when the module is destroyed.
+class JitModule {
+public:
+    // Throws std::runtime_error if memory cannot be mapped or the module
+    // refers to a symbol it does not define
+    explicit JitModule(const x86::EncodedModule& module);
+    ~JitModule();
+    JitModule(const JitModule&) = delete;
+    JitModule& operator=(const JitModule&) = delete;
+
+    // Address of a function or variable, or nullptr if there is none
+    [[nodiscard]] void* Lookup(std::string_view name) const;
+
+    // Calls a function of the module that takes no arguments and returns its
+    // rax. Generated code and inline assembly may clobber any register, so the
+    // call goes through a stub that preserves the callee-saved ones.
+    int64_t Call(void* function) const;
+
+private:
+    void* memory = nullptr;
+    size_t size = 0;
+    const char* trampoline = nullptr;
+    std::unordered_map<std::string, char*> symbols;
+};
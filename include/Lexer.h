@@ -2,7 +2,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include "StringInterner.h"
 
 enum class TokenType {
     // Special
@@ -64,6 +66,7 @@ enum class TokenType {
     Mut,
     Ref,
     Deref,
+    Import,
     
     // Special content
     RawAssembly,
@@ -71,29 +74,48 @@ enum class TokenType {
 
 std::string TokenTypeToString(TokenType type);
 
+// The literal views either a static spelling or a range of the lexer input,
+// so tokens are only valid while the input buffer they came from is alive.
+// Identifier tokens also carry their interned symbol. Where a token is is
+// kept as a byte offset; Lexer::Locate turns it into a line and column.
 struct Token {
     TokenType type;
-    std::string literal;
+    std::string_view literal;
+    Symbol symbol = INVALID_SYMBOL;
+    size_t offset = 0;
+};
+
+// One-based line and column in the lexer input
+struct SourceLocation {
+    int line;
+    int column;
 };
 
 class Lexer {
 public:
-    explicit Lexer(std::string input);
+    // Starts reading at offset start; tokens still carry offsets into the
+    // whole input
+    Lexer(std::string_view input, StringInterner& interner, size_t start = 0);
     Token NextToken();
     Token ReadRawAssemblyToken(); // For inline assembly
     size_t GetPosition() const { return position; }
-    const std::string& GetInput() const { return input; }
-    int GetLine() const { return line; }
-    int GetColumn() const { return column; }
+    std::string_view GetInput() const { return input; }
+    StringInterner& GetInterner() const { return interner; }
+    // Where the byte at offset is. Lines are only looked up on demand, so the
+    // first call indexes the newlines of the whole input.
+    SourceLocation Locate(size_t offset) const;
 
 private:
     void NextChar();
-    static TokenType LookupIdent(const std::string& ident);
+    void Seek(size_t newPosition);
+    void SkipTrivia();
+    char PeekChar() const { return readPosition < input.size() ? input[readPosition] : 0; }
+    static TokenType LookupIdent(std::string_view ident);
 
-    std::string input;
+    std::string_view input;
+    StringInterner& interner;
     size_t position;
     size_t readPosition;
     char ch;
-    int line;
-    int column;
+    mutable std::vector<size_t> lineStarts; // Filled by the first Locate
 };
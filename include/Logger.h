@@ -4,8 +4,9 @@
 #include <mutex>
 #include <chrono>
 #include <ctime>
-#include <sstream>
 #include <filesystem>
+#include <iterator>
+#include <string_view>
 // ====== CONFIGURATION: Compile-time flags ======
 // Define these in CMake or via compiler flags (-DLOG_DISABLE, etc.)
 
@@ -40,6 +41,13 @@
     #define LOG_THREAD_SAFE
 #endif
 
+// Queue records on per-thread lock-free rings that one background thread
+// writes out, so logging threads never wait for each other or for the
+// terminal. out::flush() waits for everything queued so far.
+#ifndef LOG_ASYNC
+// #define LOG_ASYNC
+#endif
+
 // Default output stream for info/success/command
 #ifndef LOG_DEFAULT_STREAM
     #define LOG_DEFAULT_STREAM stdout
@@ -67,19 +75,22 @@ struct fmt::formatter<fs::path> : formatter<std::string_view> {
     #define LOG_LOCK()
 #endif
 
+namespace out::detail {
+    // Appends the current local time as YYYY-MM-DD HH:MM:SS.mmm. The date and
+    // time are only reformatted when the second changes, per thread.
+    void append_timestamp(fmt::memory_buffer& buffer);
+    // Writes one complete record to stream, or queues it with LOG_ASYNC
+    void write_record(FILE* stream, std::string_view record);
+} // namespace out::detail
+
 // Helper to format timestamp: YYYY-MM-DD HH:MM:SS.mmm
 inline std::string now_str() {
 #ifdef LOG_DISABLE_TIMESTAMP
     return "YYYY-MM-DD HH:MM:SS.000"; // placeholder
 #else
-    const auto now = std::chrono::system_clock::now();
-    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    const auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    fmt::memory_buffer buffer;
+    out::detail::append_timestamp(buffer);
+    return fmt::to_string(buffer);
 #endif
 }
 
@@ -104,25 +115,36 @@ inline std::string now_str() {
 
 namespace out {
 
-    // Generic log function with stream and color
+    // Generic log function with stream and color. The record is put together
+    // on the calling thread and written with a single call.
     template<typename... T>
     void log_impl(const fmt::text_style style, FILE* stream, const char* level, fmt::format_string<T...> fmt, T&&... args) {
-        LOG_LOCK();
-        std::string time_str = now_str();
-
-        // Format the message
-        auto msg = fmt::format(fmt, std::forward<T>(args)...);
+        fmt::memory_buffer record;
+        auto it = std::back_inserter(record);
+#ifdef LOG_DISABLE_TIMESTAMP
+        const std::string_view time_str = "YYYY-MM-DD HH:MM:SS.000"; // placeholder
+#else
+        fmt::memory_buffer stamp;
+        detail::append_timestamp(stamp);
+        const std::string_view time_str(stamp.data(), stamp.size());
+#endif
 
         // Output with or without color
 #ifdef LOG_DISABLE_COLORS
-        fmt::print(stream, "[{}] [{}] {}", time_str, level, msg);
+        (void)style;
+        fmt::format_to(it, "[{}] [{}] ", time_str, level);
 #else
-        fmt::print(stream, style, "[{}] [{}] ", time_str, level);
-        fmt::print(stream, "{}", msg); // Avoid color reset interference
+        fmt::format_to(it, style, "[{}] [{}] ", time_str, level);
 #endif
-        fmt::print(stream, "\n");
+        fmt::format_to(it, fmt, std::forward<T>(args)...); // Avoid color reset interference
+        record.push_back('\n');
+        detail::write_record(stream, std::string_view(record.data(), record.size()));
     }
 
+    // Waits until every record logged so far has been written; only needed
+    // before writing to the log streams by other means
+    void flush();
+
     // Individual log functions (conditionally compiled)
 
 #ifndef LOG_DISABLE_INFO
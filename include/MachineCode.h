@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Machine-level form of a module, between code generation and output. The
+// CodeGenerator lowers the AST into it once; NasmPrinter renders it as NASM
+// source and X86Encoder turns it into machine code for an ELF object or the
+// JIT. Names are views into the Program (interner and arena), so a module must
+// not outlive the Program it was generated from.
+
+enum class Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// Values are the x86 condition-code nibble. Z and NZ encode like E and NE and
+// only differ in how they are printed.
+enum class Cond : uint8_t {
+    O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G,
+    Z = 0x10 | 0x4,
+    NZ = 0x10 | 0x5,
+};
+
+enum class Opcode : uint8_t {
+    Label,      // defines dst (a label) here
+    Raw,        // dst.name is one line of inline assembly, emitted verbatim
+    Mov, Movzx, Movsx, Lea, Push, Pop,
+    Add, Or, And, Sub, Xor, Cmp, Test, Imul,
+    Neg, Not, Idiv, Div, Cqo, Cdq,
+    Set,        // setcc dst
+    Jmp, Jcc, Call,
+    Leave, Ret, Syscall, Nop,
+};
+
+struct Operand {
+    enum class Kind : uint8_t {
+        None,
+        Reg,    // reg
+        Imm,    // value
+        Mem,    // [reg + value]
+        Global, // [name], RIP-relative
+        Symbol, // name as a branch target
+        Label,  // function-local label name followed by value, e.g. .else3
+    };
+
+    Kind kind = Kind::None;
+    Reg reg = Reg::RAX;
+    // Operand size in bytes (1, 2, 4 or 8) for registers and memory
+    uint8_t size = 8;
+    int64_t value = 0;
+    std::string_view name;
+
+    static constexpr Operand Register(const Reg reg, const uint8_t size = 8) {
+        Operand op; op.kind = Kind::Reg; op.reg = reg; op.size = size; return op;
+    }
+    static constexpr Operand Immediate(const int64_t value) {
+        Operand op; op.kind = Kind::Imm; op.value = value; return op;
+    }
+    static constexpr Operand Memory(const Reg base, const int32_t displacement = 0, const uint8_t size = 8) {
+        Operand op; op.kind = Kind::Mem; op.reg = base; op.value = displacement; op.size = size; return op;
+    }
+    static constexpr Operand Global(const std::string_view name, const uint8_t size = 8) {
+        Operand op; op.kind = Kind::Global; op.name = name; op.size = size; return op;
+    }
+    static constexpr Operand Symbol(const std::string_view name) {
+        Operand op; op.kind = Kind::Symbol; op.name = name; return op;
+    }
+    static constexpr Operand Label(const std::string_view prefix, const int64_t number) {
+        Operand op; op.kind = Kind::Label; op.name = prefix; op.value = number; return op;
+    }
+};
+
+struct Instruction {
+    Opcode op;
+    Cond cond = Cond::E;
+    Operand dst;
+    Operand src;
+};
+
+struct MachineFunction {
+    std::string_view name;
+    std::vector<Instruction> code;
+};
+
+// One initialized variable in the data section
+struct DataItem {
+    std::string_view name;
+    int alignment = 0;
+    uint8_t size = 8;     // dd (4) or dq (8)
+    bool isFloat = false;
+    int64_t intValue = 0;
+    double floatValue = 0;
+};
+
+struct MachineModule {
+    std::vector<DataItem> data;
+    // Exported symbol names, in the order they are declared global
+    std::vector<std::string_view> globals;
+    // Symbols of imported modules, defined by other objects
+    std::vector<std::string_view> externs;
+    std::vector<MachineFunction> functions;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AST.h"
+#include "SourceFile.h"
+
+// What importers of a module see: its exported (#[global]) functions and
+// variables. Compiling a module writes this as a binary .apxi file, which
+// importers map and read in place instead of lexing and parsing the module.
+//
+// The file is native-endian: the magic "APXI", then uint32 version, function
+// count and variable count; a uint32 name offset, name length, return type,
+// first parameter type and parameter count per function; a uint32 name
+// offset, name length, flags and type per variable; the uint32 parameter
+// types of all functions; and last the string table the name offsets point
+// into. A type is its base type with the pointer depth in bits 8 to 15.
+struct ModuleInterface {
+    struct Function {
+        std::string_view name;
+        Type returnType;
+        std::vector<Type> parameterTypes;
+    };
+    struct Variable {
+        std::string_view name;
+        bool isConst;
+        Type type;
+    };
+
+    std::vector<Function> functions;
+    std::vector<Variable> variables;
+};
+
+namespace apxi {
+
+    // Interface of the exported declarations of a program Sema has checked;
+    // empty when there are none
+    std::string Write(const Program& program);
+
+    // The result views into bytes. Throws std::runtime_error when bytes are
+    // not an interface this compiler writes.
+    ModuleInterface Read(std::string_view bytes);
+
+    // Modules source imports, in order, without parsing it
+    std::vector<std::string> ScanImports(std::string_view source);
+
+} // namespace apxi
+
+// Finds the interfaces of imported modules: module name is name.apxi in the
+// first directory of the search path that has one. Interfaces stay mapped,
+// and the views into them valid, for as long as the loader lives. One loader
+// serves one compile at a time.
+class ModuleLoader {
+public:
+    explicit ModuleLoader(std::vector<std::string> searchPath);
+
+    // nullptr when no directory has the module; throws std::runtime_error for
+    // a file that is not a valid interface
+    const ModuleInterface* Load(std::string_view name);
+
+    // An interface a compile read, by module name and content hash
+    struct Dependency {
+        std::string name;
+        uint64_t hash;
+    };
+    // Every interface loaded so far, in the order they were first loaded
+    [[nodiscard]] std::vector<Dependency> GetDependencies() const;
+    // Hash of the interface Load would find for name now, 0 when there is none
+    [[nodiscard]] uint64_t HashOf(std::string_view name) const;
+
+private:
+    struct Module {
+        SourceFile file;
+        ModuleInterface interface;
+        uint64_t hash;
+    };
+
+    [[nodiscard]] std::string Find(std::string_view name) const;
+
+    std::vector<std::string> searchPath;
+    std::unordered_map<std::string, std::unique_ptr<Module>> modules; // nullptr: not found
+    std::vector<std::string> loadOrder;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include "MachineCode.h"
+#include "OutputSink.h"
+
+// Renders machine code as NASM source for `nasm -f elf64`
+namespace nasm {
+
+    std::string Print(const MachineModule& module);
+    // The data section and the directives before the first function
+    void PrintHeader(OutputSink& out, const MachineModule& module);
+    void PrintFunction(OutputSink& out, const MachineFunction& function);
+    void PrintInstruction(OutputSink& out, const Instruction& instruction);
+
+    // Spelling of a data-section float: the default iostream format, which is
+    // also what the object writer reads back so both outputs agree
+    std::string FormatFloat(double value);
+
+    const char* RegisterName(Reg reg, uint8_t size = 8);
+    const char* ConditionName(Cond cond);
+
+} // namespace nasm
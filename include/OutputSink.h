@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "SourceFile.h"
+
+// Append-only destination for generated output. Appends are copied into a
+// fixed buffer that is handed to the drain when it fills up and on Flush(),
+// so printers can emit many small pieces without touching the destination
+// each time. Text too large to buffer is passed to the drain next to the
+// buffered bytes instead of being copied, letting a file drain write both
+// with one writev.
+class OutputSink {
+public:
+    // Receives the buffered bytes, then text; returns false on a write error
+    using Drain = std::function<bool(std::string_view buffered, std::string_view text)>;
+
+    static constexpr size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit OutputSink(Drain drain, size_t capacity = DEFAULT_CAPACITY);
+    // Appends to target; the in-memory sink of the library API
+    explicit OutputSink(std::string& target, size_t capacity = DEFAULT_CAPACITY);
+    ~OutputSink() { Flush(); }
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void Append(const std::string_view text) {
+        if (text.size() > static_cast<size_t>(limit - cursor)) {
+            AppendSlow(text);
+            return;
+        }
+        std::memcpy(cursor, text.data(), text.size());
+        cursor += text.size();
+    }
+
+    void Append(const char c) {
+        if (cursor == limit) {
+            AppendSlow(std::string_view(&c, 1));
+            return;
+        }
+        *cursor++ = c;
+    }
+
+    void Append(size_t count, char c);
+
+    OutputSink& operator+=(const std::string_view text) {
+        Append(text);
+        return *this;
+    }
+
+    OutputSink& operator+=(const char c) {
+        Append(c);
+        return *this;
+    }
+
+    // Drains everything buffered; false once any drain has failed
+    bool Flush();
+    // Bytes appended so far, drained or not
+    [[nodiscard]] size_t Size() const { return drained + static_cast<size_t>(cursor - buffer.get()); }
+
+private:
+    void AppendSlow(std::string_view text);
+
+    Drain drain;
+    std::unique_ptr<char[]> buffer;
+    char* cursor;
+    char* limit;
+    size_t drained = 0;
+    bool failed = false;
+};
+
+// Drain for an OutputSink that writes a file with write()/writev() as the
+// output arrives, instead of holding it all in memory first. While the output
+// matches what an existing file already holds nothing is written, and a file
+// that ends up identical is left untouched, timestamp included, so build
+// tools do not redo the steps that depend on it. Anything but a regular file,
+// such as /dev/stdout or a FIFO, is written straight away.
+class FileOutput {
+public:
+    explicit FileOutput(std::string path);
+    ~FileOutput();
+    FileOutput(const FileOutput&) = delete;
+    FileOutput& operator=(const FileOutput&) = delete;
+
+    bool Write(std::string_view first, std::string_view second = {});
+    // Cuts the file to the length written; false if anything failed
+    bool Finish();
+    // Removes the file if rewriting it has begun; for a compile that failed
+    // after part of its output was written
+    void Abandon();
+
+private:
+    bool StartWriting();
+
+    std::string path;
+    SourceFile existing;
+    bool existed;
+    bool matching = true;
+    size_t matched = 0;
+    int fd = -1;
+    size_t written = 0;
+    bool failed = false;
+};
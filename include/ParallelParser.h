@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "AST.h"
+#include "ErrorReporter.h"
+#include "StringInterner.h"
+#include "ThreadPool.h"
+
+// Parses a whole source like Parser::ParseProgram, but splits it into runs
+// of top-level items that are lexed and parsed on a pool's workers. Each run
+// gets its own parser, arena and interner; they are merged in source order
+// into one Program whose nodes, symbols and diagnostics are exactly those of
+// a serial parse. When a run does not end where the next one begins, which
+// malformed input can cause, the source is parsed again serially.
+class ParallelParser {
+public:
+    ParallelParser(std::string_view source, StringInterner& interner, ErrorReporter& errorReporter, ThreadPool& pool);
+
+    std::unique_ptr<Program> ParseProgram();
+
+    // Same as Parser's, for --stats
+    [[nodiscard]] size_t GetTokenCount() const { return tokenCount; }
+    [[nodiscard]] const std::array<size_t, NODE_KIND_COUNT>& GetNodeCounts() const { return nodeCounts; }
+
+    // Offsets at which up to pieces runs of items start, the first being 0.
+    // A run starts at the first token after a ';' or '}' that brings brace
+    // depth back to zero, skipping strings and comments, unless that token
+    // is an else continuing the statement.
+    static std::vector<size_t> FindSplitPoints(std::string_view source, size_t pieces);
+
+private:
+    std::unique_ptr<Program> ParseSerially();
+
+    // Runs smaller than this are not worth a worker
+    static constexpr size_t MIN_PIECE_BYTES = 64 * 1024;
+
+    std::string_view source;
+    StringInterner& interner;
+    ErrorReporter& errorReporter;
+    ThreadPool& pool;
+    size_t tokenCount = 0;
+    std::array<size_t, NODE_KIND_COUNT> nodeCounts{};
+};
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <unordered_map>
 #include "Lexer.h"
 #include "AST.h"
@@ -19,41 +23,88 @@ class Parser {
 public:
     explicit Parser(Lexer& lexer, ErrorReporter& errorReporter);
 
-    std::unique_ptr<Program> ParseProgram();
+    // Parses top-level statements until the one starting at or after end
+    std::unique_ptr<Program> ParseProgram(size_t end = SIZE_MAX);
+
+    // Offset of the token the parser stopped at
+    [[nodiscard]] size_t GetOffset() const { return currentToken.offset; }
+
+    // Collects every Identifier created from now on
+    void LogIdentifiers(std::vector<Identifier*>* log) { identifierLog = log; }
+
+    // Tokens pulled from the lexer and nodes allocated so far, for --stats
+    [[nodiscard]] size_t GetTokenCount() const { return tokenCount; }
+    [[nodiscard]] const std::array<size_t, NODE_KIND_COUNT>& GetNodeCounts() const { return nodeCounts; }
 
 private:
     void NextToken();
-    std::unique_ptr<Statement> ParseStatement();
-    std::unique_ptr<VariableDeclaration> ParseVariableDeclaration();
-    std::unique_ptr<VariableDeclaration> ParseConstDeclaration();
-    std::unique_ptr<ReturnStatement> ParseReturnStatement();
-    std::unique_ptr<ExpressionStatement> ParseExpressionStatement();
-    std::unique_ptr<BlockStatement> ParseBlockStatement();
-    std::unique_ptr<FunctionDeclaration> ParseFunctionDeclaration();
-    std::unique_ptr<IfStatement> ParseIfStatement();
-    std::unique_ptr<WhileStatement> ParseWhileStatement();
-    std::unique_ptr<AssignmentStatement> ParseAssignmentStatement();
-    std::unique_ptr<UnsafeStatement> ParseUnsafeStatement();
-    std::unique_ptr<DereferenceAssignmentStatement> ParseDereferenceAssignmentStatement();
-    std::unique_ptr<InlineAssemblyStatement> ParseInlineAssemblyStatement();
-    std::unique_ptr<CallExpression> ParseCallExpression(std::unique_ptr<Expression> function);
-    std::unique_ptr<Expression> ParsePrefixExpression();
-    std::unique_ptr<Expression> ParseExpression(int precedence);
-    std::vector<std::unique_ptr<Attribute>> ParseAttributes();
-    std::unique_ptr<Attribute> ParseAttribute();
+    Statement* ParseStatement();
+    VariableDeclaration* ParseVariableDeclaration();
+    VariableDeclaration* ParseConstDeclaration();
+    ReturnStatement* ParseReturnStatement();
+    ExpressionStatement* ParseExpressionStatement();
+    BlockStatement* ParseBlockStatement();
+    FunctionDeclaration* ParseFunctionDeclaration();
+    IfStatement* ParseIfStatement();
+    WhileStatement* ParseWhileStatement();
+    AssignmentStatement* ParseAssignmentStatement();
+    UnsafeStatement* ParseUnsafeStatement();
+    DereferenceAssignmentStatement* ParseDereferenceAssignmentStatement();
+    InlineAssemblyStatement* ParseInlineAssemblyStatement();
+    ImportDeclaration* ParseImportDeclaration();
+    // A type such as `u8` or `**i32`, as one identifier spelled that way
+    Identifier* ParseType(const char* error);
+    Expression* ParseOperand();
+    Expression* ParseExpression(int precedence);
+    void SkipBlock();
+    std::vector<Attribute*> ParseAttributes();
+    Attribute* ParseAttribute();
     
     // Legacy alias
-    std::unique_ptr<LetStatement> ParseLetStatement() { return ParseVariableDeclaration(); }
+    LetStatement* ParseLetStatement() { return ParseVariableDeclaration(); }
 
     Lexer& lexer;
     ErrorReporter& errorReporter;
+    Program* program = nullptr;
     Token currentToken;
     Token peekToken;
-    static std::unordered_map<TokenType, Precedence> precedences;
+    size_t tokenCount = 0;
+    std::array<size_t, NODE_KIND_COUNT> nodeCounts{};
+    std::vector<Identifier*>* identifierLog = nullptr;
+    static const std::unordered_map<TokenType, Precedence> precedences;
+
+    // An expression ParseExpression has started but not finished: it waits
+    // for the operand being parsed, then goes on at the precedence it was
+    // parsed at. Kept on the heap rather than the native stack so generated
+    // code with absurdly deep expressions cannot overflow it.
+    struct ExpressionFrame {
+        enum Kind : uint8_t { Prefix, Dereference, AddressOf, Group, Infix, Argument };
+        Kind kind;
+        int precedence;
+        Expression* node;
+        size_t firstArgument; // Argument only: where its list starts in arguments
+    };
+    std::vector<ExpressionFrame> expressionFrames;
+    std::vector<Expression*> arguments; // Arguments of the calls being parsed
+
+    // Statements still recurse once per block, so nesting is capped to keep
+    // the parser and every pass after it well inside a thread's stack
+    static constexpr int MAX_BLOCK_DEPTH = 4096;
+    int blockDepth = 0;
     
     // Helper methods
+    void AddError(const std::string& message, const Token& token);
     bool ExpectPeek(TokenType type);
     bool CurrentTokenIs(TokenType type) const;
     bool PeekTokenIs(TokenType type) const;
     Precedence GetPrecedence(TokenType type) const;
+
+    // Allocates a node in the arena of the program being parsed
+    template<typename T>
+    T* Make() {
+        ++nodeCounts[static_cast<size_t>(T::Kind)];
+        return program->arena.New<T>();
+    }
+    Identifier* MakeIdentifier(const Token& token);
+    Identifier* MakeIdentifier(std::string_view name);
 };
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ====== CONFIGURATION: Compile-time flags ======
+// Define in CMake or via compiler flags (-DPROFILE_DISABLE)
+
+// Compile out all phase timing and tracing; PROFILE_SCOPE expands to nothing
+#ifndef PROFILE_DISABLE
+// #define PROFILE_DISABLE
+#endif
+
+// ===============================================
+
+// Phase timing for --time-report and Chrome trace-event output for --trace.
+// Collection is off until Enable() is called; until then a scope costs one
+// relaxed atomic load. Spans may be recorded from any thread.
+namespace profile {
+
+    // Span categories
+    constexpr const char* PHASE = "phase";
+    constexpr const char* FUNCTION = "function";
+
+    void Enable();
+    bool IsEnabled();
+
+    class Scope {
+    public:
+        Scope(const char* category, std::string_view name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool active;
+        const char* category;
+        std::string_view name;
+        int64_t wallStart = 0;
+        int64_t cpuStart = 0;
+    };
+
+    // Recorded spans summed by name, in the order each name first finished
+    struct Total {
+        std::string name;
+        const char* category;
+        size_t count = 0;
+        double wallMilliseconds = 0;
+        double cpuMilliseconds = 0;
+    };
+
+    std::vector<Total> Totals();
+    // Prints the totals as a table to stderr
+    void PrintReport();
+    // Writes every span in the Chrome trace-event JSON format
+    // (chrome://tracing, Perfetto)
+    bool WriteTrace(const std::string& path);
+    // Discards the spans recorded so far
+    void Reset();
+
+} // namespace profile
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILE_DISABLE
+    #define PROFILE_SCOPE(category, name) ((void)0)
+    #define PROFILE_ENABLED() false
+#else
+    #define PROFILE_SCOPE(category, name) ::profile::Scope PROFILE_CONCAT(profileScope, __LINE__)(category, name)
+    #define PROFILE_ENABLED() ::profile::IsEnabled()
+#endif
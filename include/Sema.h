@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include "AST.h"
+#include "AstVisitor.h"
+#include "ModuleInterface.h"
+#include "SymbolTable.h"
+
+// Semantic analysis between the Parser and the back ends. Binds every
+// identifier use in a Program to its storage slot, gives every expression its
+// type and every operator its meaning, infers the types of `:=` declarations
+// and checks calls, assignments and returns, so code generation emits loads,
+// stores and operators of the right width without looking anything up or
+// checking anything. Walks functions exactly the way CodeGenerator emits them
+// and throws std::runtime_error for the first error.
+//
+// Integers convert to each other implicitly, wrapping or extending as C does,
+// integers become pointers and pointers 64-bit integers. Arithmetic is on
+// integers only; floating-point values are limited to global initializers.
+class Sema : private AstVisitor<Sema> {
+public:
+    explicit Sema(const StringInterner& interner);
+    // Makes the exports of an imported module callable and addressable; call
+    // for every import before Check
+    void Import(const ModuleInterface& module);
+    void Check(const Program& program);
+
+    [[nodiscard]] const SymbolTable& GetSymbolTable() const { return symbolTable; }
+    [[nodiscard]] size_t GetFunctionCount() const;
+
+private:
+    friend class AstVisitor<Sema>;
+
+    struct Function {
+        bool defined = false;
+        bool imported = false;
+        Type returnType;
+        std::vector<Type> parameterTypes;
+    };
+
+    Function& FunctionAt(Symbol name);
+    void DeclareGlobal(const VariableDeclaration& varDecl);
+    void DeclareFunction(const FunctionDeclaration& funcDecl);
+    const SymbolTable::Entry& Bind(const Identifier& ident) const;
+    void CheckConversion(const Expression& value, Type to, std::string_view context, std::string_view name) const;
+    void CheckExpression(const Expression& expression) { WalkExpression(expression, expressionStack); }
+    const Expression* ResumeExpression(const Expression& expression, uint32_t step);
+    void CheckInfix(const InfixExpression& infix) const;
+    void CheckPrefix(const PrefixExpression& prefix) const;
+    void CheckCall(const CallExpression& call) const;
+
+    void VisitVariableDeclaration(const VariableDeclaration& varDecl);
+    void VisitReturnStatement(const ReturnStatement& returnStmt);
+    void VisitBlockStatement(const BlockStatement& block);
+    void VisitFunctionDeclaration(const FunctionDeclaration& funcDecl);
+    void VisitExpressionStatement(const ExpressionStatement& exprStmt);
+    void VisitIfStatement(const IfStatement& ifStmt);
+    void VisitWhileStatement(const WhileStatement& whileStmt);
+    void VisitAssignmentStatement(const AssignmentStatement& assignStmt);
+    void VisitUnsafeStatement(const UnsafeStatement& unsafeStmt);
+    void VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign);
+
+    const StringInterner& interner;
+    SymbolTable symbolTable;
+    std::vector<Function> functions; // Indexed by symbol
+    // Function being checked
+    const FunctionDeclaration* current = nullptr;
+    std::vector<ExpressionStep> expressionStack;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Read-only contents of an input file. Regular files are memory-mapped so the
+// lexer can hand out tokens that point straight into the mapping; anything that
+// cannot be mapped (pipes, empty files) is read into an owned buffer instead.
+// Tokens and views taken from GetContents() are only valid while this is alive.
+class SourceFile {
+public:
+    SourceFile() = default;
+    ~SourceFile();
+    SourceFile(SourceFile&& other) noexcept;
+    SourceFile& operator=(SourceFile&& other) noexcept;
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    bool Open(const std::string& path);
+    [[nodiscard]] std::string_view GetContents() const { return contents; }
+    [[nodiscard]] bool IsMapped() const { return mapping != nullptr; }
+
+private:
+    void Close();
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::string buffer;
+    std::string_view contents;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Arena.h"
+
+// Dense identifier ID handed out by StringInterner
+using Symbol = uint32_t;
+constexpr Symbol INVALID_SYMBOL = UINT32_MAX;
+
+// Maps identifier spellings to dense Symbols. Each distinct spelling is copied
+// once into interner-owned storage, so the views returned by GetString (and
+// kept by AST nodes) stay valid for as long as the interner is alive.
+class StringInterner {
+public:
+    Symbol Intern(std::string_view text);
+    // Returns INVALID_SYMBOL instead of adding unknown spellings
+    [[nodiscard]] Symbol Find(std::string_view text) const;
+    [[nodiscard]] std::string_view GetString(const Symbol symbol) const { return strings[symbol]; }
+    [[nodiscard]] size_t Size() const { return strings.size(); }
+
+private:
+    Arena storage;
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, Symbol> symbols;
+};
@@ -1,23 +1,44 @@
-
 #pragma once
 
 #include <vector>
-#include <string>
 #include <unordered_map>
+#include "StringInterner.h"
+#include "Type.h"
 
 class SymbolTable {
 public:
-    SymbolTable();
-    void Define(const std::string& name);
-    void DefineGlobal(const std::string& name);
-    void DefineParameter(const std::string& name, int offset);
-    int Get(const std::string& name);
-    bool IsGlobal(const std::string& name);
+    struct Entry {
+        int offset; // From rbp; 0 for globals
+        Type type;
+        bool isConst;
+    };
+
+    explicit SymbolTable(const StringInterner& interner);
+    void Define(Symbol name, Type type, bool isConst = false);
+    void DefineGlobal(Symbol name, Type type, bool isConst = false);
+    void DefineParameter(Symbol name, int offset, Type type);
+    // The innermost definition of name
+    const Entry& Get(Symbol name) const;
+    // The global definition of name, which must be IsGlobal
+    const Entry& GetGlobal(Symbol name) const { return scopes[0].at(name); }
+    bool IsGlobal(Symbol name) const;
     void EnterScope();
     void LeaveScope();
 
+    [[nodiscard]] size_t GetGlobalCount() const { return scopes[0].size(); }
+    // Bytes of the slots Define has handed out since the function scope was
+    // entered
+    [[nodiscard]] int GetFrameSize() const { return -8 - nextOffset; }
+    // Most function-local names (parameters and locals) in scope at once
+    [[nodiscard]] size_t GetPeakLocalCount() const { return peakLocalCount; }
+
 private:
-    std::vector<std::unordered_map<std::string, int>> scopes;
-    std::unordered_map<std::string, bool> globals;
+    const StringInterner& interner; // Only consulted to spell names in errors
+    std::vector<std::unordered_map<Symbol, Entry>> scopes;
+    std::vector<bool> globals; // Indexed by symbol
     int nextOffset = -8; // Start at [rbp-8]
+    size_t localCount = 0;
+    size_t peakLocalCount = 0;
+
+    void CountLocal();
 };
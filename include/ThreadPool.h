@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one FIFO queue. ParallelFor runs a
+// batch of tasks like a single call: it waits for that batch only and
+// rethrows the first exception one of its tasks threw, so several threads can
+// use one pool at the same time. Wait() instead waits for every task
+// submitted to the pool, and is only meant for a pool with a single user.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+    void Wait();
+
+    // Runs body(0) .. body(count - 1) on the pool and waits for all of them,
+    // but not for tasks other callers submitted meanwhile
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    [[nodiscard]] unsigned GetThreadCount() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    size_t pending = 0;
+    bool stopping = false;
+    std::exception_ptr firstError;
+};
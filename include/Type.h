@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+enum class BaseType : uint8_t {
+    None, // Not checked yet
+    I8, I16, I32, I64,
+    U8, U16, U32, U64,
+    F32, F64,
+};
+
+// Type of a value, as Sema assigns it: a base type behind zero or more levels
+// of pointers. Two bytes, so every expression can carry one.
+struct Type {
+    BaseType base = BaseType::None;
+    uint8_t pointers = 0;
+
+    constexpr Type() = default;
+    constexpr Type(const BaseType base, const uint8_t pointers = 0) : base(base), pointers(pointers) {}
+
+    [[nodiscard]] constexpr bool IsPointer() const { return pointers > 0; }
+    [[nodiscard]] constexpr bool IsInteger() const { return pointers == 0 && base >= BaseType::I8 && base <= BaseType::U64; }
+    [[nodiscard]] constexpr bool IsFloat() const { return pointers == 0 && (base == BaseType::F32 || base == BaseType::F64); }
+    // Pointers compare and divide as unsigned numbers too
+    [[nodiscard]] constexpr bool IsUnsigned() const { return pointers > 0 || (base >= BaseType::U8 && base <= BaseType::U64); }
+    // Bytes a variable of this type occupies: 1, 2, 4 or 8
+    [[nodiscard]] uint8_t Size() const;
+    [[nodiscard]] constexpr Type Pointee() const { return {base, static_cast<uint8_t>(pointers - 1)}; }
+    [[nodiscard]] constexpr Type PointerTo() const { return {base, static_cast<uint8_t>(pointers + 1)}; }
+
+    constexpr bool operator==(const Type& other) const { return base == other.base && pointers == other.pointers; }
+    constexpr bool operator!=(const Type& other) const { return !(*this == other); }
+};
+
+// The type a name like "i32" or "*u8" stands for, or BaseType::None
+Type ParseTypeName(std::string_view name);
+// Spelling for diagnostics, e.g. "i32" or "**u8"
+std::string TypeName(Type type);
+
+// Integers narrower than 32 bits take part in arithmetic as i32, as in C
+Type Promote(Type type);
+// Type both operands of an arithmetic or comparison operator are converted
+// to: the wider of the promoted types, unsigned when they are the same width
+// and either is unsigned
+Type CommonType(Type left, Type right);
+// Whether every value of type from is also a value of type to, so a value
+// extended to 64 bits as from is extended as to as well. Any type fits in 64
+// bits, where only the sign of the extension differs.
+bool Includes(Type to, Type from);
+// Type read or written through an address of this type: the pointee of a
+// pointer, or i64 for an integer used as an address
+Type PointeeOf(Type address);
+// The value a variable of the integer or pointer type holds after value is
+// stored into it, as read back into 64 bits
+int64_t Truncate(int64_t value, Type type);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MachineCode.h"
+
+// Encodes machine code into x86-64 bytes laid out the way an object file
+// wants them: .text and .data contents, symbols and the relocations that are
+// left for the linker (or the JIT loader) to resolve.
+namespace x86 {
+
+    enum class Section : uint8_t { Undefined, Text, Data };
+
+    enum class RelocationType : uint8_t {
+        PC32,   // S + A - P, 32-bit; RIP-relative data references
+        PLT32,  // S + A - P, 32-bit; calls and jumps to other objects
+    };
+
+    struct Symbol {
+        std::string_view name;
+        Section section = Section::Undefined;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        bool isGlobal = false;
+    };
+
+    struct Relocation {
+        uint64_t offset;    // of the 32-bit field in .text
+        uint32_t symbol;    // index into EncodedModule::symbols
+        RelocationType type;
+        int64_t addend;
+    };
+
+    struct EncodedModule {
+        std::string text;
+        std::string data;
+        uint64_t dataAlignment = 8;
+        std::vector<Symbol> symbols;
+        std::vector<Relocation> relocations;
+    };
+
+    // Thrown for inline assembly outside the subset the encoder understands;
+    // callers can fall back to an external assembler on the NASM text
+    class UnsupportedInstruction : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    EncodedModule Encode(const MachineModule& module);
+
+} // namespace x86
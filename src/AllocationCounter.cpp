@@ -0,0 +1,104 @@
+#include "AllocationCounter.h"
+
+#ifdef APX_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<uint64_t> g_bytes{0};
+
+    void* Allocate(std::size_t size, const std::size_t alignment) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+        if (size == 0) {
+            size = 1;
+        }
+        for (;;) {
+            void* memory = nullptr;
+            if (alignment <= alignof(std::max_align_t)) {
+                memory = std::malloc(size);
+            } else if (::posix_memalign(&memory, alignment, size) != 0) {
+                memory = nullptr;
+            }
+            if (memory) {
+                return memory;
+            }
+            const std::new_handler handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    void* AllocateNoThrow(const std::size_t size, const std::size_t alignment) noexcept {
+        try {
+            return Allocate(size, alignment);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+// Every form of operator new ends up in Allocate; every delete is a plain
+// free, since malloc and posix_memalign memory are both released that way
+void* operator new(const std::size_t size) { return Allocate(size, 0); }
+void* operator new[](const std::size_t size) { return Allocate(size, 0); }
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, 0); }
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept { return AllocateNoThrow(size, 0); }
+void* operator new(const std::size_t size, const std::align_val_t alignment) {
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment) {
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new(const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](const std::size_t size, const std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { std::free(memory); }
+
+namespace memory {
+
+    bool IsCountingAllocations() {
+        return true;
+    }
+
+    AllocationCounts GetAllocationCounts() {
+        return {g_allocations.load(std::memory_order_relaxed), g_bytes.load(std::memory_order_relaxed)};
+    }
+
+} // namespace memory
+
+#else
+
+namespace memory {
+
+    bool IsCountingAllocations() {
+        return false;
+    }
+
+    AllocationCounts GetAllocationCounts() {
+        return {};
+    }
+
+} // namespace memory
+
+#endif
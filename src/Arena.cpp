@@ -0,0 +1,35 @@
+#include "Arena.h"
+#include <cstring>
+
+void* Arena::AllocateSlow(const size_t size, const size_t alignment) {
+    // Oversized requests get a dedicated block so the current one keeps its tail
+    const size_t blockSize = size + alignment > BLOCK_SIZE ? size + alignment : BLOCK_SIZE;
+    blocks.emplace_back(new std::byte[blockSize]);
+    bytesReserved += blockSize;
+
+    std::byte* block = blocks.back().get();
+    auto aligned = (reinterpret_cast<uintptr_t>(block) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (blockSize == BLOCK_SIZE) {
+        cursor = reinterpret_cast<std::byte*>(aligned + size);
+        limit = block + blockSize;
+    }
+    bytesUsed += size;
+    return reinterpret_cast<void*>(aligned);
+}
+
+std::string_view Arena::CopyString(const std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    auto* data = static_cast<char*>(Allocate(text.size(), 1));
+    std::memcpy(data, text.data(), text.size());
+    return {data, text.size()};
+}
+
+void Arena::Adopt(Arena&& other) {
+    blocks.insert(blocks.end(), std::make_move_iterator(other.blocks.begin()),
+                  std::make_move_iterator(other.blocks.end()));
+    bytesUsed += other.bytesUsed;
+    bytesReserved += other.bytesReserved;
+    other = Arena();
+}
@@ -1,4 +1,6 @@
 #include "ArgParser.h"
+#include "Logger.h"
+#include <charconv>
 #include <string>
 #include <iostream>
 
@@ -44,31 +46,141 @@ CompileConfiguration ArgParser::Parse() const {
                 config.errorMessage = "Option -o requires an argument";
                 return config;
             }
-            if (!config.outputFile.empty()) {
+            config.outputFiles.emplace_back(argv[++i]);
+        } else if (arg == "-f") {
+            if (i + 1 >= argc) {
+                config.hasError = true;
+                config.errorMessage = "Option -f requires an argument";
+                return config;
+            }
+            const std::string format = argv[++i];
+            if (format == "nasm") {
+                config.format = APXC_OUTPUT_FORMAT::APXC_NASM;
+            } else if (format == "obj") {
+                config.format = APXC_OUTPUT_FORMAT::APXC_OBJECT;
+            } else {
+                config.hasError = true;
+                config.errorMessage = "Unknown output format: " + format;
+                return config;
+            }
+        } else if (arg == "--run") {
+            config.run = true;
+        } else if (arg == "--interp") {
+            config.interpret = true;
+        } else if (arg == "--watch") {
+            config.watch = true;
+        } else if (arg == "--server") {
+            config.server = true;
+        } else if (arg == "--connect") {
+            config.connect = true;
+        } else if (arg == "--socket") {
+            if (i + 1 >= argc) {
+                config.hasError = true;
+                config.errorMessage = "Option --socket requires an argument";
+                return config;
+            }
+            config.socketPath = argv[++i];
+        } else if (arg.rfind("-I", 0) == 0) {
+            std::string directory = arg.substr(2);
+            if (directory.empty()) {
+                if (i + 1 >= argc) {
+                    config.hasError = true;
+                    config.errorMessage = "Option -I requires an argument";
+                    return config;
+                }
+                directory = argv[++i];
+            }
+            config.importPaths.push_back(directory);
+        } else if (arg == "--emit-interface") {
+            config.emitInterface = true;
+        } else if (arg == "--cache-dir") {
+            if (i + 1 >= argc) {
+                config.hasError = true;
+                config.errorMessage = "Option --cache-dir requires an argument";
+                return config;
+            }
+            config.cacheDir = argv[++i];
+        } else if (arg == "--stats") {
+            config.stats = true;
+        } else if (arg == "--time-report") {
+            config.timeReport = true;
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            config.traceFile = arg.substr(8);
+            if (config.traceFile.empty()) {
                 config.hasError = true;
-                config.errorMessage = "Multiple output files specified";
+                config.errorMessage = "Option --trace requires a file name";
+                return config;
+            }
+        } else if (arg.rfind("-j", 0) == 0) {
+            std::string value = arg.substr(2);
+            if (value.empty()) {
+                if (i + 1 >= argc) {
+                    config.hasError = true;
+                    config.errorMessage = "Option -j requires an argument";
+                    return config;
+                }
+                value = argv[++i];
+            }
+            const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), config.jobs);
+            if (ec != std::errc() || ptr != value.data() + value.size()) {
+                config.hasError = true;
+                config.errorMessage = "Invalid job count: " + value;
                 return config;
             }
-            config.outputFile = argv[++i];
         } else if (arg[0] == '-') {
             config.hasError = true;
             config.errorMessage = "Unknown option: " + arg;
             return config;
         } else {
-            if (!config.inputFile.empty()) {
-                config.hasError = true;
-                config.errorMessage = "Multiple input files specified";
-                return config;
-            }
-            config.inputFile = arg;
+            config.inputFiles.push_back(arg);
         }
     }
     
-    if (config.inputFile.empty()) {
+    if (config.server) {
+        // The server never finishes a run to report at
+        if (config.connect || !config.inputFiles.empty() || config.timeReport || !config.traceFile.empty()) {
+            config.hasError = true;
+            config.errorMessage = "--server takes no input files and cannot be combined with --connect, --time-report or --trace";
+        }
+        return config;
+    }
+
+    if (config.inputFiles.empty()) {
         config.hasError = true;
         config.errorMessage = "No input file specified";
         return config;
     }
+
+    if ((config.run || config.interpret)
+        && (config.run == config.interpret || config.inputFiles.size() != 1 || !config.outputFiles.empty()
+            || config.connect || config.operation != APXC_OPERATION::APXC_UNKNOWN)) {
+        config.hasError = true;
+        config.errorMessage = "--run and --interp take exactly one input file and no -E, -c, -o or --connect";
+        return config;
+    }
+
+    if (config.emitInterface
+        && (config.run || config.interpret || config.operation == APXC_OPERATION::APXC_PREPROCESS)) {
+        config.hasError = true;
+        config.errorMessage = "--emit-interface cannot be combined with -E, --run or --interp";
+        return config;
+    }
+
+    if (config.watch
+        && (config.run || config.interpret || config.connect || !config.cacheDir.empty()
+            || config.operation == APXC_OPERATION::APXC_PREPROCESS)) {
+        config.hasError = true;
+        config.errorMessage = "--watch cannot be combined with -E, --run, --interp, --connect or --cache-dir";
+        return config;
+    }
+
+    if (!config.outputFiles.empty() && config.outputFiles.size() != config.inputFiles.size()) {
+        config.hasError = true;
+        config.errorMessage = config.inputFiles.size() == 1
+            ? "Multiple output files specified"
+            : "Number of -o options must match the number of input files";
+        return config;
+    }
     
     if (config.operation == APXC_OPERATION::APXC_UNKNOWN) {
         config.operation = APXC_OPERATION::APXC_COMPILE_W_ENTRY;
@@ -78,11 +190,26 @@ CompileConfiguration ArgParser::Parse() const {
 }
 
 void ArgParser::PrintUsage(const std::string& programName) {
-    std::cout << "Usage: " << programName << " [options] <input-file>\n\n";
+    out::flush(); // After any error logged just before
+    std::cout << "Usage: " << programName << " [options] <input-file>...\n\n";
     std::cout << "Options:\n";
     std::cout << "  -E              Preprocess only\n";
     std::cout << "  -c              Compile without entry point\n";
-    std::cout << "  -o <file>       Specify output file\n";
+    std::cout << "  -o <file>       Specify output file (once per input, in order)\n";
+    std::cout << "  -f <format>     Output format: nasm (default) or obj (ELF64 object)\n";
+    std::cout << "  -I <dir>        Also look for imported modules' .apxi files in dir\n";
+    std::cout << "  --emit-interface Write a module's <name>.apxi next to its output for importers\n";
+    std::cout << "  -j <n>          Compile up to n files in parallel (0 = all cores)\n";
+    std::cout << "  --run           Execute the input in memory; its main's result is the exit status\n";
+    std::cout << "  --interp        Like --run, but on the bytecode interpreter\n";
+    std::cout << "  --watch         Recompile the inputs each time they are saved, reusing unchanged functions\n";
+    std::cout << "  --cache-dir <d> Reuse outputs of unchanged sources cached in directory d\n";
+    std::cout << "  --stats         Print peak memory, allocation and AST statistics\n";
+    std::cout << "  --time-report   Print wall and CPU time spent in each compiler phase\n";
+    std::cout << "  --trace=<file>  Write a Chrome trace of the phases and generated functions\n";
+    std::cout << "  --server        Run a compile server that keeps parsed sources in memory\n";
+    std::cout << "  --connect       Compile through a running compile server\n";
+    std::cout << "  --socket <path> Server socket (default: $XDG_RUNTIME_DIR/apxc.sock)\n";
     std::cout << "  -h, --help      Show this help message\n\n";
     std::cout << "  -v, --version   Show apxc version\n\n";
 }
@@ -0,0 +1,185 @@
+#include "AstHasher.h"
+#include <cstring>
+
+uint64_t AstHasher::Hash(const Node& node) {
+    hash = HashBytes({});
+    if (const auto* expression = DynCast<Expression>(&node)) {
+        HashExpression(*expression);
+    } else {
+        Visit(node);
+    }
+    return hash;
+}
+
+void AstHasher::HashOptional(const Node* node) {
+    Mix(node != nullptr);
+    if (node) {
+        Visit(*node);
+    }
+}
+
+void AstHasher::HashStatements(const ArenaList<Statement*>& statements) {
+    Mix(statements.size());
+    for (const auto* stmt : statements) {
+        Visit(*stmt);
+    }
+}
+
+const Expression* AstHasher::ResumeExpression(const Expression& expression, const uint32_t step) {
+    switch (expression.kind) {
+        case NodeKind::CallExpression: {
+            const auto& call = static_cast<const CallExpression&>(expression);
+            if (step == 0) {
+                MixKind(call);
+                MixString(call.function->value);
+                Mix(call.arguments.size());
+            }
+            return step < call.arguments.size() ? call.arguments[step] : nullptr;
+        }
+        case NodeKind::InfixExpression: {
+            const auto& infix = static_cast<const InfixExpression&>(expression);
+            if (step == 0) {
+                MixKind(infix);
+                MixString(infix.op);
+                return infix.left;
+            }
+            return step == 1 ? infix.right : nullptr;
+        }
+        case NodeKind::PrefixExpression: {
+            const auto& prefix = static_cast<const PrefixExpression&>(expression);
+            if (step == 0) {
+                MixKind(prefix);
+                MixString(prefix.op);
+                return prefix.right;
+            }
+            return nullptr;
+        }
+        case NodeKind::DereferenceExpression:
+            if (step == 0) {
+                MixKind(expression);
+                return static_cast<const DereferenceExpression&>(expression).operand;
+            }
+            return nullptr;
+        case NodeKind::AddressOfExpression:
+            if (step == 0) {
+                MixKind(expression);
+                return static_cast<const AddressOfExpression&>(expression).operand;
+            }
+            return nullptr;
+        default:
+            Visit(expression);
+            return nullptr;
+    }
+}
+
+void AstHasher::VisitProgram(const Program& program) {
+    MixKind(program);
+    Mix(program.statements.size());
+    for (const auto* stmt : program.statements) {
+        Visit(*stmt);
+    }
+}
+
+void AstHasher::VisitAttribute(const Attribute& attribute) {
+    MixKind(attribute);
+    MixString(attribute.name);
+    Mix(attribute.arguments.size());
+    for (const auto argument : attribute.arguments) {
+        MixString(argument);
+    }
+}
+
+void AstHasher::VisitIdentifier(const Identifier& ident) {
+    MixKind(ident);
+    MixString(ident.value);
+}
+
+void AstHasher::VisitIntegerLiteral(const IntegerLiteral& intLiteral) {
+    MixKind(intLiteral);
+    Mix(intLiteral.value);
+}
+
+void AstHasher::VisitFloatLiteral(const FloatLiteral& floatLiteral) {
+    MixKind(floatLiteral);
+    uint64_t bits;
+    std::memcpy(&bits, &floatLiteral.value, sizeof(bits));
+    Mix(bits);
+}
+
+void AstHasher::VisitVariableDeclaration(const VariableDeclaration& varDecl) {
+    MixKind(varDecl);
+    Mix(varDecl.isConst);
+    Mix(varDecl.isGlobal);
+    Mix(varDecl.alignment);
+    Visit(*varDecl.name);
+    HashOptional(varDecl.type);
+    HashExpression(*varDecl.value);
+}
+
+void AstHasher::VisitReturnStatement(const ReturnStatement& returnStmt) {
+    MixKind(returnStmt);
+    HashExpression(*returnStmt.returnValue);
+}
+
+void AstHasher::VisitBlockStatement(const BlockStatement& block) {
+    MixKind(block);
+    HashStatements(block.statements);
+}
+
+void AstHasher::VisitFunctionDeclaration(const FunctionDeclaration& funcDecl) {
+    MixKind(funcDecl);
+    Mix(funcDecl.isGlobal);
+    Visit(*funcDecl.name);
+    Mix(funcDecl.parameters.size());
+    for (size_t i = 0; i < funcDecl.parameters.size(); ++i) {
+        Visit(*funcDecl.parameters[i]);
+        Visit(*funcDecl.parameterTypes[i]);
+    }
+    HashOptional(funcDecl.returnType);
+    Visit(*funcDecl.body);
+}
+
+void AstHasher::VisitExpressionStatement(const ExpressionStatement& exprStmt) {
+    MixKind(exprStmt);
+    HashExpression(*exprStmt.expression);
+}
+
+void AstHasher::VisitIfStatement(const IfStatement& ifStmt) {
+    MixKind(ifStmt);
+    HashExpression(*ifStmt.condition);
+    Visit(*ifStmt.consequence);
+    HashOptional(ifStmt.alternative);
+}
+
+void AstHasher::VisitWhileStatement(const WhileStatement& whileStmt) {
+    MixKind(whileStmt);
+    HashExpression(*whileStmt.condition);
+    Visit(*whileStmt.body);
+}
+
+void AstHasher::VisitAssignmentStatement(const AssignmentStatement& assignStmt) {
+    MixKind(assignStmt);
+    Visit(*assignStmt.name);
+    HashExpression(*assignStmt.value);
+}
+
+void AstHasher::VisitUnsafeStatement(const UnsafeStatement& unsafeStmt) {
+    MixKind(unsafeStmt);
+    Visit(*unsafeStmt.body);
+}
+
+void AstHasher::VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign) {
+    MixKind(derefAssign);
+    HashExpression(*derefAssign.pointer);
+    HashExpression(*derefAssign.value);
+}
+
+void AstHasher::VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt) {
+    MixKind(asmStmt);
+    MixString(asmStmt.assembly_code);
+}
+
+void AstHasher::VisitImportDeclaration(const ImportDeclaration& importDecl) {
+    MixKind(importDecl);
+    Visit(*importDecl.module);
+}
@@ -0,0 +1,258 @@
+#include "AstPrinter.h"
+#include <algorithm>
+#include <charconv>
+
+void AstPrinter::Print(const Node& node) {
+    if (const auto* expression = DynCast<Expression>(&node)) {
+        PrintExpression(*expression);
+    } else {
+        Visit(node);
+    }
+}
+
+void AstPrinter::PrintStatement(const Statement& statement) {
+    if (indent > 0) {
+        out.append(static_cast<size_t>(depth * indent), ' ');
+    }
+    Visit(statement);
+    if (indent > 0) {
+        out += '\n';
+    }
+}
+
+void AstPrinter::PrintStatements(const std::vector<Statement*>& statements) {
+    for (const auto* stmt : statements) {
+        PrintStatement(*stmt);
+    }
+}
+
+void AstPrinter::PrintStatements(const ArenaList<Statement*>& statements) {
+    for (const auto* stmt : statements) {
+        PrintStatement(*stmt);
+    }
+}
+
+// "{" statements "}", the statements one level deeper when indenting
+void AstPrinter::PrintBody(const BlockStatement& block) {
+    out += '{';
+    if (indent > 0) {
+        out += '\n';
+        ++depth;
+        PrintStatements(block.statements);
+        --depth;
+        out.append(static_cast<size_t>(depth * indent), ' ');
+    } else {
+        PrintStatements(block.statements);
+    }
+    out += '}';
+}
+
+void AstPrinter::VisitProgram(const Program& program) {
+    PrintStatements(program.statements);
+}
+
+void AstPrinter::VisitAttribute(const Attribute& attribute) {
+    out += "#[";
+    out += attribute.name;
+    if (!attribute.arguments.empty()) {
+        out += '(';
+        for (size_t i = 0; i < attribute.arguments.size(); ++i) {
+            if (i > 0) {
+                out += ", ";
+            }
+            out += attribute.arguments[i];
+        }
+        out += ')';
+    }
+    out += ']';
+}
+
+void AstPrinter::VisitIdentifier(const Identifier& ident) {
+    out += ident.value;
+}
+
+void AstPrinter::VisitIntegerLiteral(const IntegerLiteral& intLiteral) {
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), intLiteral.value);
+    out.append(buffer, result.ptr);
+}
+
+void AstPrinter::VisitFloatLiteral(const FloatLiteral& floatLiteral) {
+    out += std::to_string(floatLiteral.value);
+}
+
+// Fully parenthesized, so the tree shape can be read back off the text
+const Expression* AstPrinter::ResumeExpression(const Expression& expression, const uint32_t step) {
+    switch (expression.kind) {
+        case NodeKind::CallExpression: {
+            const auto& call = static_cast<const CallExpression&>(expression);
+            if (step == 0) {
+                Visit(*call.function);
+                out += '(';
+            } else if (step < call.arguments.size()) {
+                out += ", ";
+            }
+            if (step < call.arguments.size()) {
+                return call.arguments[step];
+            }
+            out += ')';
+            return nullptr;
+        }
+        case NodeKind::InfixExpression: {
+            const auto& infix = static_cast<const InfixExpression&>(expression);
+            if (step == 0) {
+                out += '(';
+                return infix.left;
+            }
+            if (step == 1) {
+                out += ' ';
+                out += infix.op;
+                out += ' ';
+                return infix.right;
+            }
+            out += ')';
+            return nullptr;
+        }
+        case NodeKind::PrefixExpression: {
+            const auto& prefix = static_cast<const PrefixExpression&>(expression);
+            if (step == 0) {
+                out += '(';
+                out += prefix.op;
+                return prefix.right;
+            }
+            out += ')';
+            return nullptr;
+        }
+        case NodeKind::DereferenceExpression:
+            if (step == 0) {
+                out += "(*";
+                return static_cast<const DereferenceExpression&>(expression).operand;
+            }
+            out += ')';
+            return nullptr;
+        case NodeKind::AddressOfExpression:
+            if (step == 0) {
+                out += "(&";
+                return static_cast<const AddressOfExpression&>(expression).operand;
+            }
+            out += ')';
+            return nullptr;
+        default:
+            Visit(expression);
+            return nullptr;
+    }
+}
+
+void AstPrinter::VisitVariableDeclaration(const VariableDeclaration& varDecl) {
+    if (varDecl.isConst) {
+        out += "const ";
+    }
+    Visit(*varDecl.name);
+    if (varDecl.type) {
+        out += ": ";
+        Visit(*varDecl.type);
+    }
+    out += varDecl.isConst ? " = " : " := ";
+    PrintExpression(*varDecl.value);
+    out += ';';
+}
+
+void AstPrinter::VisitReturnStatement(const ReturnStatement& returnStmt) {
+    out += "return ";
+    PrintExpression(*returnStmt.returnValue);
+    out += ';';
+}
+
+void AstPrinter::VisitBlockStatement(const BlockStatement& block) {
+    PrintBody(block);
+}
+
+void AstPrinter::VisitFunctionDeclaration(const FunctionDeclaration& funcDecl) {
+    out += "fn ";
+    Visit(*funcDecl.name);
+    out += '(';
+    for (size_t i = 0; i < funcDecl.parameters.size(); ++i) {
+        if (i > 0) {
+            out += ", ";
+        }
+        Visit(*funcDecl.parameters[i]);
+        out += ": ";
+        Visit(*funcDecl.parameterTypes[i]);
+    }
+    out += ") -> ";
+    Visit(*funcDecl.returnType);
+    out += ' ';
+    PrintBody(*funcDecl.body);
+}
+
+void AstPrinter::VisitExpressionStatement(const ExpressionStatement& exprStmt) {
+    PrintExpression(*exprStmt.expression);
+    out += ';';
+}
+
+void AstPrinter::VisitIfStatement(const IfStatement& ifStmt) {
+    out += "if (";
+    PrintExpression(*ifStmt.condition);
+    out += ") ";
+    PrintBody(*ifStmt.consequence);
+    if (ifStmt.alternative) {
+        out += " else ";
+        PrintBody(*ifStmt.alternative);
+    }
+}
+
+void AstPrinter::VisitWhileStatement(const WhileStatement& whileStmt) {
+    out += "while (";
+    PrintExpression(*whileStmt.condition);
+    out += ") ";
+    PrintBody(*whileStmt.body);
+}
+
+void AstPrinter::VisitAssignmentStatement(const AssignmentStatement& assignStmt) {
+    Visit(*assignStmt.name);
+    out += " = ";
+    PrintExpression(*assignStmt.value);
+    out += ';';
+}
+
+void AstPrinter::VisitUnsafeStatement(const UnsafeStatement& unsafeStmt) {
+    out += "unsafe ";
+    PrintBody(*unsafeStmt.body);
+}
+
+void AstPrinter::VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign) {
+    out += '*';
+    PrintExpression(*derefAssign.pointer);
+    out += " = ";
+    PrintExpression(*derefAssign.value);
+    out += ';';
+}
+
+void AstPrinter::VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt) {
+    if (indent == 0) {
+        out += "asm {";
+        out += asmStmt.assembly_code;
+        out += '}';
+        return;
+    }
+    // One instruction per line, indented like a statement
+    out += "asm {\n";
+    std::string_view code = asmStmt.assembly_code;
+    while (!code.empty()) {
+        const size_t end = std::min(code.find('\n'), code.size());
+        if (end > 0) {
+            out.append(static_cast<size_t>((depth + 1) * indent), ' ');
+            out += code.substr(0, end);
+            out += '\n';
+        }
+        code.remove_prefix(std::min(end + 1, code.size()));
+    }
+    out.append(static_cast<size_t>(depth * indent), ' ');
+    out += '}';
+}
+
+void AstPrinter::VisitImportDeclaration(const ImportDeclaration& importDecl) {
+    out += "import ";
+    Visit(*importDecl.module);
+    out += ';';
+}
@@ -0,0 +1,507 @@
+#include "Bytecode.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+    // Whether evaluating the expression may run other code that could write
+    // a local through a pointer
+    bool ContainsCall(const Expression& root) {
+        std::vector<const Expression*> pending;
+        const Expression* expression = &root;
+        for (;;) {
+            switch (expression->kind) {
+                case NodeKind::CallExpression:
+                    return true;
+                case NodeKind::InfixExpression: {
+                    const auto& infix = static_cast<const InfixExpression&>(*expression);
+                    pending.push_back(infix.right);
+                    expression = infix.left;
+                    continue;
+                }
+                case NodeKind::PrefixExpression:
+                    expression = static_cast<const PrefixExpression&>(*expression).right;
+                    continue;
+                case NodeKind::DereferenceExpression:
+                    expression = static_cast<const DereferenceExpression&>(*expression).operand;
+                    continue;
+                default:
+                    break;
+            }
+            if (pending.empty()) {
+                return false;
+            }
+            expression = pending.back();
+            pending.pop_back();
+        }
+    }
+
+    // Comparison operator, its unsigned form and the branch taken when it is
+    // false; unsigned orderings have no branch of their own
+    struct Comparison {
+        Operator operation;
+        BytecodeOp set;
+        BytecodeOp setUnsigned;
+        BytecodeOp jumpIfFalse;
+    };
+
+    constexpr Comparison COMPARISONS[] = {
+        {Operator::Eq, BytecodeOp::Eq, BytecodeOp::Eq, BytecodeOp::JumpIfNe},
+        {Operator::Ne, BytecodeOp::Ne, BytecodeOp::Ne, BytecodeOp::JumpIfEq},
+        {Operator::Lt, BytecodeOp::Lt, BytecodeOp::LtU, BytecodeOp::JumpIfGe},
+        {Operator::Gt, BytecodeOp::Gt, BytecodeOp::GtU, BytecodeOp::JumpIfLe},
+        {Operator::Le, BytecodeOp::Le, BytecodeOp::LeU, BytecodeOp::JumpIfGt},
+        {Operator::Ge, BytecodeOp::Ge, BytecodeOp::GeU, BytecodeOp::JumpIfLt},
+    };
+
+    const Comparison* ComparisonOf(const Operator operation) {
+        for (const auto& comparison : COMPARISONS) {
+            if (comparison.operation == operation) {
+                return &comparison;
+            }
+        }
+        return nullptr;
+    }
+
+    // Whether the result of arithmetic of this type has to be truncated
+    bool Wraps32(const Type type) {
+        return type.Size() == 4;
+    }
+
+    // Load operand c reading a value of this type
+    uint32_t LoadTypeOf(const Type type) {
+        return static_cast<uint32_t>(type.Size() == 8 ? BaseType::None : type.base);
+    }
+
+    // Instructions whose only effect is writing register a, so the write can
+    // be redirected to another register
+    bool WritesOnlyA(const BytecodeOp op) {
+        switch (op) {
+            case BytecodeOp::StoreGlobal:
+            case BytecodeOp::Store:
+            case BytecodeOp::Call:
+            case BytecodeOp::Return:
+            case BytecodeOp::Jump:
+            case BytecodeOp::JumpIfZero:
+            case BytecodeOp::JumpIfEq:
+            case BytecodeOp::JumpIfNe:
+            case BytecodeOp::JumpIfLt:
+            case BytecodeOp::JumpIfGt:
+            case BytecodeOp::JumpIfLe:
+            case BytecodeOp::JumpIfGe:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    template<typename T>
+    void SetIndex(std::vector<int32_t>& table, const Symbol symbol, const T index) {
+        if (table.size() <= symbol) {
+            table.resize(symbol + 1, -1);
+        }
+        table[symbol] = static_cast<int32_t>(index);
+    }
+}
+
+int BytecodeModule::FindFunction(const std::string_view name) const {
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+BytecodeModule BytecodeCompiler::Compile(const Program& program) {
+    module = {};
+    declarations.clear();
+    for (const auto* stmt : program.statements) {
+        if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+            // Same initial values as the data section CodeGenerator emits
+            const Type type = varDecl->name->type;
+            int64_t value = 0;
+            double floatValue = 0;
+            if (const auto* intLit = DynCast<IntegerLiteral>(varDecl->value)) {
+                value = Truncate(intLit->value, type);
+                floatValue = static_cast<double>(intLit->value);
+            } else if (const auto* floatLit = DynCast<FloatLiteral>(varDecl->value)) {
+                floatValue = floatLit->value;
+            }
+            if (type.base == BaseType::F32) {
+                const auto single = static_cast<float>(floatValue);
+                uint32_t bits;
+                std::memcpy(&bits, &single, sizeof(bits));
+                value = bits;
+            } else if (type.IsFloat()) {
+                std::memcpy(&value, &floatValue, sizeof(value));
+            }
+            SetIndex(globalIndex, varDecl->name->symbol, module.globals.size());
+            module.globalNames.push_back(varDecl->name->value);
+            module.globals.push_back(value);
+        } else if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+            SetIndex(functionIndex, funcDecl->name->symbol, module.functions.size());
+            module.functions.push_back({funcDecl->name->value});
+            declarations.push_back(funcDecl);
+        }
+    }
+
+    for (const auto* funcDecl : declarations) {
+        CompileFunction(*funcDecl);
+    }
+    return std::move(module);
+}
+
+void BytecodeCompiler::CompileFunction(const FunctionDeclaration& funcDecl) {
+    BytecodeFunction& function = module.functions[static_cast<size_t>(functionIndex[funcDecl.name->symbol])];
+    function.entry = Here();
+    function.parameterCount = static_cast<uint32_t>(funcDecl.parameters.size());
+
+    parameterCount = function.parameterCount;
+    firstTemporary = parameterCount + static_cast<uint32_t>(funcDecl.frameSize / 8);
+    returnType = funcDecl.returnType->type;
+    nextTemporary = firstTemporary;
+    frameSize = firstTemporary;
+
+    bool hasReturn = false;
+    for (const auto* stmt : funcDecl.body->statements) {
+        CompileStatement(*stmt);
+        if (Is<ReturnStatement>(stmt)) {
+            hasReturn = true;
+            break; // Nothing after a top-level return is generated
+        }
+    }
+
+    // Functions without an explicit return return 0
+    if (!hasReturn) {
+        nextTemporary = firstTemporary;
+        const uint32_t zero = Temporary();
+        Emit(BytecodeOp::LoadImm, zero);
+        Emit(BytecodeOp::Return, zero);
+    }
+    function.frameSize = std::max(frameSize, 1u);
+}
+
+void BytecodeCompiler::CompileStatement(const Statement& statement) {
+    // No temporary lives from one statement to the next
+    nextTemporary = firstTemporary;
+    Visit(statement);
+}
+
+void BytecodeCompiler::CompileBlock(const BlockStatement& block) {
+    for (const auto* stmt : block.statements) {
+        CompileStatement(*stmt);
+    }
+}
+
+uint32_t BytecodeCompiler::CompileExpression(const Expression& expression) {
+    WalkExpression(expression, expressionStack);
+    const uint32_t value = values.back();
+    values.pop_back();
+    return value;
+}
+
+void BytecodeCompiler::CompileInto(const Expression& expression, const uint32_t target) {
+    MoveInto(CompileExpression(expression), target);
+}
+
+void BytecodeCompiler::MoveInto(const uint32_t value, const uint32_t target) {
+    if (value == target) {
+        return;
+    }
+    // A fresh temporary written by the last instruction is renamed instead
+    // of being copied
+    if (value >= firstTemporary && !module.code.empty()) {
+        BytecodeInstruction& last = module.code.back();
+        if (last.a == value && WritesOnlyA(last.op)) {
+            last.a = target;
+            return;
+        }
+    }
+    Emit(BytecodeOp::Move, target, value);
+}
+
+uint32_t BytecodeCompiler::Convert(const uint32_t value, const Type from, const Type to) {
+    if (Includes(to, from)) {
+        return value;
+    }
+    const uint32_t reg = Temporary();
+    Emit(BytecodeOp::Extend, reg, value, static_cast<uint32_t>(to.base));
+    return reg;
+}
+
+void BytecodeCompiler::ConvertInto(const uint32_t value, const Type from, const Type to, const uint32_t target) {
+    if (Includes(to, from)) {
+        MoveInto(value, target);
+    } else {
+        Emit(BytecodeOp::Extend, target, value, static_cast<uint32_t>(to.base));
+    }
+}
+
+size_t BytecodeCompiler::CompileBranchIfFalse(const Expression& condition) {
+    if (const auto* infix = DynCast<InfixExpression>(&condition)) {
+        // Unsigned orderings are set into a register and tested instead
+        const Comparison* comparison = ComparisonOf(infix->operation);
+        const Type type = infix->operandType;
+        if (comparison && (comparison->set == comparison->setUnsigned || !type.IsUnsigned())) {
+            uint32_t left = Convert(CompileExpression(*infix->left), infix->left->type, type);
+            if (left < firstTemporary && ContainsCall(*infix->right)) {
+                const uint32_t copy = Temporary();
+                Emit(BytecodeOp::Move, copy, left);
+                left = copy;
+            }
+            const uint32_t right = Convert(CompileExpression(*infix->right), infix->right->type, type);
+            return Emit(comparison->jumpIfFalse, left, right);
+        }
+    }
+    return Emit(BytecodeOp::JumpIfZero, CompileExpression(condition));
+}
+
+uint32_t BytecodeCompiler::Temporary() {
+    const uint32_t reg = nextTemporary++;
+    frameSize = std::max(frameSize, nextTemporary);
+    return reg;
+}
+
+uint32_t BytecodeCompiler::RegisterOf(const Identifier& ident) const {
+    // Parameters sit at [rbp+16], [rbp+24], ...; locals at [rbp-8], [rbp-16], ...
+    if (ident.offset > 0) {
+        return static_cast<uint32_t>((ident.offset - 16) / 8);
+    }
+    return parameterCount + static_cast<uint32_t>(-ident.offset / 8 - 1);
+}
+
+uint32_t BytecodeCompiler::GlobalOf(const Identifier& ident) const {
+    return static_cast<uint32_t>(globalIndex[ident.symbol]);
+}
+
+void BytecodeCompiler::PatchJump(const size_t jump) {
+    BytecodeInstruction& instruction = module.code[jump];
+    switch (instruction.op) {
+        case BytecodeOp::Jump: instruction.a = Here(); break;
+        case BytecodeOp::JumpIfZero: instruction.b = Here(); break;
+        default: instruction.c = Here(); break;
+    }
+}
+
+size_t BytecodeCompiler::Emit(const BytecodeOp op, const uint32_t a, const uint32_t b, const uint32_t c) {
+    module.code.push_back({op, a, b, c});
+    return module.code.size() - 1;
+}
+
+uint32_t BytecodeCompiler::VisitVariableDeclaration(const VariableDeclaration& varDecl) {
+    ConvertInto(CompileExpression(*varDecl.value), varDecl.value->type, varDecl.name->type, RegisterOf(*varDecl.name));
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitReturnStatement(const ReturnStatement& returnStmt) {
+    const Expression& value = *returnStmt.returnValue;
+    Emit(BytecodeOp::Return, Convert(CompileExpression(value), value.type, returnType));
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitExpressionStatement(const ExpressionStatement& exprStmt) {
+    CompileExpression(*exprStmt.expression);
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitIfStatement(const IfStatement& ifStmt) {
+    const size_t skipConsequence = CompileBranchIfFalse(*ifStmt.condition);
+    CompileBlock(*ifStmt.consequence);
+    if (!ifStmt.alternative) {
+        PatchJump(skipConsequence);
+        return 0;
+    }
+
+    const size_t skipAlternative = Emit(BytecodeOp::Jump);
+    PatchJump(skipConsequence);
+    CompileBlock(*ifStmt.alternative);
+    PatchJump(skipAlternative);
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitWhileStatement(const WhileStatement& whileStmt) {
+    const uint32_t loop = Here();
+    const size_t exit = CompileBranchIfFalse(*whileStmt.condition);
+    CompileBlock(*whileStmt.body);
+    Emit(BytecodeOp::Jump, loop);
+    PatchJump(exit);
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitAssignmentStatement(const AssignmentStatement& assignStmt) {
+    const Expression& value = *assignStmt.value;
+    const Type type = assignStmt.name->type;
+    if (assignStmt.name->storage == StorageKind::Global) {
+        Emit(BytecodeOp::StoreGlobal, GlobalOf(*assignStmt.name), Convert(CompileExpression(value), value.type, type));
+    } else {
+        ConvertInto(CompileExpression(value), value.type, type, RegisterOf(*assignStmt.name));
+    }
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitUnsafeStatement(const UnsafeStatement& unsafeStmt) {
+    CompileBlock(*unsafeStmt.body);
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign) {
+    // Value first, then the pointer, as CodeGenerator evaluates them. The
+    // whole cell is written, extended from the type pointed to.
+    const Expression& valueExpression = *derefAssign.value;
+    uint32_t value = Convert(CompileExpression(valueExpression), valueExpression.type,
+                             PointeeOf(derefAssign.pointer->type));
+    if (value < firstTemporary && ContainsCall(*derefAssign.pointer)) {
+        const uint32_t copy = Temporary();
+        Emit(BytecodeOp::Move, copy, value);
+        value = copy;
+    }
+    Emit(BytecodeOp::Store, CompileExpression(*derefAssign.pointer), value);
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitInlineAssemblyStatement(const InlineAssemblyStatement&) {
+    module.skippedAssemblyBlocks++;
+    return 0;
+}
+
+uint32_t BytecodeCompiler::VisitIntegerLiteral(const IntegerLiteral& intLiteral) {
+    const uint32_t reg = Temporary();
+    const auto bits = static_cast<uint64_t>(intLiteral.value);
+    Emit(BytecodeOp::LoadImm, reg, static_cast<uint32_t>(bits), static_cast<uint32_t>(bits >> 32));
+    return reg;
+}
+
+uint32_t BytecodeCompiler::VisitIdentifier(const Identifier& ident) {
+    switch (ident.storage) {
+        case StorageKind::Frame:
+            return RegisterOf(ident);
+        case StorageKind::Global: {
+            const uint32_t reg = Temporary();
+            Emit(BytecodeOp::LoadGlobal, reg, GlobalOf(ident));
+            return reg;
+        }
+        case StorageKind::Unresolved:
+            break;
+    }
+    throw std::runtime_error("Unresolved identifier: " + std::string(ident.value));
+}
+
+const Expression* BytecodeCompiler::ResumeExpression(const Expression& expression, const uint32_t step) {
+    switch (expression.kind) {
+        case NodeKind::InfixExpression: {
+            // The left operand is evaluated first; a local read straight from
+            // its register is copied if the right side could change it meanwhile
+            const auto& infix = static_cast<const InfixExpression&>(expression);
+            if (step == 0) {
+                return infix.left;
+            }
+            const Type type = infix.operandType;
+            if (step == 1) {
+                values.back() = Convert(values.back(), infix.left->type, type);
+                if (values.back() < firstTemporary && ContainsCall(*infix.right)) {
+                    const uint32_t copy = Temporary();
+                    Emit(BytecodeOp::Move, copy, values.back());
+                    values.back() = copy;
+                }
+                return infix.right;
+            }
+            const uint32_t right = Convert(values.back(), infix.right->type, type);
+            values.pop_back();
+            const uint32_t left = values.back();
+
+            BytecodeOp op;
+            bool wraps = Wraps32(type);
+            switch (infix.operation) {
+                case Operator::Add: op = BytecodeOp::Add; break;
+                case Operator::Sub: op = BytecodeOp::Sub; break;
+                case Operator::Mul: op = BytecodeOp::Mul; break;
+                case Operator::Div:
+                    // The quotient of extended values is extended too
+                    op = type.IsUnsigned() ? BytecodeOp::DivU : wraps ? BytecodeOp::Div32 : BytecodeOp::Div;
+                    wraps = false;
+                    break;
+                default: {
+                    const Comparison* comparison = ComparisonOf(infix.operation);
+                    op = type.IsUnsigned() ? comparison->setUnsigned : comparison->set;
+                    wraps = false;
+                    break;
+                }
+            }
+            values.back() = Temporary();
+            Emit(op, values.back(), left, right);
+            if (wraps) {
+                Emit(BytecodeOp::Extend, values.back(), values.back(), static_cast<uint32_t>(type.base));
+            }
+            return nullptr;
+        }
+        case NodeKind::CallExpression: {
+            // Arguments go to consecutive registers at the top of the window,
+            // where the callee's window will start; evaluated last to first
+            // like the pushes CodeGenerator emits. The base register waits on
+            // values under the argument being evaluated.
+            const auto& call = static_cast<const CallExpression&>(expression);
+            const auto argumentCount = static_cast<uint32_t>(call.arguments.size());
+            if (step == 0) {
+                values.push_back(nextTemporary);
+                nextTemporary += std::max(argumentCount, 1u);
+                frameSize = std::max(frameSize, nextTemporary);
+            } else {
+                // Converted to the parameter's type, which native code does
+                // when the callee reads it
+                const uint32_t argument = values.back();
+                values.pop_back();
+                const Expression& value = *call.arguments[argumentCount - step];
+                const auto& callee = *declarations[static_cast<size_t>(functionIndex[call.function->symbol])];
+                ConvertInto(argument, value.type, callee.parameterTypes[argumentCount - step]->type,
+                            values.back() + argumentCount - step);
+            }
+            if (step < argumentCount) {
+                return call.arguments[argumentCount - 1 - step];
+            }
+
+            const uint32_t base = values.back();
+            Emit(BytecodeOp::Call, base, static_cast<uint32_t>(functionIndex[call.function->symbol]));
+            nextTemporary = base + 1;
+            return nullptr;
+        }
+        case NodeKind::PrefixExpression: {
+            const auto& prefix = static_cast<const PrefixExpression&>(expression);
+            if (step == 0) {
+                return prefix.right;
+            }
+            const bool negate = prefix.operation == Operator::Neg;
+            const uint32_t operand = values.back();
+            values.back() = Temporary();
+            Emit(negate ? BytecodeOp::Neg : BytecodeOp::Not, values.back(), operand);
+            if (negate && Wraps32(prefix.type)) {
+                Emit(BytecodeOp::Extend, values.back(), values.back(), static_cast<uint32_t>(prefix.type.base));
+            }
+            return nullptr;
+        }
+        case NodeKind::DereferenceExpression: {
+            if (step == 0) {
+                return static_cast<const DereferenceExpression&>(expression).operand;
+            }
+            const uint32_t pointer = values.back();
+            values.back() = Temporary();
+            Emit(BytecodeOp::Load, values.back(), pointer, LoadTypeOf(expression.type));
+            return nullptr;
+        }
+        default:
+            values.push_back(Visit(expression));
+            return nullptr;
+    }
+}
+
+uint32_t BytecodeCompiler::VisitAddressOfExpression(const AddressOfExpression& addrOf) {
+    // Sema only lets identifiers have their address taken
+    const auto* ident = static_cast<const Identifier*>(addrOf.operand);
+    const uint32_t result = Temporary();
+    if (ident->storage == StorageKind::Global) {
+        Emit(BytecodeOp::AddrGlobal, result, GlobalOf(*ident));
+    } else {
+        Emit(BytecodeOp::AddrLocal, result, RegisterOf(*ident));
+    }
+    return result;
+}
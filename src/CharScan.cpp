@@ -0,0 +1,141 @@
+#include "CharScan.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#define APX_SCAN_SIMD
+#endif
+
+namespace scan {
+
+#ifdef APX_SCAN_SIMD
+    namespace {
+        // Thin wrappers so the kernels below are written once for both widths
+#if defined(__AVX2__)
+        using Vec = __m256i;
+        constexpr size_t WIDTH = 32;
+        constexpr uint32_t FULL_MASK = 0xFFFFFFFFu;
+        Vec Load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        Vec Splat(const char c) { return _mm256_set1_epi8(c); }
+        Vec Eq(const Vec a, const char c) { return _mm256_cmpeq_epi8(a, Splat(c)); }
+        Vec Or(const Vec a, const Vec b) { return _mm256_or_si256(a, b); }
+        uint32_t Mask(const Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+        // Unsigned lo <= v <= hi, per byte
+        Vec InRange(const Vec v, const char lo, const char hi) {
+            const Vec shifted = _mm256_sub_epi8(v, Splat(lo));
+            return _mm256_cmpeq_epi8(_mm256_subs_epu8(shifted, Splat(static_cast<char>(hi - lo))), _mm256_setzero_si256());
+        }
+        Vec FoldCase(const Vec v) { return _mm256_or_si256(v, Splat(0x20)); }
+#else
+        using Vec = __m128i;
+        constexpr size_t WIDTH = 16;
+        constexpr uint32_t FULL_MASK = 0xFFFFu;
+        Vec Load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+        Vec Splat(const char c) { return _mm_set1_epi8(c); }
+        Vec Eq(const Vec a, const char c) { return _mm_cmpeq_epi8(a, Splat(c)); }
+        Vec Or(const Vec a, const Vec b) { return _mm_or_si128(a, b); }
+        uint32_t Mask(const Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+        Vec InRange(const Vec v, const char lo, const char hi) {
+            const Vec shifted = _mm_sub_epi8(v, Splat(lo));
+            return _mm_cmpeq_epi8(_mm_subs_epu8(shifted, Splat(static_cast<char>(hi - lo))), _mm_setzero_si128());
+        }
+        Vec FoldCase(const Vec v) { return _mm_or_si128(v, Splat(0x20)); }
+#endif
+
+        uint32_t WhitespaceMask(const Vec v) {
+            return Mask(Or(Eq(v, ' '), InRange(v, '\t', '\r')));
+        }
+
+        uint32_t IdentifierMask(const Vec v) {
+            const Vec letter = InRange(FoldCase(v), 'a', 'z');
+            return Mask(Or(Or(letter, InRange(v, '0', '9')), Eq(v, '_')));
+        }
+
+        uint32_t StructuralMask(const Vec v) {
+            const Vec braces = Or(Eq(v, '{'), Eq(v, '}'));
+            const Vec delimiters = Or(Or(Eq(v, '"'), Eq(v, '/')), Or(Eq(v, ';'), Eq(v, '\0')));
+            return Mask(Or(braces, delimiters));
+        }
+    }
+#endif
+
+    size_t SkipWhitespace(const std::string_view text, size_t pos) {
+        const char* data = text.data();
+        const size_t end = text.size();
+#ifdef APX_SCAN_SIMD
+        while (pos + WIDTH <= end) {
+            const uint32_t nonSpace = ~WhitespaceMask(Load(data + pos)) & FULL_MASK;
+            if (nonSpace) {
+                return pos + static_cast<size_t>(__builtin_ctz(nonSpace));
+            }
+            pos += WIDTH;
+        }
+#endif
+        while (pos < end && Is(data[pos], SPACE)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    size_t SkipIdentifier(const std::string_view text, size_t pos) {
+        const char* data = text.data();
+        const size_t end = text.size();
+#ifdef APX_SCAN_SIMD
+        while (pos + WIDTH <= end) {
+            const uint32_t other = ~IdentifierMask(Load(data + pos)) & FULL_MASK;
+            if (other) {
+                return pos + static_cast<size_t>(__builtin_ctz(other));
+            }
+            pos += WIDTH;
+        }
+#endif
+        while (pos < end && Is(data[pos], IDENT)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    size_t FindNewline(const std::string_view text, size_t pos) {
+        const char* data = text.data();
+        const size_t end = text.size();
+#ifdef APX_SCAN_SIMD
+        while (pos + WIDTH <= end) {
+            if (const uint32_t nl = Mask(Eq(Load(data + pos), '\n'))) {
+                return pos + static_cast<size_t>(__builtin_ctz(nl));
+            }
+            pos += WIDTH;
+        }
+#endif
+        while (pos < end && data[pos] != '\n') {
+            ++pos;
+        }
+        return pos;
+    }
+
+    size_t FindStructural(const std::string_view text, size_t pos) {
+        const char* data = text.data();
+        const size_t end = text.size();
+#ifdef APX_SCAN_SIMD
+        while (pos + WIDTH <= end) {
+            if (const uint32_t structural = StructuralMask(Load(data + pos))) {
+                return pos + static_cast<size_t>(__builtin_ctz(structural));
+            }
+            pos += WIDTH;
+        }
+#endif
+        while (pos < end && !Is(data[pos], STRUCTURAL)) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    const char* KernelName() {
+#if defined(__AVX2__)
+        return "avx2";
+#elif defined(__SSE2__)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+} // namespace scan
@@ -1,367 +1,582 @@
-
 #include "CodeGenerator.h"
 #include <iostream>
 #include <stdexcept>
 #include <functional>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include "NasmPrinter.h"
+#include "Profiler.h"
+
+namespace {
+    constexpr Operand RAX = Operand::Register(Reg::RAX);
+    constexpr Operand RBX = Operand::Register(Reg::RBX);
+    constexpr Operand RSP = Operand::Register(Reg::RSP);
+    constexpr Operand RBP = Operand::Register(Reg::RBP);
+    constexpr Operand RDI = Operand::Register(Reg::RDI);
+    constexpr Operand EAX = Operand::Register(Reg::RAX, 4);
+    constexpr Operand EDX = Operand::Register(Reg::RDX, 4);
+    constexpr Operand AL = Operand::Register(Reg::RAX, 1);
+    constexpr Type I64 = Type(BaseType::I64);
+
+    // Memory operand of a resolved identifier, e.g. [rbp-8] or [name]
+    Operand AddressOf(const Identifier& ident, const uint8_t size) {
+        return ident.storage == StorageKind::Global ? Operand::Global(ident.value, size)
+                                                    : Operand::Memory(Reg::RBP, ident.offset, size);
+    }
+
+    Operand Imm(const int64_t value) {
+        return Operand::Immediate(value);
+    }
+
+    // Arithmetic and comparisons work on 32 or 64 bits
+    uint8_t WidthOf(const Type type) {
+        return type.Size() == 8 ? 8 : 4;
+    }
+
+    // Condition that sets the result of a comparison operator
+    Cond ComparisonOf(const Operator operation, const bool isUnsigned) {
+        switch (operation) {
+            case Operator::Eq: return Cond::E;
+            case Operator::Ne: return Cond::NE;
+            case Operator::Lt: return isUnsigned ? Cond::B : Cond::L;
+            case Operator::Gt: return isUnsigned ? Cond::A : Cond::G;
+            case Operator::Le: return isUnsigned ? Cond::BE : Cond::LE;
+            default: return isUnsigned ? Cond::AE : Cond::GE;
+        }
+    }
+
+    // Values are held in rax extended to 64 bits as their type says, except
+    // the i32 results of 32-bit arithmetic: those are only valid in eax, and
+    // are extended when they are used as 64-bit values
+    bool IsExtended(const Expression& value) {
+        if (const auto* infix = DynCast<InfixExpression>(&value)) {
+            return infix->operation >= Operator::Eq;
+        }
+        return !Is<PrefixExpression>(&value) || static_cast<const PrefixExpression&>(value).operation == Operator::Not;
+    }
+}
+
+void CodeGenerator::Import(const ModuleInterface& module) {
+    for (const auto& function : module.functions) {
+        externs.push_back(function.name);
+    }
+    for (const auto& variable : module.variables) {
+        externs.push_back(variable.name);
+    }
+}
 
 std::string CodeGenerator::Generate(const Program& program, const APXC_OPERATION operation) {
-    output.str("");
-    output.clear();
+    std::string text;
+    OutputSink out(text);
+    Generate(program, operation, out);
+    out.Flush();
+    return text;
+}
 
-    // Add sections
-    output << "section .data" << std::endl;
-    
-    // Generate global variables in data section
+void CodeGenerator::Generate(const Program& program, const APXC_OPERATION operation, OutputSink& out) {
+    std::vector<const FunctionDeclaration*> declarations;
+    bool hasMain = false;
+    const MachineModule module = LowerDeclarations(program, operation, declarations, hasMain);
+    nasm::PrintHeader(out, module);
+
+    // Print each function as soon as it is generated instead of keeping the
+    // machine code of the whole module around
+    if (UsesPool(declarations.size())) {
+        // Workers print into per-function texts, which are passed on in
+        // source order as soon as every function before them is done
+        std::vector<std::string> functionTexts(declarations.size());
+        std::vector<bool> done(declarations.size());
+        size_t nextToWrite = 0;
+        std::mutex outMutex;
+        GenerateFunctions(declarations, [&](const size_t i, const MachineFunction& generated) {
+            {
+                OutputSink functionOut(functionTexts[i], 4096);
+                nasm::PrintFunction(functionOut, generated);
+            }
+            std::lock_guard<std::mutex> lock(outMutex);
+            done[i] = true;
+            for (; nextToWrite < done.size() && done[nextToWrite]; ++nextToWrite) {
+                out += functionTexts[nextToWrite];
+                std::string().swap(functionTexts[nextToWrite]);
+            }
+        });
+    } else {
+        GenerateFunctions(declarations, [&](size_t, const MachineFunction& generated) {
+            nasm::PrintFunction(out, generated);
+        });
+    }
+
+    if (operation == APXC_OPERATION::APXC_COMPILE_W_ENTRY) {
+        MachineFunction entry;
+        LowerEntry(entry, hasMain);
+        nasm::PrintFunction(out, entry);
+    }
+}
+
+MachineModule CodeGenerator::Lower(const Program& program, const APXC_OPERATION operation) {
+    return Lower(program, operation, {});
+}
+
+MachineModule CodeGenerator::Lower(const Program& program, const APXC_OPERATION operation,
+                                   const std::vector<bool>& stale) {
+    std::vector<const FunctionDeclaration*> declarations;
+    bool hasMain = false;
+    MachineModule module = LowerDeclarations(program, operation, declarations, hasMain);
+
+    module.functions.resize(declarations.size());
+    std::vector<const FunctionDeclaration*> generate;
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < declarations.size(); ++i) {
+        if (i >= stale.size() || stale[i]) {
+            generate.push_back(declarations[i]);
+            indices.push_back(i);
+        } else {
+            module.functions[i].name = declarations[i]->name->value;
+        }
+    }
+    GenerateFunctions(generate, [&](const size_t i, MachineFunction& generated) {
+        module.functions[indices[i]] = std::move(generated);
+    });
+
+    if (operation == APXC_OPERATION::APXC_COMPILE_W_ENTRY) {
+        LowerEntry(module.functions.emplace_back(), hasMain);
+    }
+    return module;
+}
+
+MachineModule CodeGenerator::LowerDeclarations(const Program& program, const APXC_OPERATION operation,
+                                               std::vector<const FunctionDeclaration*>& declarations,
+                                               bool& hasMain) {
+    MachineModule module;
+
+    // Generate global variables in data section. Integers keep a full 8-byte
+    // cell and are accessed with the width of their type.
     for (const auto& stmt : program.statements) {
-        if (const auto* varDecl = dynamic_cast<const VariableDeclaration*>(stmt.get())) {
-            if (varDecl->isConst || varDecl->isGlobal || !dynamic_cast<const FunctionDeclaration*>(stmt.get())) {
-                // Handle alignment attribute
-                if (varDecl->alignment > 0) {
-                    output << "    align " << varDecl->alignment << std::endl;
-                }
-                
-                output << "    " << varDecl->name->value << ": ";
-                if (varDecl->type && varDecl->type->value == "f32") {
-                    output << "dd ";
-                } else {
-                    output << "dq ";
-                }
-                // For now, just put placeholder values - proper constant evaluation needed
-                if (const auto* intLit = dynamic_cast<const IntegerLiteral*>(varDecl->value.get())) {
-                    output << intLit->value;
-                } else if (const auto* floatLit = dynamic_cast<const FloatLiteral*>(varDecl->value.get())) {
-                    output << floatLit->value;
-                } else {
-                    output << "0"; // Default value
-                }
-                output << std::endl;
+        if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+            const Type type = varDecl->name->type;
+            DataItem item;
+            item.name = varDecl->name->value;
+            item.alignment = varDecl->alignment;
+            item.size = type.base == BaseType::F32 ? 4 : 8;
+            // For now, just put placeholder values - proper constant evaluation needed
+            if (const auto* intLit = DynCast<IntegerLiteral>(varDecl->value)) {
+                item.isFloat = type.IsFloat();
+                item.intValue = Truncate(intLit->value, type);
+                item.floatValue = static_cast<double>(intLit->value);
+            } else if (const auto* floatLit = DynCast<FloatLiteral>(varDecl->value)) {
+                item.isFloat = true;
+                item.floatValue = floatLit->value;
             }
+            module.data.push_back(item);
         }
     }
-    
-    output << std::endl;
-    output << "section .bss" << std::endl;
-    output << std::endl;
-    output << "section .text" << std::endl;
-    output << "default rel" << std::endl;
+
     if (operation == APXC_OPERATION::APXC_COMPILE_W_ENTRY) {
-        output << "global _start" << std::endl;
+        module.globals.emplace_back("_start");
     }
-    
+
     // Export global symbols
     for (const auto& stmt : program.statements) {
-        if (const auto* varDecl = dynamic_cast<const VariableDeclaration*>(stmt.get())) {
+        if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
             if (varDecl->isGlobal) {
-                output << "global " << varDecl->name->value << std::endl;
+                module.globals.push_back(varDecl->name->value);
             }
-        } else if (const auto* funcDecl = dynamic_cast<const FunctionDeclaration*>(stmt.get())) {
-            for (const auto& attr : funcDecl->attributes) {
-                if (attr->name == "global") {
-                    output << "global " << funcDecl->name->value << std::endl;
-                    break;
-                }
+        } else if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+            if (funcDecl->isGlobal) {
+                module.globals.push_back(funcDecl->name->value);
             }
         }
     }
-    
-    output << std::endl;
 
-    // First pass: Register global variables and populate functions map
+    module.externs = externs;
+
+    // Identifiers were bound to their slots and expressions typed by Sema, so
+    // no names are looked up while the functions are generated
+    hasMain = false;
     for (const auto& stmt : program.statements) {
-        if (const auto* varDecl = dynamic_cast<const VariableDeclaration*>(stmt.get())) {
-            symbolTable.DefineGlobal(varDecl->name->value);
-        } else if (const auto* funcDecl = dynamic_cast<const FunctionDeclaration*>(stmt.get())) {
-            std::string funcName = funcDecl->name->value;
-            functions[funcName] = funcDecl;
+        if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+            hasMain = hasMain || funcDecl->name->value == "main";
+            declarations.push_back(funcDecl);
         }
     }
+    return module;
+}
 
-    // Second pass: Generate code for all function declarations
-    for (const auto& stmt : program.statements) {
-        if (dynamic_cast<const FunctionDeclaration*>(stmt.get())) {
-            GenerateStatement(*stmt);
-        }
+void CodeGenerator::LowerEntry(MachineFunction& entry, const bool hasMain) {
+    function = &entry;
+    function->name = "_start";
+    Emit(Opcode::Push, RBP);
+    Emit(Opcode::Mov, RBP, RSP);
+
+    // Call the APX main function
+    if (hasMain) {
+        Emit(Opcode::Call, Operand::Symbol("main"));
+    } else {
+        Emit(Opcode::Mov, RAX, Imm(0)); // Default return value
     }
-    if (operation == APXC_OPERATION::APXC_COMPILE_W_ENTRY) {
-        // Entry point
-        output << "_start:" << std::endl;
-        output << "    push rbp" << std::endl;
-        output << "    mov rbp, rsp" << std::endl;
-
-        // Call the APX main function
-        if (functions.find("main") != functions.end()) {
-            output << "    call main" << std::endl;
-        } else {
-            output << "    mov rax, 0" << std::endl; // Default return value
+
+    // Exit with the return value
+    Emit(Opcode::Mov, RDI, RAX);
+    Emit(Opcode::Mov, RAX, Imm(60));
+    Emit(Opcode::Syscall);
+    function = nullptr;
+}
+
+bool CodeGenerator::UsesPool(const size_t functionCount) const {
+    return pool && pool->GetThreadCount() > 1 && functionCount > 1;
+}
+
+void CodeGenerator::GenerateFunctions(const std::vector<const FunctionDeclaration*>& declarations,
+                                      const FunctionConsumer& consume) {
+    if (!UsesPool(declarations.size())) {
+        MachineFunction scratch;
+        for (size_t i = 0; i < declarations.size(); ++i) {
+            GenerateFunction(*declarations[i], scratch);
+            consume(i, scratch);
         }
+        return;
+    }
 
-        // Exit with the return value
-        output << "    mov rdi, rax" << std::endl;
-        output << "    mov rax, 60" << std::endl;
-        output << "    syscall" << std::endl;
-    }
-    return output.str();
-}
-
-void CodeGenerator::GenerateStatement(const Statement& statement) {
-    if (const auto* varDecl = dynamic_cast<const VariableDeclaration*>(&statement)) {
-        symbolTable.Define(varDecl->name->value);
-        GenerateExpression(*varDecl->value);
-        output << "    mov [rbp" << symbolTable.Get(varDecl->name->value) << "], rax" << std::endl;
-    } else if (const auto* returnStmt = dynamic_cast<const ReturnStatement*>(&statement)) {
-        GenerateExpression(*returnStmt->returnValue);
-        output << "    leave" << std::endl;
-        output << "    ret" << std::endl;
-    } else if (const auto* funcDecl = dynamic_cast<const FunctionDeclaration*>(&statement)) {
-        std::string funcName = funcDecl->name->value;
-        
-        output << funcName << ":" << std::endl;
-        output << "    push rbp" << std::endl;
-        output << "    mov rbp, rsp" << std::endl;
-        
-        // Calculate stack space needed for local variables
-        int localVarCount = 0;
-        std::function<void(const BlockStatement*)> countVars = [&](const BlockStatement* block) {
-            for (const auto& stmt : block->statements) {
-                if (dynamic_cast<const VariableDeclaration*>(stmt.get())) {
-                    localVarCount++;
-                } else if (const auto* unsafeStmt = dynamic_cast<const UnsafeStatement*>(stmt.get())) {
-                    countVars(unsafeStmt->body.get());
-                }
+    // Split into a few contiguous chunks per worker so queueing stays cheap
+    // next to the work itself. Consumers place results by index, so the output
+    // is in source order however the chunks are scheduled; errors are rethrown
+    // in source order too.
+    const size_t chunkCount = std::min(declarations.size(), static_cast<size_t>(pool->GetThreadCount()) * 4);
+    std::vector<std::exception_ptr> errors(chunkCount);
+    pool->ParallelFor(chunkCount, [&](const size_t chunk) {
+        const size_t begin = declarations.size() * chunk / chunkCount;
+        const size_t end = declarations.size() * (chunk + 1) / chunkCount;
+        try {
+            CodeGenerator worker;
+            MachineFunction scratch;
+            for (size_t i = begin; i < end; ++i) {
+                worker.GenerateFunction(*declarations[i], scratch);
+                consume(i, scratch);
             }
-        };
-        countVars(funcDecl->body.get());
-        if (localVarCount > 0) {
-            output << "    sub rsp, " << (localVarCount * 8) << std::endl;
+        } catch (...) {
+            errors[chunk] = std::current_exception();
+        }
+    });
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
         }
+    }
+}
 
-        symbolTable.EnterScope();
+void CodeGenerator::GenerateFunction(const FunctionDeclaration& declaration, MachineFunction& generated) {
+    PROFILE_SCOPE(profile::FUNCTION, declaration.name->value);
+    generated.code.clear();
+    function = &generated;
+    labelCounter = 0;
+    loopCounter = 0;
+    GenerateStatement(declaration);
+    function = nullptr;
+}
+
+void CodeGenerator::VisitVariableDeclaration(const VariableDeclaration& varDecl) {
+    GenerateExpression(*varDecl.value);
+    EmitStore(AddressOf(*varDecl.name, 8), *varDecl.value, varDecl.name->type);
+}
+
+void CodeGenerator::VisitReturnStatement(const ReturnStatement& returnStmt) {
+    GenerateExpression(*returnStmt.returnValue);
+    Extend(*returnStmt.returnValue, returnType);
+    Emit(Opcode::Leave);
+    Emit(Opcode::Ret);
+}
 
-        // Process parameters and add them to symbol table
-        int paramOffset = 16; // rbp + 8 is return address, rbp + 16 is first argument
-        for (const auto& param : funcDecl->parameters) {
-            symbolTable.DefineParameter(param->value, paramOffset);
-            paramOffset += 8;
+void CodeGenerator::VisitFunctionDeclaration(const FunctionDeclaration& funcDecl) {
+    function->name = funcDecl.name->value;
+    returnType = funcDecl.returnType->type;
+    Emit(Opcode::Push, RBP);
+    Emit(Opcode::Mov, RBP, RSP);
+
+    // Sema handed out one slot per local variable
+    if (funcDecl.frameSize > 0) {
+        Emit(Opcode::Sub, RSP, Imm(funcDecl.frameSize));
+    }
+
+    bool hasReturn = false;
+    for (const auto& stmt : funcDecl.body->statements) {
+        GenerateStatement(*stmt);
+        if (Is<ReturnStatement>(stmt)) {
+            hasReturn = true;
+            break; // Don't generate code after return
         }
+    }
+
+    // Add default return if no explicit return
+    if (!hasReturn) {
+        Emit(Opcode::Mov, RAX, Imm(0));
+        Emit(Opcode::Leave);
+        Emit(Opcode::Ret);
+    }
+}
+
+void CodeGenerator::VisitExpressionStatement(const ExpressionStatement& exprStmt) {
+    GenerateExpression(*exprStmt.expression);
+}
 
-        bool hasReturn = false;
-        for (const auto& stmt : funcDecl->body->statements) {
+void CodeGenerator::VisitIfStatement(const IfStatement& ifStmt) {
+    int currentLabel = labelCounter++;
+    const Operand elseLabel = Operand::Label(".else", currentLabel);
+    const Operand endLabel = Operand::Label(".endif", currentLabel);
+
+    // Generate condition
+    GenerateExpression(*ifStmt.condition);
+    EmitTest(ifStmt.condition->type);
+    Emit(Opcode::Jcc, Cond::Z, elseLabel);
+
+    // Generate consequence block
+    for (const auto& stmt : ifStmt.consequence->statements) {
+        GenerateStatement(*stmt);
+    }
+    Emit(Opcode::Jmp, endLabel);
+
+    // Generate else block (if exists)
+    Emit(Opcode::Label, elseLabel);
+    if (ifStmt.alternative) {
+        for (const auto& stmt : ifStmt.alternative->statements) {
             GenerateStatement(*stmt);
-            if (dynamic_cast<const ReturnStatement*>(stmt.get())) {
-                hasReturn = true;
-                break; // Don't generate code after return
-            }
         }
+    }
 
-        symbolTable.LeaveScope();
+    Emit(Opcode::Label, endLabel);
+}
 
-        // Add default return if no explicit return
-        if (!hasReturn) {
-            output << "    mov rax, 0" << std::endl;
-            output << "    leave" << std::endl;
-            output << "    ret" << std::endl;
-        }
-    } else if (const auto* exprStmt = dynamic_cast<const ExpressionStatement*>(&statement)) {
-        GenerateExpression(*exprStmt->expression);
-    } else if (const auto* ifStmt = dynamic_cast<const IfStatement*>(&statement)) {
-        static int labelCounter = 0;
-        int currentLabel = labelCounter++;
-        
-        // Generate condition
-        GenerateExpression(*ifStmt->condition);
-        output << "    test rax, rax" << std::endl;
-        output << "    jz .else" << currentLabel << std::endl;
-        
-        // Generate consequence block
-        for (const auto& stmt : ifStmt->consequence->statements) {
-            GenerateStatement(*stmt);
+void CodeGenerator::VisitWhileStatement(const WhileStatement& whileStmt) {
+    int currentLoop = loopCounter++;
+    const Operand loopLabel = Operand::Label(".loop", currentLoop);
+    const Operand endLabel = Operand::Label(".endloop", currentLoop);
+
+    Emit(Opcode::Label, loopLabel);
+
+    // Generate condition
+    GenerateExpression(*whileStmt.condition);
+    EmitTest(whileStmt.condition->type);
+    Emit(Opcode::Jcc, Cond::Z, endLabel);
+
+    // Generate loop body
+    for (const auto& stmt : whileStmt.body->statements) {
+        GenerateStatement(*stmt);
+    }
+
+    Emit(Opcode::Jmp, loopLabel);
+    Emit(Opcode::Label, endLabel);
+}
+
+void CodeGenerator::VisitAssignmentStatement(const AssignmentStatement& assignStmt) {
+    GenerateExpression(*assignStmt.value);
+    EmitStore(AddressOf(*assignStmt.name, 8), *assignStmt.value, assignStmt.name->type);
+}
+
+void CodeGenerator::VisitUnsafeStatement(const UnsafeStatement& unsafeStmt) {
+    // Generate code for unsafe block - just execute the body
+    for (const auto& stmt : unsafeStmt.body->statements) {
+        GenerateStatement(*stmt);
+    }
+}
+
+void CodeGenerator::VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign) {
+    // Generate value first
+    const Type target = PointeeOf(derefAssign.pointer->type);
+    GenerateExpression(*derefAssign.value);
+    Widen(*derefAssign.value, target);
+    Emit(Opcode::Push, RAX); // Save value
+
+    // Generate pointer address
+    GenerateExpression(*derefAssign.pointer);
+    Widen(*derefAssign.pointer, I64);
+    Emit(Opcode::Mov, RBX, RAX); // Pointer in rbx
+    Emit(Opcode::Pop, RAX);      // Value in rax
+
+    // Store value at pointer location
+    Emit(Opcode::Mov, Operand::Memory(Reg::RBX, 0, target.Size()), Operand::Register(Reg::RAX, target.Size()));
+}
+
+void CodeGenerator::VisitInlineAssemblyStatement(const InlineAssemblyStatement& asmStmt) {
+    // Insert raw assembly code directly, one line per instruction with the
+    // leading whitespace trimmed (the printer adds its own indentation)
+    std::string_view code = asmStmt.assembly_code;
+    while (!code.empty()) {
+        const size_t newline = code.find('\n');
+        std::string_view line = code.substr(0, newline);
+        code = newline == std::string_view::npos ? std::string_view() : code.substr(newline + 1);
+
+        const size_t start = line.find_first_not_of(" \t");
+        if (start != std::string_view::npos) {
+            Operand text;
+            text.name = line.substr(start);
+            Emit(Opcode::Raw, text);
         }
-        output << "    jmp .endif" << currentLabel << std::endl;
-        
-        // Generate else block (if exists)
-        output << ".else" << currentLabel << ":" << std::endl;
-        if (ifStmt->alternative) {
-            for (const auto& stmt : ifStmt->alternative->statements) {
-                GenerateStatement(*stmt);
+    }
+}
+
+// Emits the same code as the obvious recursive lowering: every operand is
+// evaluated into rax, and values waiting for a sibling are kept on the
+// machine stack
+const Expression* CodeGenerator::ResumeExpression(const Expression& expression, const uint32_t step) {
+    switch (expression.kind) {
+        case NodeKind::InfixExpression: {
+            const auto& infix = static_cast<const InfixExpression&>(expression);
+            if (step == 0) {
+                return infix.left;
             }
+            if (step == 1) {
+                Widen(*infix.left, infix.operandType);
+                Emit(Opcode::Push, RAX);
+                return infix.right;
+            }
+            Widen(*infix.right, infix.operandType);
+            EmitInfixOperator(infix);
+            return nullptr;
         }
-        
-        output << ".endif" << currentLabel << ":" << std::endl;
-    } else if (const auto* whileStmt = dynamic_cast<const WhileStatement*>(&statement)) {
-        static int loopCounter = 0;
-        int currentLoop = loopCounter++;
-        
-        output << ".loop" << currentLoop << ":" << std::endl;
-        
-        // Generate condition
-        GenerateExpression(*whileStmt->condition);
-        output << "    test rax, rax" << std::endl;
-        output << "    jz .endloop" << currentLoop << std::endl;
-        
-        // Generate loop body
-        for (const auto& stmt : whileStmt->body->statements) {
-            GenerateStatement(*stmt);
-        }
-        
-        output << "    jmp .loop" << currentLoop << std::endl;
-        output << ".endloop" << currentLoop << ":" << std::endl;
-    } else if (const auto* assignStmt = dynamic_cast<const AssignmentStatement*>(&statement)) {
-        GenerateExpression(*assignStmt->value);
-        if (symbolTable.IsGlobal(assignStmt->name->value)) {
-            output << "    mov [" << assignStmt->name->value << "], rax" << std::endl;
-        } else {
-            int offset = symbolTable.Get(assignStmt->name->value);
-            if (offset >= 0) {
-                output << "    mov [rbp+" << offset << "], rax" << std::endl;
-            } else {
-                output << "    mov [rbp" << offset << "], rax" << std::endl;
+        case NodeKind::CallExpression: {
+            // Push arguments onto the stack in correct order (last argument
+            // first). They are passed extended to 64 bits, so a callee can
+            // read them at the width of its parameters whatever they are.
+            const auto& call = static_cast<const CallExpression&>(expression);
+            const size_t count = call.arguments.size();
+            if (step > 0) {
+                Widen(*call.arguments[count - step], I64);
+                Emit(Opcode::Push, RAX);
+            }
+            if (step < count) {
+                return call.arguments[count - 1 - step];
+            }
+
+            // Call the function (checked to exist by Sema)
+            Emit(Opcode::Call, Operand::Symbol(call.function->value));
+
+            // Clean up arguments from the stack
+            if (count != 0) {
+                Emit(Opcode::Add, RSP, Imm(static_cast<int64_t>(count * 8)));
             }
+            return nullptr;
         }
-    } else if (const auto* unsafeStmt = dynamic_cast<const UnsafeStatement*>(&statement)) {
-        // Generate code for unsafe block - just execute the body
-        for (const auto& stmt : unsafeStmt->body->statements) {
-            GenerateStatement(*stmt);
+        case NodeKind::PrefixExpression: {
+            const auto& prefix = static_cast<const PrefixExpression&>(expression);
+            if (step == 0) {
+                return prefix.right;
+            }
+            EmitPrefixOperator(prefix);
+            return nullptr;
         }
-    } else if (const auto* derefAssign = dynamic_cast<const DereferenceAssignmentStatement*>(&statement)) {
-        // Generate value first
-        GenerateExpression(*derefAssign->value);
-        output << "    push rax" << std::endl; // Save value
-        
-        // Generate pointer address
-        GenerateExpression(*derefAssign->pointer);
-        output << "    mov rbx, rax" << std::endl; // Pointer in rbx
-        output << "    pop rax" << std::endl;     // Value in rax
-        
-        // Store value at pointer location
-        output << "    mov [rbx], rax" << std::endl;
-    } else if (const auto* asmStmt = dynamic_cast<const InlineAssemblyStatement*>(&statement)) {
-        // Insert raw assembly code directly
-        std::string asm_code = asmStmt->assembly_code;
-        if (!asm_code.empty()) {
-            // Split by lines and add proper indentation
-            std::stringstream ss(asm_code);
-            std::string line;
-            while (std::getline(ss, line)) {
-                // Trim whitespace and add indentation
-                size_t start = line.find_first_not_of(" \t");
-                if (start != std::string::npos) {
-                    output << "    " << line.substr(start) << std::endl;
-                }
+        case NodeKind::DereferenceExpression: {
+            // Generate address, then dereference
+            const auto& deref = static_cast<const DereferenceExpression&>(expression);
+            if (step == 0) {
+                return deref.operand;
             }
+            Widen(*deref.operand, I64);
+            EmitLoad(Operand::Memory(Reg::RAX), deref.type);
+            return nullptr;
         }
-    } else {
-        throw std::runtime_error("Unknown statement type");
+        default:
+            Visit(expression);
+            return nullptr;
     }
 }
 
-void CodeGenerator::GenerateExpression(const Expression& expression) {
-    if (const auto* intLiteral = dynamic_cast<const IntegerLiteral*>(&expression)) {
-        output << "    mov rax, " << intLiteral->value << std::endl;
-    } else if (const auto* floatLiteral = dynamic_cast<const FloatLiteral*>(&expression)) {
-        // For now, convert float to integer (proper float support needs SSE)
-        output << "    mov rax, " << static_cast<int64_t>(floatLiteral->value) << std::endl;
-    } else if (const auto* ident = dynamic_cast<const Identifier*>(&expression)) {
-        if (symbolTable.IsGlobal(ident->value)) {
-            output << "    mov rax, [" << ident->value << "]" << std::endl;
-        } else {
-            int offset = symbolTable.Get(ident->value);
-            if (offset >= 0) {
-                output << "    mov rax, [rbp+" << offset << "]" << std::endl;
+void CodeGenerator::EmitInfixOperator(const InfixExpression& infix) {
+    const uint8_t width = WidthOf(infix.operandType);
+    const Operand left = Operand::Register(Reg::RAX, width);
+    const Operand right = Operand::Register(Reg::RBX, width);
+    Emit(Opcode::Mov, right, left); // right operand in rbx
+    Emit(Opcode::Pop, RAX);         // left operand in rax
+
+    switch (infix.operation) {
+        case Operator::Add:
+            Emit(Opcode::Add, left, right);
+            break;
+        case Operator::Sub:
+            Emit(Opcode::Sub, left, right);
+            break;
+        case Operator::Mul:
+            Emit(Opcode::Imul, left, right);
+            break;
+        case Operator::Div:
+            if (infix.operandType.IsUnsigned()) {
+                Emit(Opcode::Xor, EDX, EDX);
+                Emit(Opcode::Div, right);
             } else {
-                output << "    mov rax, [rbp" << offset << "]" << std::endl;
+                Emit(width == 8 ? Opcode::Cqo : Opcode::Cdq);
+                Emit(Opcode::Idiv, right);
             }
-        }
-    } else if (const auto* infix = dynamic_cast<const InfixExpression*>(&expression)) {
-        GenerateExpression(*infix->left);
-        output << "    push rax" << std::endl;
-        GenerateExpression(*infix->right);
-        output << "    mov rbx, rax" << std::endl;  // right operand in rbx
-        output << "    pop rax" << std::endl;       // left operand in rax
-        if (infix->op == "+") {
-            output << "    add rax, rbx" << std::endl;
-        } else if (infix->op == "-") {
-            output << "    sub rax, rbx" << std::endl;
-        } else if (infix->op == "*") {
-            output << "    imul rax, rbx" << std::endl;
-        } else if (infix->op == "/") {
-            output << "    cqo" << std::endl;
-            output << "    idiv rbx" << std::endl;
-        } else if (infix->op == "==") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    sete al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else if (infix->op == "!=") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    setne al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else if (infix->op == "<") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    setl al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else if (infix->op == ">") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    setg al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else if (infix->op == "<=") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    setle al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else if (infix->op == ">=") {
-            output << "    cmp rax, rbx" << std::endl;
-            output << "    setge al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        } else {
-            throw std::runtime_error("Unknown infix operator: " + infix->op);
-        }
-    } else if (const auto* call = dynamic_cast<const CallExpression*>(&expression)) {
-        // Push arguments onto the stack in correct order (last argument first)
-        for (auto it = call->arguments.rbegin(); it != call->arguments.rend(); ++it) {
-            GenerateExpression(**it);
-            output << "    push rax" << std::endl;
-        }
+            break;
+        default:
+            Emit(Opcode::Cmp, left, right);
+            Emit(Opcode::Set, ComparisonOf(infix.operation, infix.operandType.IsUnsigned()), AL);
+            Emit(Opcode::Movzx, EAX, AL);
+            break;
+    }
+}
 
-        // Call the function
-        std::string funcName = call->function->value;
-        if (functions.find(funcName) == functions.end()) {
-            throw std::runtime_error("Undefined function: " + funcName);
-        }
+void CodeGenerator::EmitPrefixOperator(const PrefixExpression& prefix) {
+    if (prefix.operation == Operator::Neg) {
+        Emit(Opcode::Neg, Operand::Register(Reg::RAX, WidthOf(prefix.type)));
+    } else {
+        EmitTest(prefix.right->type);
+        Emit(Opcode::Set, Cond::Z, AL);
+        Emit(Opcode::Movzx, EAX, AL);
+    }
+}
 
-        output << "    call " << funcName << std::endl;
+void CodeGenerator::EmitTest(const Type type) {
+    const Operand value = Operand::Register(Reg::RAX, WidthOf(type));
+    Emit(Opcode::Test, value, value);
+}
 
-        // Clean up arguments from the stack
-        if (!call->arguments.empty()) {
-            output << "    add rsp, " << call->arguments.size() * 8 << std::endl;
-        }
-    } else if (const auto* prefix = dynamic_cast<const PrefixExpression*>(&expression)) {
-        GenerateExpression(*prefix->right);
-        if (prefix->op == "-") {
-            output << "    neg rax" << std::endl;
-        } else if (prefix->op == "!") {
-            output << "    test rax, rax" << std::endl;
-            output << "    setz al" << std::endl;
-            output << "    movzx rax, al" << std::endl;
-        }
-    } else if (const auto* deref = dynamic_cast<const DereferenceExpression*>(&expression)) {
-        // Generate address, then dereference
-        GenerateExpression(*deref->operand);
-        output << "    mov rax, [rax]" << std::endl;
-    } else if (const auto* addrOf = dynamic_cast<const AddressOfExpression*>(&expression)) {
-        // Generate address of variable
-        if (const auto* ident = dynamic_cast<const Identifier*>(addrOf->operand.get())) {
-            if (symbolTable.IsGlobal(ident->value)) {
-                output << "    lea rax, [" << ident->value << "]" << std::endl;
-            } else {
-                int offset = symbolTable.Get(ident->value);
-                if (offset >= 0) {
-                    output << "    lea rax, [rbp+" << offset << "]" << std::endl;
-                } else {
-                    output << "    lea rax, [rbp" << offset << "]" << std::endl;
-                }
-            }
-        } else {
-            throw std::runtime_error("Address-of only supported for identifiers");
-        }
+void CodeGenerator::EmitLoad(Operand source, const Type type) {
+    source.size = type.Size();
+    if (source.size == 8) {
+        Emit(Opcode::Mov, RAX, source);
+    } else if (source.size == 4 && type.IsUnsigned()) {
+        Emit(Opcode::Mov, EAX, source); // Writing eax clears the upper half
     } else {
-        throw std::runtime_error("Unknown expression type");
+        Emit(type.IsUnsigned() ? Opcode::Movzx : Opcode::Movsx, type.IsUnsigned() ? EAX : RAX, source);
+    }
+}
+
+void CodeGenerator::EmitStore(Operand target, const Expression& value, const Type type) {
+    Widen(value, type);
+    target.size = type.Size();
+    Emit(Opcode::Mov, target, Operand::Register(Reg::RAX, target.size));
+}
+
+void CodeGenerator::Widen(const Expression& value, const Type to) {
+    if (to.Size() == 8 && value.type == Type(BaseType::I32) && !IsExtended(value)) {
+        Emit(Opcode::Movsx, RAX, EAX);
     }
 }
+
+void CodeGenerator::Extend(const Expression& value, const Type to) {
+    if (Includes(to, value.type)) {
+        // Extended already, unless it is a 32-bit result
+        Widen(value, value.type == to ? I64 : to);
+        return;
+    }
+    const uint8_t size = to.Size();
+    if (size == 4 && to.IsUnsigned()) {
+        Emit(Opcode::Mov, EAX, EAX);
+    } else {
+        Emit(to.IsUnsigned() ? Opcode::Movzx : Opcode::Movsx, to.IsUnsigned() ? EAX : RAX,
+             Operand::Register(Reg::RAX, size));
+    }
+}
+
+void CodeGenerator::VisitIntegerLiteral(const IntegerLiteral& intLiteral) {
+    Emit(Opcode::Mov, RAX, Imm(intLiteral.value));
+}
+
+void CodeGenerator::VisitIdentifier(const Identifier& ident) {
+    EmitLoad(AddressOf(ident, 8), ident.type);
+}
+
+void CodeGenerator::VisitAddressOfExpression(const AddressOfExpression& addrOf) {
+    // Sema only lets identifiers have their address taken
+    Emit(Opcode::Lea, RAX, AddressOf(static_cast<const Identifier&>(*addrOf.operand), 8));
+}
@@ -0,0 +1,133 @@
+#include "CompileCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "ContentHash.h"
+#include "SourceFile.h"
+
+namespace {
+    // An entry is the dependency count, then per dependency a length-prefixed
+    // module name and its interface hash, then the length-prefixed interface,
+    // then the output to the end of the file
+    template <typename T>
+    void Append(std::string& out, const T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool Take(std::string_view& in, T& value) {
+        if (in.size() < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool TakeString(std::string_view& in, std::string_view& text) {
+        uint32_t length;
+        if (!Take(in, length) || in.size() < length) {
+            return false;
+        }
+        text = in.substr(0, length);
+        in.remove_prefix(length);
+        return true;
+    }
+}
+
+CompileCache::CompileCache(std::string directory, std::string compilerIdentity)
+    : directory(std::move(directory)), compilerIdentity(std::move(compilerIdentity)) {
+    ::mkdir(this->directory.c_str(), 0755);
+}
+
+std::string CompileCache::Key(const std::string_view source, const APXC_OPERATION operation,
+                              const APXC_OUTPUT_FORMAT format, const bool emitInterface) const {
+    // Two FNV-1a passes with different seeds give a 128-bit name, wide enough
+    // that the entry is trusted without storing the source next to it
+    const char flags[] = {static_cast<char>(operation), static_cast<char>(format), static_cast<char>(emitInterface)};
+    uint64_t lo = HashBytes(compilerIdentity);
+    uint64_t hi = HashBytes(compilerIdentity, 0x84222325cbf29ce4ull);
+    lo = HashBytes(source, HashBytes(std::string_view(flags, sizeof(flags)), lo));
+    hi = HashBytes(source, HashBytes(std::string_view(flags, sizeof(flags)), hi));
+
+    char name[33];
+    std::snprintf(name, sizeof(name), "%016llx%016llx",
+                  static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+    return name;
+}
+
+bool CompileCache::Load(const std::string& key, const ModuleLoader& modules, std::string& output,
+                        std::string& interface) const {
+    SourceFile entry;
+    if (!entry.Open(PathOf(key))) {
+        return false;
+    }
+    std::string_view in = entry.GetContents();
+    uint32_t count;
+    if (!Take(in, count)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string_view name;
+        uint64_t hash;
+        if (!TakeString(in, name) || !Take(in, hash) || modules.HashOf(name) != hash) {
+            return false;
+        }
+    }
+    std::string_view cachedInterface;
+    if (!TakeString(in, cachedInterface)) {
+        return false;
+    }
+    interface.assign(cachedInterface);
+    output.assign(in);
+    return true;
+}
+
+void CompileCache::Store(const std::string& key, const std::vector<ModuleLoader::Dependency>& dependencies,
+                         const std::string_view output, const std::string_view interface) const {
+    std::string header;
+    Append(header, static_cast<uint32_t>(dependencies.size()));
+    for (const auto& dependency : dependencies) {
+        Append(header, static_cast<uint32_t>(dependency.name.size()));
+        header += dependency.name;
+        Append(header, dependency.hash);
+    }
+    Append(header, static_cast<uint32_t>(interface.size()));
+    header += interface;
+
+    const std::string path = PathOf(key);
+    const std::string temporary = path + ".tmp." + std::to_string(::getpid()) + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    auto writeAll = [fd](const std::string_view bytes) {
+        size_t written = 0;
+        while (written < bytes.size()) {
+            const ssize_t n = ::write(fd, bytes.data() + written, bytes.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    };
+    const bool written = writeAll(header) && writeAll(output);
+    const bool complete = ::close(fd) == 0 && written;
+    if (!complete || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+    }
+}
+
+std::string CompileCache::PathOf(const std::string& key) const {
+    return directory + "/" + key + ".out";
+}
@@ -0,0 +1,331 @@
+#include "CompileServer.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include "ContentHash.h"
+#include "Logger.h"
+
+namespace {
+    // Requests larger than this are treated as a broken peer
+    constexpr uint32_t MAX_MESSAGE_SIZE = 1u << 30;
+
+    bool WriteAll(const int fd, const char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool ReadAll(const int fd, char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t n = ::read(fd, data, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void AppendU32(std::string& out, const uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void AppendString(std::string& out, const std::string_view text) {
+        AppendU32(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    // Sends payload behind its length; the header is reserved by the caller
+    // as the first four bytes so the whole message goes out in one write
+    bool SendMessage(const int fd, std::string& message) {
+        const auto size = static_cast<uint32_t>(message.size() - sizeof(uint32_t));
+        std::memcpy(message.data(), &size, sizeof(size));
+        return WriteAll(fd, message.data(), message.size());
+    }
+
+    bool ReceiveMessage(const int fd, std::string& payload) {
+        uint32_t size = 0;
+        if (!ReadAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > MAX_MESSAGE_SIZE) {
+            return false;
+        }
+        payload.resize(size);
+        return ReadAll(fd, payload.data(), size);
+    }
+
+    // Bounds-checked cursor over a received payload
+    struct Reader {
+        std::string_view data;
+        size_t pos = 0;
+        bool ok = true;
+
+        uint32_t U32() {
+            uint32_t value = 0;
+            if (pos + sizeof(value) > data.size()) {
+                ok = false;
+                return 0;
+            }
+            std::memcpy(&value, data.data() + pos, sizeof(value));
+            pos += sizeof(value);
+            return value;
+        }
+
+        std::string_view String() {
+            const uint32_t size = U32();
+            if (!ok || pos + size > data.size()) {
+                ok = false;
+                return {};
+            }
+            const std::string_view text = data.substr(pos, size);
+            pos += size;
+            return text;
+        }
+    };
+
+    size_t UnitBytes(const apx::ParsedUnit& unit) {
+        return unit.source.size() + (unit.program ? unit.program->arena.GetBytesReserved() : 0);
+    }
+
+    size_t ResultBytes(const apx::CompileResult& result) {
+        size_t bytes = result.output.size() + result.interface.size();
+        for (const auto& diagnostic : result.diagnostics) {
+            bytes += sizeof(diagnostic) + diagnostic.message.size();
+        }
+        return bytes;
+    }
+
+    std::string g_socketPath;
+
+    void RemoveSocketAndExit(int) {
+        ::unlink(g_socketPath.c_str());
+        ::_exit(0);
+    }
+}
+
+std::string DefaultServerSocketPath() {
+    if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/apxc.sock";
+    }
+    return "/tmp/apxc-" + std::to_string(::getuid()) + ".sock";
+}
+
+CompileServer::CompileServer(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+int CompileServer::Run() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        out::error("Socket path too long: {}", socketPath);
+        return 1;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        out::error("Could not create socket: {}", std::strerror(errno));
+        return 1;
+    }
+    // A previous server that was killed leaves its socket file behind, but a
+    // live one must keep its path
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        const bool running = ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        const int error = errno;
+        ::close(probe);
+        if (running) {
+            out::error("A compile server is already running on {}", socketPath);
+            ::close(listener);
+            return 1;
+        }
+        if (error != ECONNREFUSED && error != ENOENT) {
+            out::error("Could not check {} for a running server: {}", socketPath, std::strerror(error));
+            ::close(listener);
+            return 1;
+        }
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0) {
+        out::error("Could not listen on {}: {}", socketPath, std::strerror(errno));
+        ::close(listener);
+        return 1;
+    }
+
+    g_socketPath = socketPath;
+    std::signal(SIGINT, RemoveSocketAndExit);
+    std::signal(SIGTERM, RemoveSocketAndExit);
+    out::info("Compile server listening on {}", socketPath);
+
+    for (;;) {
+        const int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            out::error("accept failed: {}", std::strerror(errno));
+            ::close(listener);
+            return 1;
+        }
+        std::thread([this, client] { Serve(client); }).detach();
+    }
+}
+
+void CompileServer::Serve(const int client) {
+    std::string request;
+    while (ReceiveMessage(client, request)) {
+        if (request.size() < 2 || static_cast<uint8_t>(request[0]) >= static_cast<uint8_t>(APXC_OPERATION::APXC_UNKNOWN)
+            || static_cast<uint8_t>(request[1]) >= static_cast<uint8_t>(APXC_OUTPUT_FORMAT::APXC_FORMAT_UNKNOWN)) {
+            break;
+        }
+        const auto operation = static_cast<APXC_OPERATION>(request[0]);
+        const auto format = static_cast<APXC_OUTPUT_FORMAT>(request[1]);
+        const apx::CompileResult result = Compile(request.substr(2), operation, format);
+
+        std::string response(sizeof(uint32_t), '\0');
+        response.push_back(result.success ? 1 : 0);
+        AppendString(response, result.output);
+        AppendString(response, result.interface);
+        AppendU32(response, static_cast<uint32_t>(result.diagnostics.size()));
+        for (const auto& diagnostic : result.diagnostics) {
+            AppendU32(response, static_cast<uint32_t>(diagnostic.line));
+            AppendU32(response, static_cast<uint32_t>(diagnostic.column));
+            AppendString(response, diagnostic.message);
+        }
+        if (!SendMessage(client, response)) {
+            break;
+        }
+    }
+    ::close(client);
+}
+
+apx::CompileResult CompileServer::Compile(std::string source, const APXC_OPERATION operation,
+                                          const APXC_OUTPUT_FORMAT format) {
+    const auto entry = Lookup(std::move(source));
+
+    // The entry lock also serializes Sema's writes into the shared AST
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    auto& cached = entry->results[static_cast<int>(operation)][static_cast<int>(format)];
+    if (!cached) {
+        apx::CompileOptions options{operation, format, nullptr};
+        options.emitInterface = operation != APXC_OPERATION::APXC_PREPROCESS;
+        cached = apx::Compile(*entry->unit, options);
+        std::lock_guard<std::mutex> cacheLock(cacheMutex);
+        Charge(*entry, ResultBytes(*cached));
+    }
+    return *cached;
+}
+
+std::shared_ptr<CompileServer::CacheEntry> CompileServer::Lookup(std::string source) {
+    const uint64_t hash = HashBytes(source);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (const auto it = cache.find(hash); it != cache.end() && it->second->second->unit->source == source) {
+            recent.splice(recent.begin(), recent, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Parse outside the cache lock; if another connection raced us to the
+    // same source, the later insert simply replaces the earlier one
+    auto entry = std::make_shared<CacheEntry>();
+    entry->unit = apx::Parse(std::move(source));
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (const auto it = cache.find(hash); it != cache.end()) {
+        CacheEntry& replaced = *it->second->second;
+        cacheBytes -= replaced.bytes;
+        replaced.cached = false;
+        recent.erase(it->second);
+        cache.erase(it);
+    }
+    recent.emplace_front(hash, entry);
+    cache[hash] = recent.begin();
+    entry->cached = true;
+    Charge(*entry, UnitBytes(*entry->unit));
+    return entry;
+}
+
+void CompileServer::Charge(CacheEntry& entry, const size_t bytes) {
+    if (!entry.cached) {
+        return;
+    }
+    entry.bytes += bytes;
+    cacheBytes += bytes;
+    // The most recent entry stays even when it alone is over the limit
+    while (cacheBytes > MAX_CACHE_BYTES && recent.size() > 1) {
+        CacheEntry& evicted = *recent.back().second;
+        cacheBytes -= evicted.bytes;
+        evicted.cached = false;
+        cache.erase(recent.back().first);
+        recent.pop_back();
+    }
+}
+
+CompileClient::~CompileClient() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool CompileClient::Connect(const std::string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool CompileClient::Compile(const std::string_view source, const APXC_OPERATION operation,
+                            const APXC_OUTPUT_FORMAT format, apx::CompileResult& result) {
+    std::string request(sizeof(uint32_t), '\0');
+    request.push_back(static_cast<char>(operation));
+    request.push_back(static_cast<char>(format));
+    request.append(source);
+    std::string response;
+    if (!SendMessage(fd, request) || !ReceiveMessage(fd, response) || response.empty()) {
+        return false;
+    }
+
+    Reader reader{std::string_view(response).substr(1)};
+    result = {};
+    result.success = response[0] != 0;
+    result.output = std::string(reader.String());
+    result.interface = std::string(reader.String());
+    const uint32_t count = reader.U32();
+    for (uint32_t i = 0; reader.ok && i < count; ++i) {
+        Diagnostic diagnostic;
+        diagnostic.line = static_cast<int>(reader.U32());
+        diagnostic.column = static_cast<int>(reader.U32());
+        diagnostic.message = std::string(reader.String());
+        result.diagnostics.push_back(std::move(diagnostic));
+    }
+    return reader.ok;
+}
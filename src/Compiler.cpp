@@ -0,0 +1,463 @@
+#include "Compiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <functional>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "AstHasher.h"
+#include "AstPrinter.h"
+#include "Bytecode.h"
+#include "ElfWriter.h"
+#include "Interpreter.h"
+#include "JitModule.h"
+#include "Lexer.h"
+#include "NasmPrinter.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "Profiler.h"
+#include "Sema.h"
+#include "SourceFile.h"
+#include "X86Encoder.h"
+
+extern char** environ;
+
+namespace apx {
+
+    namespace {
+        // Assembles NASM source with `nasm -f elf64` through temporary files;
+        // the fallback for inline assembly the encoder cannot handle
+        std::string AssembleWithNasm(const std::string& source) {
+            const char* tmp = std::getenv("TMPDIR");
+            const std::string base = std::string(tmp && *tmp ? tmp : "/tmp") + "/apxc-XXXXXX";
+            std::string asmPath = base + ".s";
+            const int fd = ::mkstemps(asmPath.data(), 2);
+            if (fd < 0) {
+                throw std::runtime_error("Could not create temporary file for nasm");
+            }
+            const bool written = ::write(fd, source.data(), source.size()) == static_cast<ssize_t>(source.size());
+            ::close(fd);
+            const std::string objectPath = asmPath.substr(0, asmPath.size() - 2) + ".o";
+
+            int status = -1;
+            if (written) {
+                const char* argv[] = {"nasm", "-f", "elf64", "-o", objectPath.c_str(), asmPath.c_str(), nullptr};
+                pid_t pid;
+                if (::posix_spawnp(&pid, "nasm", nullptr, nullptr, const_cast<char* const*>(argv), environ) == 0) {
+                    ::waitpid(pid, &status, 0);
+                }
+            }
+
+            SourceFile object;
+            const bool assembled = WIFEXITED(status) && WEXITSTATUS(status) == 0 && object.Open(objectPath);
+            std::string result = assembled ? std::string(object.GetContents()) : std::string();
+            ::unlink(asmPath.c_str());
+            ::unlink(objectPath.c_str());
+            if (!assembled) {
+                throw std::runtime_error("nasm failed to assemble inline assembly the built-in encoder does not support");
+            }
+            return result;
+        }
+
+        std::string WriteObject(const MachineModule& module) {
+            PROFILE_SCOPE(profile::PHASE, "encode");
+            try {
+                return elf::WriteObject(x86::Encode(module));
+            } catch (const x86::UnsupportedInstruction&) {
+                return AssembleWithNasm(nasm::Print(module));
+            }
+        }
+
+        // Parses and checks source and hands the program to execute, which
+        // reports through the result; shared by the in-process runners
+        CompileResult Execute(const std::string_view source, ThreadPool* pool,
+                              const std::function<void(const Program&, CompileResult&)>& execute) {
+            CompileResult result;
+            const auto unit = Parse(std::string(source), pool);
+            if (!unit->diagnostics.empty()) {
+                result.diagnostics = unit->diagnostics;
+                return result;
+            }
+            for (const auto* stmt : unit->program->statements) {
+                if (const auto* importDecl = DynCast<ImportDeclaration>(stmt)) {
+                    result.diagnostics.push_back({"Programs that import modules cannot be run in process: import "
+                                                  + std::string(importDecl->module->value)});
+                    return result;
+                }
+            }
+            try {
+                Sema sema(unit->interner);
+                sema.Check(*unit->program);
+                execute(*unit->program, result);
+            } catch (const std::runtime_error& e) {
+                result.success = false;
+                result.diagnostics.push_back({e.what()});
+            }
+            return result;
+        }
+
+        // Splits the source between workers when there is a pool. The parser
+        // pulls tokens from the lexer as it goes, so the "parse" span covers
+        // lexing too.
+        std::unique_ptr<Program> ParseTimed(const std::string_view source, StringInterner& interner,
+                                            ErrorReporter& errorReporter, ThreadPool* pool,
+                                            CompileStatistics* statistics) {
+            PROFILE_SCOPE(profile::PHASE, "parse");
+            auto parse = [&](auto& parser) {
+                auto program = parser.ParseProgram();
+                if (statistics) {
+                    statistics->tokens = parser.GetTokenCount();
+                    statistics->nodes = parser.GetNodeCounts();
+                }
+                return program;
+            };
+            if (pool) {
+                ParallelParser parser(source, interner, errorReporter, *pool);
+                return parse(parser);
+            }
+            Lexer lexer(source, interner);
+            Parser parser(lexer, errorReporter);
+            return parse(parser);
+        }
+
+        // Interfaces of the modules program imports, each once, in order
+        std::vector<const ModuleInterface*> LoadImports(const Program& program, ModuleLoader* modules) {
+            PROFILE_SCOPE(profile::PHASE, "import");
+            std::vector<const ModuleInterface*> imports;
+            for (const auto* stmt : program.statements) {
+                if (const auto* importDecl = DynCast<ImportDeclaration>(stmt)) {
+                    const ModuleInterface* module = modules ? modules->Load(importDecl->module->value) : nullptr;
+                    if (!module) {
+                        throw std::runtime_error("Module not found: " + std::string(importDecl->module->value)
+                                                 + " (no " + std::string(importDecl->module->value)
+                                                 + ".apxi in the import path)");
+                    }
+                    if (std::find(imports.begin(), imports.end(), module) == imports.end()) {
+                        imports.push_back(module);
+                    }
+                }
+            }
+            return imports;
+        }
+
+        void Check(const Program& program, const StringInterner& interner,
+                   const std::vector<const ModuleInterface*>& imports, CompileStatistics* statistics) {
+            PROFILE_SCOPE(profile::PHASE, "check");
+            Sema sema(interner);
+            for (const auto* module : imports) {
+                sema.Import(*module);
+            }
+            sema.Check(program);
+            if (statistics) {
+                statistics->functions = sema.GetFunctionCount();
+                statistics->globalSymbols = sema.GetSymbolTable().GetGlobalCount();
+                statistics->peakLocalSymbols = sema.GetSymbolTable().GetPeakLocalCount();
+            }
+        }
+
+        void EmitOutput(std::string text, const CompileOptions& options, CompileResult& result) {
+            if (options.output) {
+                options.output->Append(text);
+            } else {
+                result.output = std::move(text);
+            }
+        }
+
+        size_t OutputSize(const CompileOptions& options, const CompileResult& result, const size_t outputStart) {
+            return options.output ? options.output->Size() - outputStart : result.output.size();
+        }
+
+        void Lower(const Program& program, const StringInterner& interner, const CompileOptions& options,
+                   CompileResult& result) {
+            if (CompileStatistics* statistics = options.statistics) {
+                statistics->astBytesUsed = program.arena.GetBytesUsed();
+                statistics->astBytesReserved = program.arena.GetBytesReserved();
+                statistics->internedStrings = interner.Size();
+            }
+            const size_t outputStart = options.output ? options.output->Size() : 0;
+            if (options.operation == APXC_OPERATION::APXC_PREPROCESS) {
+                std::string text;
+                AstPrinter(text).Print(program);
+                EmitOutput(std::move(text), options, result);
+                if (options.statistics) {
+                    options.statistics->outputBytes = OutputSize(options, result, outputStart);
+                }
+                result.success = true;
+                return;
+            }
+
+            try {
+                const std::vector<const ModuleInterface*> imports = LoadImports(program, options.modules);
+                Check(program, interner, imports, options.statistics);
+
+                PROFILE_SCOPE(profile::PHASE, "codegen");
+                CodeGenerator generator(options.pool);
+                for (const auto* module : imports) {
+                    generator.Import(*module);
+                }
+                if (options.format == APXC_OUTPUT_FORMAT::APXC_OBJECT) {
+                    EmitOutput(WriteObject(generator.Lower(program, options.operation)), options, result);
+                } else if (options.output) {
+                    generator.Generate(program, options.operation, *options.output);
+                } else {
+                    result.output = generator.Generate(program, options.operation);
+                }
+                if (options.statistics) {
+                    options.statistics->outputBytes = OutputSize(options, result, outputStart);
+                }
+                if (options.emitInterface) {
+                    result.interface = apxi::Write(program);
+                }
+                result.success = true;
+            } catch (const std::runtime_error& e) {
+                result.diagnostics.push_back({e.what()});
+            }
+        }
+    }
+
+    CompileResult Compile(const std::string_view source, const CompileOptions& options) {
+        CompileResult result;
+
+        StringInterner interner;
+        ErrorReporter errorReporter;
+        const auto program = ParseTimed(source, interner, errorReporter, options.pool, options.statistics);
+        if (CompileStatistics* statistics = options.statistics) {
+            statistics->sourceBytes = source.size();
+        }
+
+        if (errorReporter.HasErrors()) {
+            result.diagnostics = errorReporter.GetErrors();
+            return result;
+        }
+
+        Lower(*program, interner, options, result);
+        return result;
+    }
+
+    std::unique_ptr<ParsedUnit> Parse(std::string source, ThreadPool* pool) {
+        auto unit = std::make_unique<ParsedUnit>();
+        unit->source = std::move(source);
+
+        ErrorReporter errorReporter;
+        unit->program = ParseTimed(unit->source, unit->interner, errorReporter, pool, nullptr);
+        unit->diagnostics = errorReporter.GetErrors();
+        return unit;
+    }
+
+    CompileResult Compile(const ParsedUnit& unit, const CompileOptions& options) {
+        CompileResult result;
+        if (!unit.diagnostics.empty()) {
+            result.diagnostics = unit.diagnostics;
+            return result;
+        }
+
+        if (options.statistics) {
+            options.statistics->sourceBytes = unit.source.size();
+        }
+        Lower(*unit.program, unit.interner, options, result);
+        return result;
+    }
+
+    CompileResult Run(const std::string_view source, int& exitCode, const CompileOptions& options) {
+        return Execute(source, options.pool, [&](const Program& program, CompileResult& result) {
+            // Without the _start stub: the JIT calls main itself
+            CodeGenerator generator(options.pool);
+            const JitModule module(x86::Encode(generator.Lower(program, APXC_OPERATION::APXC_COMPILE_WO_ENTRY)));
+            void* main = module.Lookup("main");
+            if (!main) {
+                result.diagnostics.push_back({"No main function to run"});
+                return;
+            }
+            exitCode = static_cast<int>(module.Call(main));
+            result.success = true;
+        });
+    }
+
+    std::string BuildIdentity() {
+        // The shared library when apx is one, the executable when linked in
+        std::string path = "/proc/self/exe";
+        Dl_info info{};
+        if (::dladdr(reinterpret_cast<void*>(&BuildIdentity), &info) != 0 && info.dli_fname && *info.dli_fname) {
+            path = info.dli_fname;
+        }
+        struct stat st{};
+        if (::stat(path.c_str(), &st) != 0 && ::stat("/proc/self/exe", &st) != 0) {
+            return path;
+        }
+        return path + ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtim.tv_sec) + "."
+            + std::to_string(st.st_mtim.tv_nsec);
+    }
+
+    CompileResult Interpret(const std::string_view source, int& exitCode) {
+        return Execute(source, nullptr, [&](const Program& program, CompileResult& result) {
+            const BytecodeModule module = BytecodeCompiler().Compile(program);
+            const int main = module.FindFunction("main");
+            if (main < 0) {
+                result.diagnostics.push_back({"No main function to run"});
+                return;
+            }
+            Interpreter interpreter(module);
+            exitCode = static_cast<int>(interpreter.Call(static_cast<uint32_t>(main)));
+            result.success = true;
+            if (module.skippedAssemblyBlocks > 0) {
+                result.diagnostics.push_back({"Skipped " + std::to_string(module.skippedAssemblyBlocks)
+                                              + " inline assembly block(s) the interpreter cannot execute"});
+            }
+        });
+    }
+
+    IncrementalCompiler::IncrementalCompiler(const CompileOptions& options) : options(options) {
+        this->options.output = nullptr;
+        this->options.statistics = nullptr;
+    }
+
+    IncrementalCompiler::CachedFunction IncrementalCompiler::Cache(const uint64_t hash,
+                                                                   const MachineFunction& function) {
+        CachedFunction cached;
+        cached.hash = hash;
+        if (options.format == APXC_OUTPUT_FORMAT::APXC_NASM) {
+            OutputSink out(cached.text);
+            nasm::PrintFunction(out, function);
+            out.Flush();
+            return cached;
+        }
+        auto own = [this](std::string_view& name) {
+            if (!name.empty()) {
+                name = names.GetString(names.Intern(name));
+            }
+        };
+        cached.code = function;
+        own(cached.code.name);
+        for (auto& instruction : cached.code.code) {
+            own(instruction.dst.name);
+            own(instruction.src.name);
+        }
+        return cached;
+    }
+
+    CompileResult IncrementalCompiler::Compile(const std::string_view source, ModuleLoader* modules) {
+        CompileResult result;
+        generatedCount = 0;
+        reusedCount = 0;
+        StringInterner interner;
+        ErrorReporter errorReporter;
+        const auto program = ParseTimed(source, interner, errorReporter, options.pool, nullptr);
+        if (errorReporter.HasErrors()) {
+            result.diagnostics = errorReporter.GetErrors();
+            return result;
+        }
+        if (options.operation == APXC_OPERATION::APXC_PREPROCESS) {
+            Lower(*program, interner, options, result);
+            return result;
+        }
+
+        try {
+            const std::vector<const ModuleInterface*> imports
+                = LoadImports(*program, modules ? modules : options.modules);
+            Check(*program, interner, imports, nullptr);
+
+            // Whether an identifier is a global or a local depends on every
+            // global name, and the code for reading one or calling a function
+            // on its type, so changing any global or function signature
+            // invalidates all functions
+            uint64_t context = HashBytes({});
+            const auto mix = [&context](const std::string_view name, const Type type) {
+                context = HashBytes(name, context);
+                context = HashBytes(TypeName(type), context);
+                context = HashBytes(std::string_view("", 1), context);
+            };
+            for (const auto* stmt : program->statements) {
+                if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+                    mix(varDecl->name->value, varDecl->name->type);
+                } else if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+                    mix(funcDecl->name->value, funcDecl->returnType->type);
+                    for (const auto* type : funcDecl->parameterTypes) {
+                        mix({}, type->type);
+                    }
+                }
+            }
+            for (const auto* module : imports) {
+                for (const auto& variable : module->variables) {
+                    mix(variable.name, variable.type);
+                }
+                for (const auto& function : module->functions) {
+                    mix(function.name, function.returnType);
+                    for (const Type type : function.parameterTypes) {
+                        mix({}, type);
+                    }
+                }
+            }
+
+            std::vector<const FunctionDeclaration*> declarations;
+            std::vector<uint64_t> hashes;
+            std::vector<bool> stale;
+            {
+                PROFILE_SCOPE(profile::PHASE, "hash");
+                AstHasher hasher;
+                for (const auto* stmt : program->statements) {
+                    if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+                        const uint64_t hash = hasher.Hash(*funcDecl) ^ context;
+                        const auto it = functions.find(funcDecl->name->value);
+                        declarations.push_back(funcDecl);
+                        hashes.push_back(hash);
+                        stale.push_back(it == functions.end() || it->second.hash != hash);
+                    }
+                }
+            }
+
+            PROFILE_SCOPE(profile::PHASE, "codegen");
+            CodeGenerator generator(options.pool);
+            for (const auto* module : imports) {
+                generator.Import(*module);
+            }
+            MachineModule module = generator.Lower(*program, options.operation, stale);
+
+            // Functions that are gone, or were renamed, are dropped
+            std::unordered_map<std::string_view, CachedFunction> next;
+            next.reserve(declarations.size());
+            for (size_t i = 0; i < declarations.size(); ++i) {
+                const std::string_view name = declarations[i]->name->value;
+                if (stale[i]) {
+                    ++generatedCount;
+                    next.insert_or_assign(names.GetString(names.Intern(name)), Cache(hashes[i], module.functions[i]));
+                } else {
+                    auto it = functions.find(name);
+                    next.insert_or_assign(it->first, std::move(it->second));
+                }
+            }
+            reusedCount = declarations.size() - generatedCount;
+
+            if (options.format == APXC_OUTPUT_FORMAT::APXC_NASM) {
+                OutputSink out(result.output);
+                nasm::PrintHeader(out, module);
+                for (const auto* funcDecl : declarations) {
+                    out += next.at(funcDecl->name->value).text;
+                }
+                for (size_t i = declarations.size(); i < module.functions.size(); ++i) {
+                    nasm::PrintFunction(out, module.functions[i]); // _start
+                }
+                out.Flush();
+            } else {
+                for (size_t i = 0; i < declarations.size(); ++i) {
+                    if (!stale[i]) {
+                        module.functions[i].code = next.at(declarations[i]->name->value).code.code;
+                    }
+                }
+                result.output = WriteObject(module);
+            }
+            functions = std::move(next);
+            if (options.emitInterface) {
+                result.interface = apxi::Write(*program);
+            }
+            result.success = true;
+        } catch (const std::runtime_error& e) {
+            result.diagnostics.push_back({e.what()});
+        }
+        return result;
+    }
+
+} // namespace apx
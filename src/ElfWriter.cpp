@@ -0,0 +1,137 @@
+#include "ElfWriter.h"
+#include <elf.h>
+#include <cstring>
+
+namespace elf {
+
+    namespace {
+        enum SectionIndex : uint16_t { NullSection, TextSection, DataSection, RelaTextSection, SymtabSection,
+                                       StrtabSection, ShstrtabSection, SectionCount };
+
+        template<typename T>
+        void Append(std::string& out, const T& value) {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        uint64_t Align(std::string& out, const uint64_t alignment) {
+            while (out.size() % alignment != 0) {
+                out.push_back('\0');
+            }
+            return out.size();
+        }
+
+        // Appends a NUL-terminated name and returns its offset in the table
+        uint32_t AddString(std::string& table, const std::string_view name) {
+            const auto offset = static_cast<uint32_t>(table.size());
+            table.append(name);
+            table.push_back('\0');
+            return offset;
+        }
+    }
+
+    std::string WriteObject(const x86::EncodedModule& module) {
+        // Symbol table: the null symbol, then locals, then globals as the
+        // ELF spec requires; index maps encoder symbols to their slot
+        std::string strtab(1, '\0');
+        std::vector<Elf64_Sym> symbols(1);
+        std::vector<uint32_t> index(module.symbols.size());
+        uint32_t firstGlobal = 0;
+        for (const bool global : {false, true}) {
+            if (global) {
+                firstGlobal = static_cast<uint32_t>(symbols.size());
+            }
+            for (size_t i = 0; i < module.symbols.size(); ++i) {
+                const x86::Symbol& symbol = module.symbols[i];
+                if (symbol.isGlobal != global) {
+                    continue;
+                }
+                Elf64_Sym entry{};
+                entry.st_name = AddString(strtab, symbol.name);
+                entry.st_value = symbol.offset;
+                entry.st_size = symbol.size;
+                unsigned char type = STT_NOTYPE;
+                switch (symbol.section) {
+                    case x86::Section::Text: entry.st_shndx = TextSection; type = STT_FUNC; break;
+                    case x86::Section::Data: entry.st_shndx = DataSection; type = STT_OBJECT; break;
+                    case x86::Section::Undefined: entry.st_shndx = SHN_UNDEF; break;
+                }
+                entry.st_info = ELF64_ST_INFO(global ? STB_GLOBAL : STB_LOCAL, type);
+                index[i] = static_cast<uint32_t>(symbols.size());
+                symbols.push_back(entry);
+            }
+        }
+
+        std::vector<Elf64_Rela> relocations;
+        relocations.reserve(module.relocations.size());
+        for (const auto& relocation : module.relocations) {
+            const uint32_t type = relocation.type == x86::RelocationType::PLT32 ? R_X86_64_PLT32 : R_X86_64_PC32;
+            relocations.push_back({relocation.offset, ELF64_R_INFO(index[relocation.symbol], type), relocation.addend});
+        }
+
+        std::string shstrtab(1, '\0');
+        Elf64_Shdr sections[SectionCount]{};
+        std::string out(sizeof(Elf64_Ehdr), '\0');
+
+        const auto addSection = [&](const SectionIndex i, const char* name, const uint32_t type, const uint64_t flags,
+                                    const std::string_view contents, const uint64_t alignment) {
+            Elf64_Shdr& header = sections[i];
+            header.sh_name = AddString(shstrtab, name);
+            header.sh_type = type;
+            header.sh_flags = flags;
+            header.sh_offset = Align(out, alignment);
+            header.sh_size = contents.size();
+            header.sh_addralign = alignment;
+            out.append(contents);
+            return &header;
+        };
+        const auto bytesOf = [](const auto& vector) {
+            return std::string_view(reinterpret_cast<const char*>(vector.data()), vector.size() * sizeof(vector[0]));
+        };
+
+        addSection(TextSection, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, module.text, 16);
+        addSection(DataSection, ".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, module.data, module.dataAlignment);
+
+        Elf64_Shdr* rela = addSection(RelaTextSection, ".rela.text", SHT_RELA, SHF_INFO_LINK, bytesOf(relocations), 8);
+        rela->sh_link = SymtabSection;
+        rela->sh_info = TextSection;
+        rela->sh_entsize = sizeof(Elf64_Rela);
+
+        Elf64_Shdr* symtab = addSection(SymtabSection, ".symtab", SHT_SYMTAB, 0, bytesOf(symbols), 8);
+        symtab->sh_link = StrtabSection;
+        symtab->sh_info = firstGlobal;
+        symtab->sh_entsize = sizeof(Elf64_Sym);
+
+        addSection(StrtabSection, ".strtab", SHT_STRTAB, 0, strtab, 1);
+        // The section name table holds its own name, so it is written by hand
+        Elf64_Shdr& shstrtabHeader = sections[ShstrtabSection];
+        shstrtabHeader.sh_name = AddString(shstrtab, ".shstrtab");
+        shstrtabHeader.sh_type = SHT_STRTAB;
+        shstrtabHeader.sh_offset = out.size();
+        shstrtabHeader.sh_size = shstrtab.size();
+        shstrtabHeader.sh_addralign = 1;
+        out.append(shstrtab);
+
+        const uint64_t sectionHeaders = Align(out, 8);
+        for (const auto& header : sections) {
+            Append(out, header);
+        }
+
+        Elf64_Ehdr header{};
+        std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+        header.e_ident[EI_CLASS] = ELFCLASS64;
+        header.e_ident[EI_DATA] = ELFDATA2LSB;
+        header.e_ident[EI_VERSION] = EV_CURRENT;
+        header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+        header.e_type = ET_REL;
+        header.e_machine = EM_X86_64;
+        header.e_version = EV_CURRENT;
+        header.e_shoff = sectionHeaders;
+        header.e_ehsize = sizeof(Elf64_Ehdr);
+        header.e_shentsize = sizeof(Elf64_Shdr);
+        header.e_shnum = SectionCount;
+        header.e_shstrndx = ShstrtabSection;
+        std::memcpy(out.data(), &header, sizeof(header));
+        return out;
+    }
+
+} // namespace elf
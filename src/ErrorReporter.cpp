@@ -10,8 +10,23 @@ bool ErrorReporter::HasErrors() const {
     return !errors.empty();
 }
 
-void ErrorReporter::PrintErrors() const {
-    for (const auto&[message, line, column] : errors) {
+void ErrorReporter::PrintErrors(const std::string_view source) const {
+    for (const auto& error : errors) {
+        Print(error, source);
+    }
+}
+
+void ErrorReporter::Print(const Diagnostic& diagnostic, const std::string_view source) {
+    const auto&[message, line, column] = diagnostic;
+    if (line < 0) {
+        if (source.empty()) {
+            out::error("{}", message);
+        } else {
+            out::error("{}: {}", source, message);
+        }
+    } else if (source.empty()) {
         out::error("Exception at line {}, column {}: {}", line, column, message);
+    } else {
+        out::error("{}: Exception at line {}, column {}: {}", source, line, column, message);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+#include "FileWatcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    // A save is usually a handful of events within a few milliseconds
+    constexpr int SETTLE_MILLISECONDS = 30;
+}
+
+FileWatcher::FileWatcher() : fd(::inotify_init1(IN_CLOEXEC)) {}
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool FileWatcher::Add(const std::string& path) {
+    if (fd < 0) {
+        return false;
+    }
+    const size_t slash = path.rfind('/');
+    const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    // Adding a directory twice returns the same descriptor
+    const int watch = ::inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0) {
+        return false;
+    }
+    files.push_back({watch, slash == std::string::npos ? path : path.substr(slash + 1)});
+    return true;
+}
+
+std::vector<size_t> FileWatcher::Wait() {
+    std::vector<size_t> changed;
+    alignas(inotify_event) char buffer[4096];
+    int timeout = -1;
+    for (;;) {
+        pollfd poller{fd, POLLIN, 0};
+        const int ready = ::poll(&poller, 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return {};
+        }
+        if (ready == 0) {
+            break; // Settled
+        }
+        const ssize_t length = ::read(fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return {};
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->len == 0) {
+                continue;
+            }
+            const std::string_view name(event->name);
+            for (size_t i = 0; i < files.size(); ++i) {
+                if (files[i].directory == event->wd && files[i].name == name
+                    && std::find(changed.begin(), changed.end(), i) == changed.end()) {
+                    changed.push_back(i);
+                }
+            }
+        }
+        if (!changed.empty()) {
+            timeout = SETTLE_MILLISECONDS;
+        }
+    }
+    std::sort(changed.begin(), changed.end());
+    return changed;
+}
@@ -0,0 +1,258 @@
+#include "Interpreter.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__GNUC__) && !defined(APX_VM_NO_COMPUTED_GOTO)
+#define APX_VM_COMPUTED_GOTO 1
+#else
+#define APX_VM_COMPUTED_GOTO 0
+#endif
+
+namespace {
+    // Wrapping arithmetic, as the machine does it
+    int64_t Wrap(const uint64_t value) {
+        return static_cast<int64_t>(value);
+    }
+
+    [[noreturn]] void Fail(const char* message) {
+        throw std::runtime_error(message);
+    }
+
+    template<typename T>
+    int64_t Read(const int64_t address) {
+        T value;
+        std::memcpy(&value, reinterpret_cast<const void*>(static_cast<intptr_t>(address)), sizeof(value));
+        return static_cast<int64_t>(value);
+    }
+
+    int64_t Read(const int64_t address, const BaseType type) {
+        switch (type) {
+            case BaseType::I8: return Read<int8_t>(address);
+            case BaseType::I16: return Read<int16_t>(address);
+            case BaseType::I32: return Read<int32_t>(address);
+            case BaseType::U8: return Read<uint8_t>(address);
+            case BaseType::U16: return Read<uint16_t>(address);
+            case BaseType::U32: return Read<uint32_t>(address);
+            default: return Read<int64_t>(address);
+        }
+    }
+}
+
+Interpreter::Interpreter(const BytecodeModule& module, const size_t stackRegisters)
+    : module(module), globals(module.globals), stack(stackRegisters) {
+    frames.reserve(256);
+}
+
+int64_t Interpreter::Call(const uint32_t function, const std::initializer_list<int64_t> arguments) {
+    const BytecodeFunction& callee = module.functions.at(function);
+    if (std::max<size_t>(callee.frameSize, arguments.size()) > stack.size()) {
+        Fail("Stack overflow");
+    }
+    std::copy(arguments.begin(), arguments.end(), stack.begin());
+    return Execute(callee);
+}
+
+int64_t Interpreter::Execute(const BytecodeFunction& function) {
+    const BytecodeInstruction* const code = module.code.data();
+    const BytecodeFunction* const functions = module.functions.data();
+    const int64_t* const stackEnd = stack.data() + stack.size();
+    int64_t* const g = globals.data();
+    const BytecodeInstruction* pc = code + function.entry;
+    int64_t* r = stack.data();
+    frames.clear();
+
+#if APX_VM_COMPUTED_GOTO
+    static const void* const dispatch[] = {
+#define APX_VM_LABEL(Name) &&op_##Name,
+        APX_BYTECODE_OPS(APX_VM_LABEL)
+#undef APX_VM_LABEL
+    };
+#define VM_CASE(Name) op_##Name
+#define VM_NEXT() goto *dispatch[static_cast<size_t>(pc->op)]
+    VM_NEXT();
+#else
+#define VM_CASE(Name) case BytecodeOp::Name
+#define VM_NEXT() continue
+    for (;;) switch (pc->op) {
+#endif
+
+    VM_CASE(LoadImm):
+        r[pc->a] = Wrap(static_cast<uint64_t>(pc->b) | static_cast<uint64_t>(pc->c) << 32);
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Move):
+        r[pc->a] = r[pc->b];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(LoadGlobal):
+        r[pc->a] = g[pc->b];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(StoreGlobal):
+        g[pc->a] = r[pc->b];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(AddrLocal):
+        r[pc->a] = static_cast<int64_t>(reinterpret_cast<intptr_t>(r + pc->b));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(AddrGlobal):
+        r[pc->a] = static_cast<int64_t>(reinterpret_cast<intptr_t>(g + pc->b));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Load):
+        r[pc->a] = Read(r[pc->b], static_cast<BaseType>(pc->c));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Store):
+        std::memcpy(reinterpret_cast<void*>(static_cast<intptr_t>(r[pc->a])), &r[pc->b], sizeof(int64_t));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Add):
+        r[pc->a] = Wrap(static_cast<uint64_t>(r[pc->b]) + static_cast<uint64_t>(r[pc->c]));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Sub):
+        r[pc->a] = Wrap(static_cast<uint64_t>(r[pc->b]) - static_cast<uint64_t>(r[pc->c]));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Mul):
+        r[pc->a] = Wrap(static_cast<uint64_t>(r[pc->b]) * static_cast<uint64_t>(r[pc->c]));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Div): {
+        const int64_t divisor = r[pc->c];
+        // Both trap in idiv as well
+        if (divisor == 0 || (divisor == -1 && r[pc->b] == INT64_MIN)) {
+            Fail("Division by zero or overflow");
+        }
+        r[pc->a] = r[pc->b] / divisor;
+        ++pc;
+        VM_NEXT();
+    }
+    VM_CASE(Div32): {
+        const int64_t divisor = r[pc->c];
+        if (divisor == 0 || (divisor == -1 && r[pc->b] == INT32_MIN)) {
+            Fail("Division by zero or overflow");
+        }
+        r[pc->a] = r[pc->b] / divisor;
+        ++pc;
+        VM_NEXT();
+    }
+    VM_CASE(DivU): {
+        const auto divisor = static_cast<uint64_t>(r[pc->c]);
+        if (divisor == 0) {
+            Fail("Division by zero or overflow");
+        }
+        r[pc->a] = Wrap(static_cast<uint64_t>(r[pc->b]) / divisor);
+        ++pc;
+        VM_NEXT();
+    }
+    VM_CASE(Eq):
+        r[pc->a] = r[pc->b] == r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Ne):
+        r[pc->a] = r[pc->b] != r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Lt):
+        r[pc->a] = r[pc->b] < r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Gt):
+        r[pc->a] = r[pc->b] > r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Le):
+        r[pc->a] = r[pc->b] <= r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Ge):
+        r[pc->a] = r[pc->b] >= r[pc->c];
+        ++pc;
+        VM_NEXT();
+    VM_CASE(LtU):
+        r[pc->a] = static_cast<uint64_t>(r[pc->b]) < static_cast<uint64_t>(r[pc->c]);
+        ++pc;
+        VM_NEXT();
+    VM_CASE(GtU):
+        r[pc->a] = static_cast<uint64_t>(r[pc->b]) > static_cast<uint64_t>(r[pc->c]);
+        ++pc;
+        VM_NEXT();
+    VM_CASE(LeU):
+        r[pc->a] = static_cast<uint64_t>(r[pc->b]) <= static_cast<uint64_t>(r[pc->c]);
+        ++pc;
+        VM_NEXT();
+    VM_CASE(GeU):
+        r[pc->a] = static_cast<uint64_t>(r[pc->b]) >= static_cast<uint64_t>(r[pc->c]);
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Neg):
+        r[pc->a] = Wrap(0 - static_cast<uint64_t>(r[pc->b]));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Not):
+        r[pc->a] = r[pc->b] == 0;
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Extend):
+        r[pc->a] = Truncate(r[pc->b], static_cast<BaseType>(pc->c));
+        ++pc;
+        VM_NEXT();
+    VM_CASE(Jump):
+        pc = code + pc->a;
+        VM_NEXT();
+    VM_CASE(JumpIfZero):
+        pc = r[pc->a] == 0 ? code + pc->b : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfEq):
+        pc = r[pc->a] == r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfNe):
+        pc = r[pc->a] != r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfLt):
+        pc = r[pc->a] < r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfGt):
+        pc = r[pc->a] > r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfLe):
+        pc = r[pc->a] <= r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(JumpIfGe):
+        pc = r[pc->a] >= r[pc->b] ? code + pc->c : pc + 1;
+        VM_NEXT();
+    VM_CASE(Call): {
+        const BytecodeFunction& callee = functions[pc->b];
+        int64_t* const window = r + pc->a;
+        if (window + callee.frameSize > stackEnd) {
+            Fail("Stack overflow");
+        }
+        frames.push_back({pc + 1, r});
+        r = window;
+        pc = code + callee.entry;
+        VM_NEXT();
+    }
+    VM_CASE(Return): {
+        const int64_t value = r[pc->a];
+        if (frames.empty()) {
+            return value;
+        }
+        // The callee's window starts at the register the caller expects
+        // the result in
+        r[0] = value;
+        r = frames.back().registers;
+        pc = frames.back().returnAddress;
+        frames.pop_back();
+        VM_NEXT();
+    }
+
+#if !APX_VM_COMPUTED_GOTO
+    }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+}
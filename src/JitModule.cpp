@@ -0,0 +1,91 @@
+#include "JitModule.h"
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    // push rbx, rbp, r12-r15; keep the stack 16-byte aligned; call rdi;
+    // restore in reverse order and return the callee's rax
+    constexpr unsigned char TRAMPOLINE[] = {
+        0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57,
+        0x48, 0x83, 0xEC, 0x08,
+        0xFF, 0xD7,
+        0x48, 0x83, 0xC4, 0x08,
+        0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B,
+        0xC3,
+    };
+
+    size_t RoundUp(const size_t value, const size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+JitModule::JitModule(const x86::EncodedModule& module) {
+    // Code (with the trampoline appended) and data get separate pages so they
+    // can be protected differently; one mapping keeps them within rel32 reach
+    const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t trampolineOffset = RoundUp(module.text.size(), 16);
+    const size_t textSize = RoundUp(trampolineOffset + sizeof(TRAMPOLINE), pageSize);
+    size = textSize + RoundUp(module.data.size(), pageSize);
+
+    memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        throw std::runtime_error("Could not map memory for JIT code");
+    }
+    char* text = static_cast<char*>(memory);
+    char* data = text + textSize;
+    std::memcpy(text, module.text.data(), module.text.size());
+    std::memcpy(text + trampolineOffset, TRAMPOLINE, sizeof(TRAMPOLINE));
+    std::memcpy(data, module.data.data(), module.data.size());
+    trampoline = text + trampolineOffset;
+
+    std::vector<char*> addresses(module.symbols.size(), nullptr);
+    for (size_t i = 0; i < module.symbols.size(); ++i) {
+        const x86::Symbol& symbol = module.symbols[i];
+        switch (symbol.section) {
+            case x86::Section::Text: addresses[i] = text + symbol.offset; break;
+            case x86::Section::Data: addresses[i] = data + symbol.offset; break;
+            case x86::Section::Undefined: continue;
+        }
+        symbols.emplace(symbol.name, addresses[i]);
+    }
+
+    // Both relocation types are S + A - P; there is no PLT, every target is
+    // in the mapping
+    for (const auto& relocation : module.relocations) {
+        const char* target = addresses[relocation.symbol];
+        if (!target) {
+            ::munmap(memory, size);
+            memory = nullptr;
+            throw std::runtime_error("Undefined symbol: " + std::string(module.symbols[relocation.symbol].name));
+        }
+        char* place = text + relocation.offset;
+        const auto value = static_cast<int32_t>(target + relocation.addend - place);
+        std::memcpy(place, &value, sizeof(value));
+    }
+
+    if (::mprotect(text, textSize, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(memory, size);
+        memory = nullptr;
+        throw std::runtime_error("Could not make JIT code executable");
+    }
+}
+
+JitModule::~JitModule() {
+    if (memory) {
+        ::munmap(memory, size);
+    }
+}
+
+void* JitModule::Lookup(const std::string_view name) const {
+    const auto it = symbols.find(std::string(name));
+    return it == symbols.end() ? nullptr : it->second;
+}
+
+int64_t JitModule::Call(void* function) const {
+    const auto stub = reinterpret_cast<int64_t (*)(void*)>(const_cast<char*>(trampoline));
+    return stub(function);
+}
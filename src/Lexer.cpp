@@ -1,5 +1,62 @@
 #include "Lexer.h"
-#include <unordered_map>
+#include "CharScan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    struct Keyword {
+        std::string_view spelling;
+        TokenType type;
+    };
+
+    constexpr Keyword KEYWORDS[] = {
+        {"fn", TokenType::Function},
+        {"if", TokenType::If},
+        {"else", TokenType::Else},
+        {"while", TokenType::While},
+        {"return", TokenType::Return},
+        {"struct", TokenType::Struct},
+        {"impl", TokenType::Impl},
+        {"asm", TokenType::Asm},
+        {"const", TokenType::Const},
+        {"protocol", TokenType::Protocol},
+        {"unsafe", TokenType::Unsafe},
+        {"mut", TokenType::Mut},
+        {"import", TokenType::Import},
+    };
+
+    // Perfect hash over the keyword set: first and last character pick a slot,
+    // and a single compare against that slot decides. Checked at compile time.
+    constexpr size_t KEYWORD_SLOTS = 32;
+
+    constexpr size_t KeywordHash(const std::string_view ident) {
+        return (static_cast<unsigned char>(ident.front()) + static_cast<unsigned char>(ident.back()) * 6u) & (KEYWORD_SLOTS - 1);
+    }
+
+    struct KeywordTable {
+        Keyword slots[KEYWORD_SLOTS];
+        bool perfect;
+    };
+
+    constexpr KeywordTable BuildKeywordTable() {
+        KeywordTable table{};
+        for (auto& slot : table.slots) {
+            slot = {{}, TokenType::Identifier};
+        }
+        table.perfect = true;
+        for (const auto& keyword : KEYWORDS) {
+            auto& slot = table.slots[KeywordHash(keyword.spelling)];
+            if (!slot.spelling.empty()) {
+                table.perfect = false;
+            }
+            slot = keyword;
+        }
+        return table;
+    }
+
+    constexpr KeywordTable KEYWORD_TABLE = BuildKeywordTable();
+    static_assert(KEYWORD_TABLE.perfect, "KeywordHash collides; pick new constants");
+}
 
 std::string TokenTypeToString(const TokenType type) {
     switch (type) {
@@ -53,72 +110,78 @@ std::string TokenTypeToString(const TokenType type) {
         case TokenType::Mut: return "Mut";
         case TokenType::Ref: return "Ref";
         case TokenType::Deref: return "Deref";
+        case TokenType::Import: return "Import";
         default: return "Unknown";
     }
 }
 
-Lexer::Lexer(std::string input)
-    : input(std::move(input)), position(0), readPosition(0), ch(0), line(1), column(1) {
+Lexer::Lexer(const std::string_view input, StringInterner& interner, const size_t start)
+    : input(input), interner(interner), position(start), readPosition(start), ch(0) {
     NextChar();
 }
 
 void Lexer::NextChar() {
-    if (readPosition >= input.length()) {
-        ch = 0;
-    } else {
-        ch = input[readPosition];
-    }
-    
-    if (ch == '\n') {
-        line++;
-        column = 1;
-    } else {
-        column++;
-    }
-    
-    position = readPosition;
-    readPosition++;
+    Seek(readPosition);
 }
 
+void Lexer::Seek(const size_t newPosition) {
+    position = newPosition;
+    readPosition = newPosition + 1;
+    ch = newPosition < input.size() ? input[newPosition] : 0;
+}
 
+SourceLocation Lexer::Locate(const size_t offset) const {
+    if (lineStarts.empty()) {
+        lineStarts.push_back(0);
+        const char* data = input.data();
+        const char* end = data + input.size();
+        for (const char* p = data; p != end;) {
+            const auto* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!newline) {
+                break;
+            }
+            lineStarts.push_back(static_cast<size_t>(newline - data) + 1);
+            p = newline + 1;
+        }
+    }
+    // The last line starting at or before offset
+    const auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    const size_t line = static_cast<size_t>(next - lineStarts.begin());
+    return {static_cast<int>(line), static_cast<int>(offset - lineStarts[line - 1] + 1)};
+}
 
-TokenType Lexer::LookupIdent(const std::string& ident) {
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"fn", TokenType::Function},
-        {"if", TokenType::If},
-        {"else", TokenType::Else},
-        {"while", TokenType::While},
-        {"return", TokenType::Return},
-        {"struct", TokenType::Struct},
-        {"impl", TokenType::Impl},
-        {"asm", TokenType::Asm},
-        {"const", TokenType::Const},
-        {"protocol", TokenType::Protocol},
-        {"unsafe", TokenType::Unsafe},
-        {"mut", TokenType::Mut},
-    };
-
-    if (const auto it = keywords.find(ident); it != keywords.end()) {
-        return it->second;
+void Lexer::SkipTrivia() {
+    for (;;) {
+        if (scan::Is(ch, scan::SPACE)) {
+            Seek(scan::SkipWhitespace(input, position));
+        }
+        if (ch == '/' && PeekChar() == '/') {
+            Seek(scan::FindNewline(input, position));
+            continue;
+        }
+        return;
     }
-    return TokenType::Identifier;
+}
+
+TokenType Lexer::LookupIdent(const std::string_view ident) {
+    const Keyword& slot = KEYWORD_TABLE.slots[KeywordHash(ident)];
+    return slot.spelling == ident ? slot.type : TokenType::Identifier;
 }
 
 Token Lexer::NextToken() {
     Token tok;
 
-    while (isspace(ch)) {
-        NextChar();
-    }
+    SkipTrivia();
+    const size_t start = position;
 
     switch (ch) {
     case '"': {
-        std::string str;
         NextChar(); // Consume initial '"'
+        const size_t contentStart = position;
         while (ch != '"' && ch != 0) {
-            str += ch;
             NextChar();
         }
+        const std::string_view str = input.substr(contentStart, position - contentStart);
         if (ch == '"') {
             tok = {TokenType::String, str};
         } else {
@@ -127,7 +190,7 @@ Token Lexer::NextToken() {
         break;
     }
     case '=':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::Equal, "=="};
         } else {
@@ -135,7 +198,7 @@ Token Lexer::NextToken() {
         }
         break;
     case ':':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::ColonAssign, ":="};
         } else {
@@ -143,7 +206,7 @@ Token Lexer::NextToken() {
         }
         break;
     case '+':
-         if (input[readPosition] == '=') {
+         if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::PlusAssign, "+="};
         } else {
@@ -151,10 +214,10 @@ Token Lexer::NextToken() {
         }
         break;
     case '-':
-        if (input[readPosition] == '>') {
+        if (PeekChar() == '>') {
             NextChar();
             tok = {TokenType::Arrow, "->"};
-        } else if (input[readPosition] == '=') {
+        } else if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::MinusAssign, "-="};
         } else {
@@ -162,21 +225,15 @@ Token Lexer::NextToken() {
         }
         break;
     case '*':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::AsteriskAssign, "*="};
         } else {
             tok = {TokenType::Asterisk, "*"};
         }
         break;
-    case '/':
-        if (input[readPosition] == '/') {
-            while (ch != '\n' && ch != 0) {
-                NextChar();
-            }
-            return NextToken(); // Continue to the next token
-        }
-        if (input[readPosition] == '=') {
+    case '/': // Comments were consumed by SkipTrivia
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::SlashAssign, "/="};
         } else {
@@ -184,7 +241,7 @@ Token Lexer::NextToken() {
         }
         break;
     case '<':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::LessThanEqual, "<="};
         } else {
@@ -192,7 +249,7 @@ Token Lexer::NextToken() {
         }
         break;
     case '>':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::GreaterThanEqual, ">="};
         } else {
@@ -200,7 +257,7 @@ Token Lexer::NextToken() {
         }
         break;
     case '!':
-        if (input[readPosition] == '=') {
+        if (PeekChar() == '=') {
             NextChar();
             tok = {TokenType::NotEqual, "!="};
         } else {
@@ -208,7 +265,7 @@ Token Lexer::NextToken() {
         }
         break;
     case '.':
-        if (input[readPosition] == '.') {
+        if (PeekChar() == '.') {
             NextChar();
             tok = {TokenType::Range, ".."};
         } else {
@@ -227,49 +284,47 @@ Token Lexer::NextToken() {
     case ';': tok = {TokenType::Semicolon, ";"}; break;
     case 0: tok = {TokenType::Eof, ""}; break;
     default:
-        if (isalpha(ch) || ch == '_') {
-            std::string ident;
-            while (isalnum(ch) || ch == '_') {
-                ident += ch;
-                NextChar();
-            }
+        if (scan::Is(ch, scan::IDENT_START)) {
+            Seek(scan::SkipIdentifier(input, position));
+            const std::string_view ident = input.substr(start, position - start);
             tok.type = LookupIdent(ident);
             tok.literal = ident;
+            if (tok.type == TokenType::Identifier) {
+                tok.symbol = interner.Intern(ident);
+            }
+            tok.offset = start;
             return tok; // Early return to avoid NextChar() at the end
         }
-        if (isdigit(ch) || (ch == '0' && (input[readPosition] == 'x' || input[readPosition] == 'X'))) {
-            std::string num;
+        if (scan::Is(ch, scan::DIGIT)) {
             bool is_float = false;
             
             // Check for hex prefix
-            if (ch == '0' && (input[readPosition] == 'x' || input[readPosition] == 'X')) {
-                num += ch; // '0'
-                NextChar();
-                num += ch; // 'x' or 'X'
-                NextChar();
+            if (ch == '0' && (PeekChar() == 'x' || PeekChar() == 'X')) {
+                NextChar(); // '0'
+                NextChar(); // 'x' or 'X'
                 
                 // Parse hex digits
-                while (isdigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F')) {
-                    num += ch;
+                while (scan::Is(ch, scan::HEX_DIGIT)) {
                     NextChar();
                 }
             } else {
                 // Parse decimal number
-                while (isdigit(ch) || (ch == '.' && input[readPosition] != '.')) {
+                while (scan::Is(ch, scan::DIGIT) || (ch == '.' && PeekChar() != '.')) {
                     if (ch == '.') is_float = true;
-                    num += ch;
                     NextChar();
                 }
             }
             
             tok.type = is_float ? TokenType::Float : TokenType::Integer;
-            tok.literal = num;
+            tok.literal = input.substr(start, position - start);
+            tok.offset = start;
             return tok; // Early return
         }
-        tok = {TokenType::Illegal, std::string(1, ch)};
+        tok = {TokenType::Illegal, input.substr(position, 1)};
         break;
     }
 
+    tok.offset = start;
     NextChar();
     return tok;
 }
\ No newline at end of file
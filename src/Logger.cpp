@@ -0,0 +1,277 @@
+#include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef LOG_ASYNC
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <vector>
+#endif
+
+// Shared by every caller of the out:: functions, including programs that
+// embed libapx, so it lives in the library rather than in apxc's main.
+#ifdef LOG_THREAD_SAFE
+std::mutex g_output_mutex;
+#endif
+
+namespace {
+    void WriteNow(FILE* stream, const std::string_view record) {
+        LOG_LOCK();
+        std::fwrite(record.data(), 1, record.size(), stream);
+    }
+
+#ifdef LOG_ASYNC
+    // Bytes queued by one thread, read by the writer thread. Records are a
+    // RecordHeader followed by the text and may wrap around the end. Only the
+    // producer moves head and only the writer moves tail.
+    struct Ring {
+        static constexpr size_t CAPACITY = 64 * 1024; // Power of two
+
+        char data[CAPACITY];
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        std::atomic<bool> closed{false}; // Its thread has exited
+
+        void CopyIn(size_t position, const void* bytes, const size_t size) {
+            position &= CAPACITY - 1;
+            const size_t first = std::min(size, CAPACITY - position);
+            std::memcpy(data + position, bytes, first);
+            std::memcpy(data, static_cast<const char*>(bytes) + first, size - first);
+        }
+
+        void CopyOut(size_t position, void* bytes, const size_t size) const {
+            position &= CAPACITY - 1;
+            const size_t first = std::min(size, CAPACITY - position);
+            std::memcpy(bytes, data + position, first);
+            std::memcpy(static_cast<char*>(bytes) + first, data, size - first);
+        }
+    };
+
+    struct RecordHeader {
+        FILE* stream;
+        size_t size;
+    };
+
+    class AsyncWriter {
+    public:
+        AsyncWriter() : thread([this] { Run(); }) {}
+
+        ~AsyncWriter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            thread.join();
+        }
+
+        // Never blocks while the thread's ring has room; a full ring waits
+        // for the writer rather than dropping records
+        void Push(FILE* stream, const std::string_view record) {
+            const size_t size = sizeof(RecordHeader) + record.size();
+            if (size > Ring::CAPACITY) {
+                // Cannot be queued at all: written in place once everything
+                // this thread queued before it is out
+                Flush();
+                WriteNow(stream, record);
+                return;
+            }
+
+            Ring& ring = LocalRing();
+            const size_t head = ring.head.load(std::memory_order_relaxed);
+            while (head + size - ring.tail.load(std::memory_order_acquire) > Ring::CAPACITY) {
+                Wake();
+                std::this_thread::yield();
+            }
+            const RecordHeader header{stream, record.size()};
+            ring.CopyIn(head, &header, sizeof(header));
+            ring.CopyIn(head + sizeof(header), record.data(), record.size());
+            ring.head.store(head + size, std::memory_order_release);
+            Wake();
+        }
+
+        // Returns once every record queued before the call has been written
+        void Flush() {
+            std::unique_lock<std::mutex> lock(mutex);
+            const uint64_t generation = ++requested;
+            wake.notify_one();
+            flushed.wait(lock, [&] { return completed >= generation; });
+        }
+
+    private:
+        Ring& LocalRing() {
+            // Marks the ring closed when the thread exits; the writer drops
+            // it once it is empty
+            struct Owner {
+                std::shared_ptr<Ring> ring;
+                ~Owner() {
+                    if (ring) {
+                        ring->closed.store(true, std::memory_order_release);
+                    }
+                }
+            };
+            thread_local Owner owner;
+            if (!owner.ring) {
+                owner.ring = std::make_shared<Ring>();
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                rings.push_back(owner.ring);
+            }
+            return *owner.ring;
+        }
+
+        // Only takes the lock when the writer is asleep
+        void Wake() {
+            pending.store(true);
+            if (sleeping.load()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                wake.notify_one();
+            }
+        }
+
+        void Run() {
+            std::vector<std::pair<FILE*, std::string>> batches;
+            for (;;) {
+                uint64_t generation;
+                bool stop;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    sleeping.store(true);
+                    wake.wait(lock, [&] { return stopping || requested != completed || pending.load(); });
+                    sleeping.store(false);
+                    pending.store(false);
+                    generation = requested;
+                    stop = stopping;
+                }
+
+                Drain(batches);
+                for (auto& [stream, text] : batches) {
+                    if (!text.empty()) {
+                        WriteNow(stream, text);
+                        std::fflush(stream);
+                        text.clear();
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    completed = generation;
+                }
+                flushed.notify_all();
+                if (stop) {
+                    return;
+                }
+            }
+        }
+
+        // Moves every queued record into the batch of its stream, so each
+        // stream gets one write per pass
+        void Drain(std::vector<std::pair<FILE*, std::string>>& batches) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (auto it = rings.begin(); it != rings.end();) {
+                Ring& ring = **it;
+                // Read closed first: a ring found closed is already complete
+                const bool closed = ring.closed.load(std::memory_order_acquire);
+                size_t tail = ring.tail.load(std::memory_order_relaxed);
+                const size_t head = ring.head.load(std::memory_order_acquire);
+                while (tail != head) {
+                    RecordHeader header{};
+                    ring.CopyOut(tail, &header, sizeof(header));
+                    std::string* batch = nullptr;
+                    for (auto& [stream, text] : batches) {
+                        if (stream == header.stream) {
+                            batch = &text;
+                        }
+                    }
+                    if (!batch) {
+                        batch = &batches.emplace_back(header.stream, std::string()).second;
+                    }
+                    const size_t offset = batch->size();
+                    batch->resize(offset + header.size);
+                    ring.CopyOut(tail + sizeof(header), batch->data() + offset, header.size);
+                    tail += sizeof(header) + header.size;
+                }
+                ring.tail.store(tail, std::memory_order_release);
+                it = closed ? rings.erase(it) : it + 1;
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable flushed;
+        bool stopping = false;
+        uint64_t requested = 0;
+        uint64_t completed = 0;
+        std::atomic<bool> pending{false};
+        std::atomic<bool> sleeping{false};
+
+        std::mutex ringsMutex;
+        std::vector<std::shared_ptr<Ring>> rings;
+
+        std::thread thread; // Last, so it starts once everything else exists
+    };
+
+    // Set while the writer exists, so records logged during static
+    // destruction are written directly instead
+    std::atomic<AsyncWriter*> g_writer{nullptr};
+
+    AsyncWriter* Writer() {
+        struct Instance {
+            AsyncWriter writer;
+            Instance() { g_writer.store(&writer); }
+            ~Instance() { g_writer.store(nullptr); }
+        };
+        static Instance instance;
+        return g_writer.load();
+    }
+#endif
+}
+
+namespace out {
+
+    namespace detail {
+
+        void append_timestamp(fmt::memory_buffer& buffer) {
+            thread_local std::time_t cachedSecond = -1;
+            thread_local char cachedText[32];
+            thread_local size_t cachedLength = 0;
+
+            const auto now = std::chrono::system_clock::now();
+            const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
+            const std::time_t second = std::chrono::system_clock::to_time_t(now);
+            if (second != cachedSecond) {
+                std::tm local{};
+                ::localtime_r(&second, &local);
+                cachedLength = std::strftime(cachedText, sizeof(cachedText), "%Y-%m-%d %H:%M:%S", &local);
+                cachedSecond = second;
+            }
+            const auto fraction = static_cast<unsigned>(milliseconds.count() % 1000);
+            buffer.append(cachedText, cachedText + cachedLength);
+            const char digits[4] = {'.', static_cast<char>('0' + fraction / 100),
+                                    static_cast<char>('0' + fraction / 10 % 10), static_cast<char>('0' + fraction % 10)};
+            buffer.append(digits, digits + sizeof(digits));
+        }
+
+        void write_record(FILE* stream, const std::string_view record) {
+#ifdef LOG_ASYNC
+            if (AsyncWriter* writer = Writer()) {
+                writer->Push(stream, record);
+                return;
+            }
+#endif
+            WriteNow(stream, record);
+        }
+
+    } // namespace detail
+
+    void flush() {
+#ifdef LOG_ASYNC
+        if (AsyncWriter* writer = g_writer.load()) {
+            writer->Flush();
+        }
+#endif
+    }
+
+} // namespace out
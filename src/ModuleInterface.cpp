@@ -0,0 +1,242 @@
+#include "ModuleInterface.h"
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "ContentHash.h"
+#include "Lexer.h"
+
+namespace {
+    constexpr char MAGIC[4] = {'A', 'P', 'X', 'I'};
+    constexpr uint32_t VERSION = 2;
+    constexpr uint32_t CONST_VARIABLE = 1 << 0;
+
+    void AppendU32(std::string& out, const uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    uint32_t EncodeType(const Type type) {
+        return static_cast<uint32_t>(type.base) | static_cast<uint32_t>(type.pointers) << 8;
+    }
+
+    // Bounds-checked reads over a mapped file, which may be truncated or not
+    // an interface at all
+    struct Reader {
+        std::string_view bytes;
+        size_t position = 0;
+
+        uint32_t U32() {
+            if (bytes.size() - position < sizeof(uint32_t)) {
+                throw std::runtime_error("Truncated module interface");
+            }
+            uint32_t value;
+            std::memcpy(&value, bytes.data() + position, sizeof(value));
+            position += sizeof(value);
+            return value;
+        }
+
+        Type TypeValue() {
+            const uint32_t value = U32();
+            const auto base = static_cast<BaseType>(value & 0xFF);
+            if (value >> 16 != 0 || base < BaseType::I8 || base > BaseType::F64) {
+                throw std::runtime_error("Corrupt module interface");
+            }
+            return {base, static_cast<uint8_t>(value >> 8)};
+        }
+
+        std::string_view Name(const std::string_view strings) {
+            const uint32_t offset = U32();
+            const uint32_t length = U32();
+            if (offset > strings.size() || length > strings.size() - offset) {
+                throw std::runtime_error("Corrupt module interface");
+            }
+            return strings.substr(offset, length);
+        }
+    };
+}
+
+namespace apxi {
+
+    std::string Write(const Program& program) {
+        std::vector<const FunctionDeclaration*> functions;
+        std::vector<const VariableDeclaration*> variables;
+        for (const auto* stmt : program.statements) {
+            if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+                if (funcDecl->isGlobal) {
+                    functions.push_back(funcDecl);
+                }
+            } else if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+                if (varDecl->isGlobal) {
+                    variables.push_back(varDecl);
+                }
+            }
+        }
+        if (functions.empty() && variables.empty()) {
+            return {};
+        }
+
+        std::string strings;
+        auto appendName = [&](std::string& out, const std::string_view name) {
+            AppendU32(out, static_cast<uint32_t>(strings.size()));
+            AppendU32(out, static_cast<uint32_t>(name.size()));
+            strings += name;
+        };
+
+        std::string out(MAGIC, sizeof(MAGIC));
+        std::string parameterTypes;
+        AppendU32(out, VERSION);
+        AppendU32(out, static_cast<uint32_t>(functions.size()));
+        AppendU32(out, static_cast<uint32_t>(variables.size()));
+        for (const auto* funcDecl : functions) {
+            appendName(out, funcDecl->name->value);
+            AppendU32(out, EncodeType(funcDecl->returnType->type));
+            AppendU32(out, static_cast<uint32_t>(parameterTypes.size() / sizeof(uint32_t)));
+            AppendU32(out, static_cast<uint32_t>(funcDecl->parameters.size()));
+            for (const auto* param : funcDecl->parameters) {
+                AppendU32(parameterTypes, EncodeType(param->type));
+            }
+        }
+        for (const auto* varDecl : variables) {
+            appendName(out, varDecl->name->value);
+            AppendU32(out, varDecl->isConst ? CONST_VARIABLE : 0);
+            AppendU32(out, EncodeType(varDecl->name->type));
+        }
+        return out + parameterTypes + strings;
+    }
+
+    ModuleInterface Read(const std::string_view bytes) {
+        if (bytes.size() < sizeof(MAGIC) || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a module interface");
+        }
+        Reader reader{bytes, sizeof(MAGIC)};
+        if (reader.U32() != VERSION) {
+            throw std::runtime_error("Module interface was written by a different compiler version");
+        }
+        const uint32_t functionCount = reader.U32();
+        const uint32_t variableCount = reader.U32();
+        // Five words per function and four per variable; checked first so
+        // the counts cannot make the later tables start past the end
+        const uint64_t tableSize = (static_cast<uint64_t>(functionCount) * 5 + static_cast<uint64_t>(variableCount) * 4)
+                                   * sizeof(uint32_t);
+        if (tableSize > bytes.size() - reader.position) {
+            throw std::runtime_error("Truncated module interface");
+        }
+
+        // The parameter counts give the size of the parameter type table,
+        // which comes before the strings
+        uint64_t parameterCount = 0;
+        for (uint32_t i = 0; i < functionCount; ++i) {
+            uint32_t count;
+            std::memcpy(&count, bytes.data() + reader.position + (i * 5 + 4) * sizeof(uint32_t), sizeof(count));
+            parameterCount += count;
+        }
+        const size_t typesStart = reader.position + tableSize;
+        if (parameterCount * sizeof(uint32_t) > bytes.size() - typesStart) {
+            throw std::runtime_error("Truncated module interface");
+        }
+        const std::string_view strings = bytes.substr(typesStart + parameterCount * sizeof(uint32_t));
+
+        ModuleInterface interface;
+        interface.functions.reserve(functionCount);
+        for (uint32_t i = 0; i < functionCount; ++i) {
+            ModuleInterface::Function function;
+            function.name = reader.Name(strings);
+            function.returnType = reader.TypeValue();
+            const uint32_t first = reader.U32();
+            const uint32_t count = reader.U32();
+            if (first > parameterCount || count > parameterCount - first) {
+                throw std::runtime_error("Corrupt module interface");
+            }
+            Reader types{bytes, typesStart + static_cast<size_t>(first) * sizeof(uint32_t)};
+            for (uint32_t j = 0; j < count; ++j) {
+                function.parameterTypes.push_back(types.TypeValue());
+            }
+            interface.functions.push_back(std::move(function));
+        }
+        interface.variables.reserve(variableCount);
+        for (uint32_t i = 0; i < variableCount; ++i) {
+            const std::string_view name = reader.Name(strings);
+            const bool isConst = (reader.U32() & CONST_VARIABLE) != 0;
+            interface.variables.push_back({name, isConst, reader.TypeValue()});
+        }
+        return interface;
+    }
+
+    std::vector<std::string> ScanImports(const std::string_view source) {
+        std::vector<std::string> imports;
+        if (source.find("import") == std::string_view::npos) {
+            return imports;
+        }
+        // Only tokens are needed: imports are `import name` outside any braces
+        StringInterner interner;
+        Lexer lexer(source, interner);
+        int depth = 0;
+        bool afterImport = false;
+        for (Token token = lexer.NextToken(); token.type != TokenType::Eof; token = lexer.NextToken()) {
+            if (afterImport && token.type == TokenType::Identifier) {
+                imports.emplace_back(token.literal);
+            }
+            afterImport = depth == 0 && token.type == TokenType::Import;
+            if (token.type == TokenType::LBrace) {
+                ++depth;
+            } else if (token.type == TokenType::RBrace) {
+                --depth;
+            }
+        }
+        return imports;
+    }
+
+} // namespace apxi
+
+ModuleLoader::ModuleLoader(std::vector<std::string> searchPath) : searchPath(std::move(searchPath)) {}
+
+std::string ModuleLoader::Find(const std::string_view name) const {
+    for (const auto& directory : searchPath) {
+        std::string path = (directory.empty() ? std::string(".") : directory) + "/" + std::string(name) + ".apxi";
+        struct stat st{};
+        if (::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            return path;
+        }
+    }
+    return {};
+}
+
+const ModuleInterface* ModuleLoader::Load(const std::string_view name) {
+    const auto [it, inserted] = modules.try_emplace(std::string(name));
+    if (!inserted) {
+        return it->second ? &it->second->interface : nullptr;
+    }
+    const std::string path = Find(name);
+    if (path.empty()) {
+        return nullptr;
+    }
+    auto module = std::make_unique<Module>();
+    if (!module->file.Open(path)) {
+        return nullptr;
+    }
+    try {
+        module->interface = apxi::Read(module->file.GetContents());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(std::string(e.what()) + ": " + path);
+    }
+    module->hash = HashBytes(module->file.GetContents());
+    it->second = std::move(module);
+    loadOrder.push_back(it->first);
+    return &it->second->interface;
+}
+
+std::vector<ModuleLoader::Dependency> ModuleLoader::GetDependencies() const {
+    std::vector<Dependency> dependencies;
+    for (const auto& name : loadOrder) {
+        dependencies.push_back({name, modules.at(name)->hash});
+    }
+    return dependencies;
+}
+
+uint64_t ModuleLoader::HashOf(const std::string_view name) const {
+    const std::string path = Find(name);
+    SourceFile file;
+    if (path.empty() || !file.Open(path)) {
+        return 0;
+    }
+    return HashBytes(file.GetContents());
+}
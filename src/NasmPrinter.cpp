@@ -0,0 +1,247 @@
+#include "NasmPrinter.h"
+#include <charconv>
+#include <sstream>
+
+namespace nasm {
+
+    namespace {
+        constexpr const char* REGISTERS_64[] = {
+            "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+            "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
+        };
+        constexpr const char* REGISTERS_32[] = {
+            "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+            "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+        };
+        constexpr const char* REGISTERS_16[] = {
+            "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+            "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w",
+        };
+        constexpr const char* REGISTERS_8[] = {
+            "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+            "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b",
+        };
+        constexpr const char* CONDITIONS[] = {
+            "o", "no", "b", "ae", "e", "ne", "be", "a", "s", "ns", "p", "np", "l", "ge", "le", "g",
+        };
+
+        const char* Mnemonic(const Instruction& instruction) {
+            switch (instruction.op) {
+                case Opcode::Mov: return "mov";
+                case Opcode::Movzx: return "movzx";
+                case Opcode::Movsx: return instruction.src.size == 4 ? "movsxd" : "movsx";
+                case Opcode::Lea: return "lea";
+                case Opcode::Push: return "push";
+                case Opcode::Pop: return "pop";
+                case Opcode::Add: return "add";
+                case Opcode::Or: return "or";
+                case Opcode::And: return "and";
+                case Opcode::Sub: return "sub";
+                case Opcode::Xor: return "xor";
+                case Opcode::Cmp: return "cmp";
+                case Opcode::Test: return "test";
+                case Opcode::Imul: return "imul";
+                case Opcode::Neg: return "neg";
+                case Opcode::Not: return "not";
+                case Opcode::Idiv: return "idiv";
+                case Opcode::Div: return "div";
+                case Opcode::Cqo: return "cqo";
+                case Opcode::Cdq: return "cdq";
+                case Opcode::Jmp: return "jmp";
+                case Opcode::Call: return "call";
+                case Opcode::Leave: return "leave";
+                case Opcode::Ret: return "ret";
+                case Opcode::Syscall: return "syscall";
+                case Opcode::Nop: return "nop";
+                case Opcode::Label:
+                case Opcode::Raw:
+                case Opcode::Set:
+                case Opcode::Jcc:
+                    break;
+            }
+            return "";
+        }
+
+        const char* SizeKeyword(const uint8_t size) {
+            switch (size) {
+                case 1: return "byte ";
+                case 2: return "word ";
+                case 4: return "dword ";
+                default: return "qword ";
+            }
+        }
+
+        bool IsMemory(const Operand& operand) {
+            return operand.kind == Operand::Kind::Mem || operand.kind == Operand::Kind::Global;
+        }
+
+        void AppendInteger(OutputSink& out, const int64_t value) {
+            char digits[24];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            out.Append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+        }
+
+        void PrintOperand(OutputSink& out, const Operand& operand, const bool needsSize) {
+            if (needsSize && IsMemory(operand)) {
+                out += SizeKeyword(operand.size);
+            }
+            switch (operand.kind) {
+                case Operand::Kind::Reg:
+                    out += RegisterName(operand.reg, operand.size);
+                    break;
+                case Operand::Kind::Imm:
+                    AppendInteger(out, operand.value);
+                    break;
+                case Operand::Kind::Mem:
+                    out += '[';
+                    out += RegisterName(operand.reg);
+                    if (operand.value > 0) {
+                        out += '+';
+                    }
+                    if (operand.value != 0) {
+                        AppendInteger(out, operand.value);
+                    }
+                    out += ']';
+                    break;
+                case Operand::Kind::Global:
+                    out += '[';
+                    out += operand.name;
+                    out += ']';
+                    break;
+                case Operand::Kind::Symbol:
+                    out += operand.name;
+                    break;
+                case Operand::Kind::Label:
+                    out += operand.name;
+                    AppendInteger(out, operand.value);
+                    break;
+                case Operand::Kind::None:
+                    break;
+            }
+        }
+    }
+
+    const char* RegisterName(const Reg reg, const uint8_t size) {
+        const auto index = static_cast<size_t>(reg);
+        switch (size) {
+            case 1: return REGISTERS_8[index];
+            case 2: return REGISTERS_16[index];
+            case 4: return REGISTERS_32[index];
+            default: return REGISTERS_64[index];
+        }
+    }
+
+    const char* ConditionName(const Cond cond) {
+        switch (cond) {
+            case Cond::Z: return "z";
+            case Cond::NZ: return "nz";
+            default: return CONDITIONS[static_cast<size_t>(cond) & 0xF];
+        }
+    }
+
+    void PrintInstruction(OutputSink& out, const Instruction& instruction) {
+        switch (instruction.op) {
+            case Opcode::Label:
+                PrintOperand(out, instruction.dst, false);
+                out += ":\n";
+                return;
+            case Opcode::Raw:
+                out += "    ";
+                out += instruction.dst.name;
+                out += '\n';
+                return;
+            case Opcode::Set:
+                out += "    set";
+                out += ConditionName(instruction.cond);
+                break;
+            case Opcode::Jcc:
+                out += "    j";
+                out += ConditionName(instruction.cond);
+                break;
+            default:
+                out += "    ";
+                out += Mnemonic(instruction);
+                break;
+        }
+
+        // A memory operand needs an explicit size unless a register of the
+        // same size gives it
+        const bool extends = instruction.op == Opcode::Movzx || instruction.op == Opcode::Movsx;
+        const bool needsSize = extends
+            || (instruction.dst.kind != Operand::Kind::Reg && instruction.src.kind != Operand::Kind::Reg);
+        if (instruction.dst.kind != Operand::Kind::None) {
+            out += ' ';
+            PrintOperand(out, instruction.dst, needsSize);
+        }
+        if (instruction.src.kind != Operand::Kind::None) {
+            out += ", ";
+            PrintOperand(out, instruction.src, needsSize);
+        }
+        out += '\n';
+    }
+
+    void PrintFunction(OutputSink& out, const MachineFunction& function) {
+        out += function.name;
+        out += ":\n";
+        for (const auto& instruction : function.code) {
+            PrintInstruction(out, instruction);
+        }
+    }
+
+    void PrintHeader(OutputSink& out, const MachineModule& module) {
+        out += "section .data\n";
+        for (const auto& item : module.data) {
+            if (item.alignment > 0) {
+                out += "    align ";
+                AppendInteger(out, item.alignment);
+                out += '\n';
+            }
+            out += "    ";
+            out += item.name;
+            out += item.size == 4 ? ": dd " : ": dq ";
+            if (item.isFloat) {
+                out += FormatFloat(item.floatValue);
+            } else {
+                AppendInteger(out, item.intValue);
+            }
+            out += '\n';
+        }
+
+        out += "\nsection .bss\n\nsection .text\ndefault rel\n";
+        for (const auto& name : module.globals) {
+            out += "global ";
+            out += name;
+            out += '\n';
+        }
+        for (const auto& name : module.externs) {
+            out += "extern ";
+            out += name;
+            out += '\n';
+        }
+        out += '\n';
+    }
+
+    std::string Print(const MachineModule& module) {
+        // Rough size so the text is not regrown many times on large modules
+        size_t instructions = 0;
+        for (const auto& function : module.functions) {
+            instructions += function.code.size();
+        }
+        std::string text;
+        text.reserve(256 + module.data.size() * 32 + instructions * 20);
+        OutputSink out(text);
+        PrintHeader(out, module);
+        for (const auto& function : module.functions) {
+            PrintFunction(out, function);
+        }
+        out.Flush();
+        return text;
+    }
+
+    std::string FormatFloat(const double value) {
+        std::ostringstream os;
+        os << value;
+        return os.str();
+    }
+
+} // namespace nasm
@@ -0,0 +1,172 @@
+#include "OutputSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+OutputSink::OutputSink(Drain drain, const size_t capacity)
+    : drain(std::move(drain)), buffer(new char[capacity]), cursor(buffer.get()), limit(buffer.get() + capacity) {}
+
+OutputSink::OutputSink(std::string& target, const size_t capacity)
+    : OutputSink([&target](const std::string_view buffered, const std::string_view text) {
+          target.append(buffered);
+          target.append(text);
+          return true;
+      }, capacity) {}
+
+void OutputSink::Append(size_t count, const char c) {
+    while (count > 0) {
+        if (cursor == limit) {
+            Flush();
+        }
+        const size_t chunk = std::min(count, static_cast<size_t>(limit - cursor));
+        std::memset(cursor, c, chunk);
+        cursor += chunk;
+        count -= chunk;
+    }
+}
+
+bool OutputSink::Flush() {
+    if (cursor != buffer.get()) {
+        const std::string_view buffered(buffer.get(), static_cast<size_t>(cursor - buffer.get()));
+        failed = !drain(buffered, {}) || failed;
+        drained += buffered.size();
+        cursor = buffer.get();
+    }
+    return !failed;
+}
+
+void OutputSink::AppendSlow(const std::string_view text) {
+    // Small pieces are buffered after draining; large ones skip the copy
+    const auto capacity = static_cast<size_t>(limit - buffer.get());
+    if (text.size() < capacity / 2) {
+        Flush();
+        std::memcpy(cursor, text.data(), text.size());
+        cursor += text.size();
+        return;
+    }
+    const std::string_view buffered(buffer.get(), static_cast<size_t>(cursor - buffer.get()));
+    failed = !drain(buffered, text) || failed;
+    drained += buffered.size() + text.size();
+    cursor = buffer.get();
+}
+
+FileOutput::FileOutput(std::string path) : path(std::move(path)) {
+    // Only regular files are compared; reading a pipe, terminal or device
+    // such as /dev/stdout could block or consume input
+    struct stat st{};
+    if (::stat(this->path.c_str(), &st) == 0 && !S_ISREG(st.st_mode)) {
+        existed = false;
+        StartWriting();
+        return;
+    }
+    existed = existing.Open(this->path);
+}
+
+FileOutput::~FileOutput() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool FileOutput::StartWriting() {
+    // Everything before matched is already on disk, so writing resumes there
+    matching = false;
+    existing = SourceFile();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+    // Pipes cannot seek, but nothing is skipped on them either
+    failed = fd < 0 || (matched > 0 && ::lseek(fd, static_cast<off_t>(matched), SEEK_SET) < 0);
+    written = matched;
+    return !failed;
+}
+
+bool FileOutput::Write(const std::string_view first, const std::string_view second) {
+    if (failed) {
+        return false;
+    }
+    const std::string_view parts[] = {first, second};
+    size_t part = 0;
+    for (; matching && part < 2; ++part) {
+        const std::string_view contents = existing.GetContents();
+        if (contents.size() - matched < parts[part].size()
+            || contents.compare(matched, parts[part].size(), parts[part]) != 0) {
+            if (!StartWriting()) {
+                return false;
+            }
+            break;
+        }
+        matched += parts[part].size();
+    }
+    if (matching) {
+        return true;
+    }
+
+    iovec vectors[2];
+    int count = 0;
+    for (; part < 2; ++part) {
+        if (!parts[part].empty()) {
+            vectors[count++] = {const_cast<char*>(parts[part].data()), parts[part].size()};
+        }
+    }
+    iovec* next = vectors;
+    while (count > 0) {
+        const ssize_t result = ::writev(fd, next, count);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            failed = true;
+            return false;
+        }
+        written += static_cast<size_t>(result);
+        auto remaining = static_cast<size_t>(result);
+        while (count > 0 && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            ++next;
+            --count;
+        }
+        if (count > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+            next->iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+bool FileOutput::Finish() {
+    if (failed) {
+        return false;
+    }
+    if (matching) {
+        if (existed && matched == existing.GetContents().size()) {
+            return true;
+        }
+        // A new file, or an old one that the output is a prefix of
+        if (!StartWriting()) {
+            return false;
+        }
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ::ftruncate(fd, static_cast<off_t>(written)) != 0) {
+        failed = true;
+    }
+    failed = ::close(fd) != 0 || failed;
+    fd = -1;
+    return !failed;
+}
+
+void FileOutput::Abandon() {
+    if (matching || fd < 0) {
+        return;
+    }
+    // Never unlink devices such as /dev/null
+    struct stat st{};
+    const bool regular = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    ::close(fd);
+    fd = -1;
+    if (regular) {
+        ::unlink(path.c_str());
+    }
+}
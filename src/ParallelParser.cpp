@@ -0,0 +1,174 @@
+#include "ParallelParser.h"
+#include <algorithm>
+#include <cstring>
+#include "CharScan.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+namespace {
+    // Skips whitespace and line comments from pos, like Lexer::SkipTrivia
+    size_t SkipTrivia(const std::string_view source, size_t pos) {
+        for (;;) {
+            pos = scan::SkipWhitespace(source, pos);
+            if (pos + 1 < source.size() && source[pos] == '/' && source[pos + 1] == '/') {
+                pos = scan::FindNewline(source, pos);
+                continue;
+            }
+            return pos;
+        }
+    }
+
+    bool ContinuesStatement(const std::string_view source, const size_t pos) {
+        const size_t end = scan::SkipIdentifier(source, pos);
+        return source.substr(pos, end - pos) == "else";
+    }
+
+    // One run of items and everything parsing it produced
+    struct Piece {
+        std::unique_ptr<StringInterner> interner; // All but the first run
+        ErrorReporter errors;
+        std::unique_ptr<Program> program;
+        std::vector<Identifier*> identifiers;
+        std::vector<Symbol> symbols; // Run symbol -> shared symbol
+        size_t tokenCount = 0;
+        std::array<size_t, NODE_KIND_COUNT> nodeCounts{};
+        bool complete = false;
+    };
+}
+
+ParallelParser::ParallelParser(const std::string_view source, StringInterner& interner, ErrorReporter& errorReporter,
+                               ThreadPool& pool)
+    : source(source), interner(interner), errorReporter(errorReporter), pool(pool) {}
+
+std::vector<size_t> ParallelParser::FindSplitPoints(const std::string_view source, const size_t pieces) {
+    std::vector<size_t> starts{0};
+    const char* data = source.data();
+    const size_t size = source.size();
+    long depth = 0;
+    size_t pos = 0;
+    while (starts.size() < pieces) {
+        pos = scan::FindStructural(source, pos);
+        if (pos == size) {
+            break;
+        }
+        const char c = data[pos++];
+        if (c == '"') {
+            const void* quote = std::memchr(data + pos, '"', size - pos);
+            if (!quote) {
+                break;
+            }
+            pos = static_cast<const char*>(quote) - data + 1;
+            continue;
+        }
+        if (c == '/' && pos < size && data[pos] == '/') {
+            pos = scan::FindNewline(source, pos);
+            continue;
+        }
+        if (c == '\0') {
+            break; // The lexer ends the input here
+        }
+        if (c == '{') {
+            ++depth;
+            continue;
+        }
+        if (c == '}') {
+            --depth;
+        } else if (c != ';') {
+            continue;
+        }
+        if (depth != 0 || pos < starts.size() * size / pieces) {
+            continue;
+        }
+        const size_t next = SkipTrivia(source, pos);
+        if (next < size && !ContinuesStatement(source, next)) {
+            starts.push_back(next);
+        }
+    }
+    return starts;
+}
+
+std::unique_ptr<Program> ParallelParser::ParseSerially() {
+    Lexer lexer(source, interner);
+    Parser parser(lexer, errorReporter);
+    auto program = parser.ParseProgram();
+    tokenCount = parser.GetTokenCount();
+    nodeCounts = parser.GetNodeCounts();
+    return program;
+}
+
+std::unique_ptr<Program> ParallelParser::ParseProgram() {
+    const size_t pieceCount = std::min<size_t>(pool.GetThreadCount() * 2, source.size() / MIN_PIECE_BYTES);
+    if (pieceCount < 2) {
+        return ParseSerially();
+    }
+    const std::vector<size_t> starts = FindSplitPoints(source, pieceCount);
+    if (starts.size() < 2) {
+        return ParseSerially();
+    }
+
+    // The first run interns straight into the shared interner: it sees the
+    // same strings in the same order as a serial parse would
+    std::vector<Piece> pieces(starts.size());
+    pool.ParallelFor(pieces.size(), [&](const size_t i) {
+        Piece& piece = pieces[i];
+        const bool last = i + 1 == pieces.size();
+        if (i > 0) {
+            piece.interner = std::make_unique<StringInterner>();
+        }
+        Lexer lexer(source, i > 0 ? *piece.interner : interner, starts[i]);
+        Parser parser(lexer, piece.errors);
+        if (i > 0) {
+            parser.LogIdentifiers(&piece.identifiers);
+        }
+        piece.program = parser.ParseProgram(last ? SIZE_MAX : starts[i + 1]);
+        piece.complete = last || parser.GetOffset() == starts[i + 1];
+        piece.tokenCount = parser.GetTokenCount();
+        piece.nodeCounts = parser.GetNodeCounts();
+    });
+    for (const Piece& piece : pieces) {
+        if (!piece.complete) {
+            // Symbols the first run added are a prefix of the serial ones, so
+            // the shared interner can be reused as it is
+            return ParseSerially();
+        }
+    }
+
+    // Interned in run order, so symbols are numbered as in a serial parse
+    for (size_t i = 1; i < pieces.size(); ++i) {
+        Piece& piece = pieces[i];
+        piece.symbols.resize(piece.interner->Size());
+        for (Symbol symbol = 0; symbol < piece.symbols.size(); ++symbol) {
+            piece.symbols[symbol] = interner.Intern(piece.interner->GetString(symbol));
+        }
+    }
+    pool.ParallelFor(pieces.size() - 1, [&](const size_t i) {
+        Piece& piece = pieces[i + 1];
+        for (Identifier* identifier : piece.identifiers) {
+            identifier->symbol = piece.symbols[identifier->symbol];
+            identifier->value = interner.GetString(identifier->symbol);
+        }
+    });
+
+    auto program = std::move(pieces[0].program);
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        Piece& piece = pieces[i];
+        if (i > 0) {
+            program->arena.Adopt(std::move(piece.program->arena));
+            program->statements.insert(program->statements.end(), piece.program->statements.begin(),
+                                       piece.program->statements.end());
+            program->attributes.insert(piece.program->attributes.begin(), piece.program->attributes.end());
+        }
+        for (const Diagnostic& error : piece.errors.GetErrors()) {
+            errorReporter.AddError(error.message, error.line, error.column);
+        }
+        tokenCount += piece.tokenCount;
+        for (size_t kind = 0; kind < NODE_KIND_COUNT; ++kind) {
+            nodeCounts[kind] += piece.nodeCounts[kind];
+        }
+    }
+    // Every run but the first lexed the two tokens the previous one stopped
+    // at again, and counted a Program of its own
+    tokenCount -= 2 * (pieces.size() - 1);
+    nodeCounts[static_cast<size_t>(NodeKind::Program)] = 1;
+    return program;
+}
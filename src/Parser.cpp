@@ -1,9 +1,11 @@
 
 #include "Parser.h"
 
+#include <charconv>
+#include <string>
 #include <unordered_map>
 
-std::unordered_map<TokenType, Precedence> Parser::precedences = {
+const std::unordered_map<TokenType, Precedence> Parser::precedences = {
     {TokenType::Equal, Precedence::EQUALS},
     {TokenType::NotEqual, Precedence::EQUALS},
     {TokenType::LessThan, Precedence::LESSGREATER},
@@ -26,30 +28,34 @@ Parser::Parser(Lexer& lexer, ErrorReporter& errorReporter) : lexer(lexer), error
 void Parser::NextToken() {
     currentToken = peekToken;
     peekToken = lexer.NextToken();
+    ++tokenCount;
 }
 
-std::unique_ptr<Program> Parser::ParseProgram() {
-    auto program = std::make_unique<Program>();
+std::unique_ptr<Program> Parser::ParseProgram(const size_t end) {
+    auto result = std::make_unique<Program>();
+    program = result.get();
+    ++nodeCounts[static_cast<size_t>(NodeKind::Program)];
 
-    while (currentToken.type != TokenType::Eof) {
+    while (currentToken.type != TokenType::Eof && currentToken.offset < end) {
         auto stmt = ParseStatement();
         if (stmt) {
-            program->statements.push_back(std::move(stmt));
+            program->statements.push_back(stmt);
         }
         NextToken();
     }
 
-    return program;
+    program = nullptr;
+    return result;
 }
 
-std::unique_ptr<Statement> Parser::ParseStatement() {
+Statement* Parser::ParseStatement() {
     // Parse attributes first if present
-    std::vector<std::unique_ptr<Attribute>> attributes;
+    std::vector<Attribute*> attributes;
     if (currentToken.type == TokenType::Hash) {
         attributes = ParseAttributes();
     }
     
-    std::unique_ptr<Statement> stmt;
+    Statement* stmt;
     switch (currentToken.type) {
         case TokenType::Const:
             stmt = ParseConstDeclaration();
@@ -69,6 +75,9 @@ std::unique_ptr<Statement> Parser::ParseStatement() {
         case TokenType::Asm:
             stmt = ParseInlineAssemblyStatement();
             break;
+        case TokenType::Import:
+            stmt = ParseImportDeclaration();
+            break;
         case TokenType::Return:
             stmt = ParseReturnStatement();
             break;
@@ -101,15 +110,21 @@ std::unique_ptr<Statement> Parser::ParseStatement() {
     
     // Apply attributes to the statement
     if (stmt && !attributes.empty()) {
-        stmt->attributes = std::move(attributes);
+        program->attributes[stmt] = program->arena.CopyList(attributes);
         
-        // Process specific attributes for variable declarations
-        if (auto* varDecl = dynamic_cast<VariableDeclaration*>(stmt.get())) {
-            for (const auto& attr : stmt->attributes) {
+        // Process specific attributes for variable and function declarations
+        if (auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+            for (const auto* attr : attributes) {
                 if (attr->name == "global") {
                     varDecl->isGlobal = true;
                 } else if (attr->name == "align" && !attr->arguments.empty()) {
-                    varDecl->alignment = std::stoi(attr->arguments[0]);
+                    varDecl->alignment = std::stoi(std::string(attr->arguments[0]));
+                }
+            }
+        } else if (auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+            for (const auto* attr : attributes) {
+                if (attr->name == "global") {
+                    funcDecl->isGlobal = true;
                 }
             }
         }
@@ -118,39 +133,35 @@ std::unique_ptr<Statement> Parser::ParseStatement() {
     return stmt;
 }
 
-std::unique_ptr<VariableDeclaration> Parser::ParseVariableDeclaration() {
-    auto stmt = std::make_unique<VariableDeclaration>();
+VariableDeclaration* Parser::ParseVariableDeclaration() {
+    auto stmt = Make<VariableDeclaration>();
 
     if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected identifier", lexer.GetLine(), lexer.GetColumn());
+        AddError("Expected identifier", currentToken);
         return nullptr;
     }
 
-    stmt->name = std::make_unique<Identifier>();
-    stmt->name->value = currentToken.literal;
+    stmt->name = MakeIdentifier(currentToken);
 
     NextToken();
 
     // Handle type annotation: x: i32 = 42
     if (currentToken.type == TokenType::Colon) {
         NextToken();
-        if (currentToken.type != TokenType::Identifier) {
-            errorReporter.AddError("Expected type identifier", lexer.GetLine(), lexer.GetColumn());
+        stmt->type = ParseType("Expected type identifier");
+        if (!stmt->type) {
             return nullptr;
         }
-        stmt->type = std::make_unique<Identifier>();
-        stmt->type->value = currentToken.literal;
-        NextToken();
-        
+
         if (currentToken.type != TokenType::Assign) {
-            errorReporter.AddError("Expected '=' after type annotation", lexer.GetLine(), lexer.GetColumn());
+            AddError("Expected '=' after type annotation", currentToken);
             return nullptr;
         }
     } else if (currentToken.type == TokenType::ColonAssign) {
         // Type inference: x := 42
         // No type annotation needed
     } else {
-        errorReporter.AddError("Expected ':=' or ':' in variable declaration", lexer.GetLine(), lexer.GetColumn());
+        AddError("Expected ':=' or ':' in variable declaration", currentToken);
         return nullptr;
     }
 
@@ -164,39 +175,34 @@ std::unique_ptr<VariableDeclaration> Parser::ParseVariableDeclaration() {
     return stmt;
 }
 
-std::unique_ptr<VariableDeclaration> Parser::ParseConstDeclaration() {
-    auto stmt = std::make_unique<VariableDeclaration>();
+VariableDeclaration* Parser::ParseConstDeclaration() {
+    auto stmt = Make<VariableDeclaration>();
     stmt->isConst = true;
 
     NextToken(); // Consume 'const'
 
     if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected identifier after 'const'", 0, 0);
+        AddError("Expected identifier after 'const'", currentToken);
         return nullptr;
     }
 
-    stmt->name = std::make_unique<Identifier>();
-    stmt->name->value = currentToken.literal;
+    stmt->name = MakeIdentifier(currentToken);
 
     NextToken();
 
     if (currentToken.type != TokenType::Colon) {
-        errorReporter.AddError("Expected ':' after const identifier", 0, 0);
+        AddError("Expected ':' after const identifier", currentToken);
         return nullptr;
     }
 
     NextToken();
-    if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected type identifier", 0, 0);
+    stmt->type = ParseType("Expected type identifier");
+    if (!stmt->type) {
         return nullptr;
     }
 
-    stmt->type = std::make_unique<Identifier>();
-    stmt->type->value = currentToken.literal;
-
-    NextToken();
     if (currentToken.type != TokenType::Assign) {
-        errorReporter.AddError("Expected '=' in const declaration", 0, 0);
+        AddError("Expected '=' in const declaration", currentToken);
         return nullptr;
     }
 
@@ -210,8 +216,8 @@ std::unique_ptr<VariableDeclaration> Parser::ParseConstDeclaration() {
     return stmt;
 }
 
-std::unique_ptr<ExpressionStatement> Parser::ParseExpressionStatement() {
-    auto stmt = std::make_unique<ExpressionStatement>();
+ExpressionStatement* Parser::ParseExpressionStatement() {
+    auto stmt = Make<ExpressionStatement>();
     stmt->expression = ParseExpression(LOWEST);
 
     if (PeekTokenIs(TokenType::Semicolon)) {
@@ -221,8 +227,8 @@ std::unique_ptr<ExpressionStatement> Parser::ParseExpressionStatement() {
     return stmt;
 }
 
-std::unique_ptr<ReturnStatement> Parser::ParseReturnStatement() {
-    auto stmt = std::make_unique<ReturnStatement>();
+ReturnStatement* Parser::ParseReturnStatement() {
+    auto stmt = Make<ReturnStatement>();
 
     NextToken(); // Consume "return"
 
@@ -235,65 +241,93 @@ std::unique_ptr<ReturnStatement> Parser::ParseReturnStatement() {
     return stmt;
 }
 
-std::unique_ptr<BlockStatement> Parser::ParseBlockStatement() {
-    auto block = std::make_unique<BlockStatement>();
+BlockStatement* Parser::ParseBlockStatement() {
+    if (blockDepth == MAX_BLOCK_DEPTH) {
+        AddError("Blocks nested more than " + std::to_string(MAX_BLOCK_DEPTH) + " deep", currentToken);
+        SkipBlock();
+        return nullptr;
+    }
+
+    auto block = Make<BlockStatement>();
+    std::vector<Statement*> statements;
 
     NextToken(); // Consume '{'
 
+    ++blockDepth;
     while (currentToken.type != TokenType::RBrace && currentToken.type != TokenType::Eof) {
         auto stmt = ParseStatement();
         if (stmt) {
-            block->statements.push_back(std::move(stmt));
+            statements.push_back(stmt);
         }
         NextToken();
     }
+    --blockDepth;
     
     if (currentToken.type != TokenType::RBrace) {
-        errorReporter.AddError("Expected '}' to close block", 0, 0);
+        AddError("Expected '}' to close block", currentToken);
         return nullptr;
     }
     
+    block->statements = program->arena.CopyList(statements);
     return block;
 }
 
-std::unique_ptr<FunctionDeclaration> Parser::ParseFunctionDeclaration() {
-    auto func = std::make_unique<FunctionDeclaration>();
+// Steps from a '{' to its matching '}' (or the end of input) without parsing
+void Parser::SkipBlock() {
+    size_t open = 0;
+    do {
+        if (currentToken.type == TokenType::LBrace) {
+            ++open;
+        } else if (currentToken.type == TokenType::RBrace) {
+            --open;
+        }
+        if (open != 0) {
+            NextToken();
+        }
+    } while (open != 0 && currentToken.type != TokenType::Eof);
+}
+
+FunctionDeclaration* Parser::ParseFunctionDeclaration() {
+    auto func = Make<FunctionDeclaration>();
 
     NextToken(); // Consume 'fn'
 
     if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected function name", 0, 0);
+        AddError("Expected function name", currentToken);
         return nullptr; // Error
     }
-    func->name = std::make_unique<Identifier>();
-    func->name->value = currentToken.literal;
+    func->name = MakeIdentifier(currentToken);
 
     NextToken(); // Consume function name
 
     if (currentToken.type != TokenType::LParen) {
-        errorReporter.AddError("Expected '(' after function name", 0, 0);
+        AddError("Expected '(' after function name", currentToken);
         return nullptr; // Error
     }
 
     // Parse parameters
+    std::vector<Identifier*> parameters;
+    std::vector<Identifier*> parameterTypes;
     NextToken(); // Consume '('
     while (currentToken.type != TokenType::RParen && currentToken.type != TokenType::Eof) {
         if (currentToken.type != TokenType::Identifier) {
-            errorReporter.AddError("Expected parameter name", 0, 0);
+            AddError("Expected parameter name", currentToken);
             return nullptr; // Error
         }
-        auto param = std::make_unique<Identifier>();
-        param->value = currentToken.literal;
-        func->parameters.push_back(std::move(param));
+        auto param = MakeIdentifier(currentToken);
+        parameters.push_back(param);
 
         NextToken(); // move past identifier
         if (currentToken.type == TokenType::Colon) {
             NextToken(); // consume ':'
-            if (currentToken.type != TokenType::Identifier) {
-                errorReporter.AddError("Expected type identifier", 0, 0);
-                return nullptr; // expected type identifier
+            auto type = ParseType("Expected type identifier");
+            if (!type) {
+                return nullptr;
             }
-            NextToken(); // consume type identifier
+            parameterTypes.push_back(type);
+        } else {
+            // Untyped parameters are i32, like an omitted return type
+            parameterTypes.push_back(MakeIdentifier("i32"));
         }
         if (currentToken.type == TokenType::Comma) {
             NextToken(); // move to next parameter or ')'
@@ -301,29 +335,27 @@ std::unique_ptr<FunctionDeclaration> Parser::ParseFunctionDeclaration() {
     }
 
     if (currentToken.type != TokenType::RParen) {
-        errorReporter.AddError("Expected ')' after parameters", 0, 0);
+        AddError("Expected ')' after parameters", currentToken);
         return nullptr; // Error
     }
 
     NextToken(); // Consume ')'
+    func->parameters = program->arena.CopyList(parameters);
+    func->parameterTypes = program->arena.CopyList(parameterTypes);
 
     if (currentToken.type == TokenType::Arrow) {
         NextToken(); // Consume '->'
-        if (currentToken.type != TokenType::Identifier) {
-            errorReporter.AddError("Expected return type", 0, 0);
-            return nullptr; // Error (return type)
+        func->returnType = ParseType("Expected return type");
+        if (!func->returnType) {
+            return nullptr;
         }
-        func->returnType = std::make_unique<Identifier>();
-        func->returnType->value = currentToken.literal;
-        NextToken(); // Consume return type
     } else {
         // Optional return type: default to i32 if omitted
-        func->returnType = std::make_unique<Identifier>();
-        func->returnType->value = "i32";
+        func->returnType = MakeIdentifier("i32");
     }
 
     if (currentToken.type != TokenType::LBrace) {
-        errorReporter.AddError("Expected '{' before function body", 0, 0);
+        AddError("Expected '{' before function body", currentToken);
         return nullptr; // Error
     }
 
@@ -335,117 +367,217 @@ std::unique_ptr<FunctionDeclaration> Parser::ParseFunctionDeclaration() {
     return func;
 }
 
-std::unique_ptr<CallExpression> Parser::ParseCallExpression(std::unique_ptr<Expression> function) {
-    auto call = std::make_unique<CallExpression>();
-    call->function = std::unique_ptr<Identifier>(dynamic_cast<Identifier*>(function.release()));
-
-    NextToken(); // currentToken now '('
-    NextToken(); // advance to first argument or ')'
-
-    while (currentToken.type != TokenType::RParen && currentToken.type != TokenType::Eof) {
-        auto arg = ParseExpression(LOWEST);
-        if (arg) {
-            call->arguments.push_back(std::move(arg));
-        }
-        NextToken();
-        if (currentToken.type == TokenType::Comma) {
-            NextToken();
-        }
-    }
-    NextToken(); // consume ')'
-
-    return call;
-}
-
-std::unique_ptr<Expression> Parser::ParsePrefixExpression() {
+// Literals and identifiers: the expressions that stand on their own
+Expression* Parser::ParseOperand() {
     switch (currentToken.type) {
         case TokenType::Integer: {
-            auto literal = std::make_unique<IntegerLiteral>();
-            if (currentToken.literal.substr(0, 2) == "0x" || currentToken.literal.substr(0, 2) == "0X") {
-                literal->value = std::stoll(currentToken.literal, nullptr, 16);
-            } else {
-                literal->value = std::stoll(currentToken.literal);
+            auto literal = Make<IntegerLiteral>();
+            std::string_view digits = currentToken.literal;
+            int base = 10;
+            if (digits.substr(0, 2) == "0x" || digits.substr(0, 2) == "0X") {
+                digits.remove_prefix(2);
+                base = 16;
+            }
+            const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), literal->value, base);
+            if (ec != std::errc() || end != digits.data() + digits.size()) {
+                AddError("Invalid integer literal " + std::string(currentToken.literal), currentToken);
+                return nullptr;
             }
             return literal;
         }
         case TokenType::Float: {
-            auto literal = std::make_unique<FloatLiteral>();
-            literal->value = std::stod(currentToken.literal);
+            auto literal = Make<FloatLiteral>();
+            literal->value = std::stod(std::string(currentToken.literal));
             return literal;
         }
         case TokenType::Identifier: {
-            auto ident = std::make_unique<Identifier>();
-            ident->value = currentToken.literal;
+            auto ident = MakeIdentifier(currentToken);
             return ident;
         }
-        case TokenType::Bang:
-        case TokenType::Minus: {
-            auto prefix = std::make_unique<PrefixExpression>();
-            prefix->op = currentToken.literal;
-            NextToken();
-            prefix->right = ParseExpression(PREFIX);
-            return prefix;
+        default:
+            AddError("No prefix parse function for " + std::string(currentToken.literal), currentToken);
+            return nullptr;
+    }
+}
+
+// Pratt parsing with the recursion turned into a loop over expressionFrames:
+// an operator that needs an operand opens a frame and the loop goes on with
+// the operand, a finished operand closes the innermost frame. Token for
+// token it steps exactly like the recursive formulation it replaced.
+Expression* Parser::ParseExpression(int precedence) {
+    using Frame = ExpressionFrame;
+    const size_t base = expressionFrames.size();
+    Expression* left = nullptr;
+    bool needOperand = true;
+
+    for (;;) {
+        if (needOperand) {
+            Frame::Kind kind;
+            Expression* node = nullptr;
+            switch (currentToken.type) {
+                case TokenType::Bang:
+                case TokenType::Minus: {
+                    auto prefix = Make<PrefixExpression>();
+                    prefix->op = currentToken.literal;
+                    kind = Frame::Prefix;
+                    node = prefix;
+                    break;
+                }
+                case TokenType::Asterisk:
+                    kind = Frame::Dereference;
+                    node = Make<DereferenceExpression>();
+                    break;
+                case TokenType::Ampersand:
+                    kind = Frame::AddressOf;
+                    node = Make<AddressOfExpression>();
+                    break;
+                case TokenType::LParen:
+                    kind = Frame::Group;
+                    break;
+                default:
+                    left = ParseOperand();
+                    needOperand = false;
+                    break;
+            }
+            if (needOperand) {
+                expressionFrames.push_back({kind, precedence, node, 0});
+                precedence = kind == Frame::Group ? LOWEST : PREFIX;
+                NextToken();
+                continue;
+            }
         }
-        case TokenType::Asterisk: {
-            auto deref = std::make_unique<DereferenceExpression>();
-            NextToken();
-            deref->operand = ParseExpression(PREFIX);
-            return deref;
+
+        if (peekToken.type != TokenType::Semicolon && precedence < GetPrecedence(peekToken.type)) {
+            if (peekToken.type == TokenType::LParen) {
+                auto call = Make<CallExpression>();
+                call->function = DynCast<Identifier>(left);
+                NextToken(); // currentToken now '('
+                NextToken(); // advance to first argument or ')'
+                if (currentToken.type != TokenType::RParen && currentToken.type != TokenType::Eof) {
+                    expressionFrames.push_back({Frame::Argument, precedence, call, arguments.size()});
+                    precedence = LOWEST;
+                    needOperand = true;
+                    continue;
+                }
+                NextToken(); // consume ')'
+                left = call;
+            } else {
+                NextToken(); // Consume the operator
+                auto infix = Make<InfixExpression>();
+                infix->left = left;
+                infix->op = currentToken.literal;
+                expressionFrames.push_back({Frame::Infix, precedence, infix, 0});
+                precedence = GetPrecedence(currentToken.type);
+                NextToken(); // Move to the right-hand side
+                needOperand = true;
+            }
+            continue;
         }
-        case TokenType::Ampersand: {
-            auto addrOf = std::make_unique<AddressOfExpression>();
-            NextToken();
-            addrOf->operand = ParseExpression(PREFIX);
-            return addrOf;
+
+        // left is complete; hand it to the expression waiting for it
+        if (expressionFrames.size() == base) {
+            return left;
         }
-        case TokenType::LParen: {
-            NextToken();
-            auto exp = ParseExpression(LOWEST);
-            if (!ExpectPeek(TokenType::RParen)) {
-                return nullptr;
+        const Frame frame = expressionFrames.back();
+        expressionFrames.pop_back();
+        precedence = frame.precedence;
+        switch (frame.kind) {
+            case Frame::Prefix:
+                static_cast<PrefixExpression*>(frame.node)->right = left;
+                left = frame.node;
+                break;
+            case Frame::Dereference:
+                static_cast<DereferenceExpression*>(frame.node)->operand = left;
+                left = frame.node;
+                break;
+            case Frame::AddressOf:
+                static_cast<AddressOfExpression*>(frame.node)->operand = left;
+                left = frame.node;
+                break;
+            case Frame::Group:
+                if (!ExpectPeek(TokenType::RParen)) {
+                    left = nullptr;
+                }
+                break;
+            case Frame::Infix:
+                static_cast<InfixExpression*>(frame.node)->right = left;
+                left = frame.node;
+                break;
+            case Frame::Argument: {
+                if (left) {
+                    arguments.push_back(left);
+                }
+                NextToken();
+                if (currentToken.type == TokenType::Comma) {
+                    NextToken();
+                }
+                if (currentToken.type != TokenType::RParen && currentToken.type != TokenType::Eof) {
+                    expressionFrames.push_back(frame);
+                    precedence = LOWEST;
+                    needOperand = true;
+                    break;
+                }
+                NextToken(); // consume ')'
+                auto call = static_cast<CallExpression*>(frame.node);
+                call->arguments = program->arena.CopyList(arguments.data() + frame.firstArgument,
+                                                          arguments.size() - frame.firstArgument);
+                arguments.resize(frame.firstArgument);
+                left = call;
+                break;
             }
-            return exp;
         }
-        default:
-            errorReporter.AddError("No prefix parse function for " + currentToken.literal, lexer.GetLine(), lexer.GetColumn());
-            return nullptr;
     }
 }
 
-std::unique_ptr<Expression> Parser::ParseExpression(int precedence) {
-    std::unique_ptr<Expression> leftExp = ParsePrefixExpression();
+// Helper methods
+void Parser::AddError(const std::string& message, const Token& token) {
+    const SourceLocation location = lexer.Locate(token.offset);
+    errorReporter.AddError(message, location.line, location.column);
+}
 
-    while (peekToken.type != TokenType::Semicolon && precedence < GetPrecedence(peekToken.type)) {
-        // If it's a call expression
-        if (peekToken.type == TokenType::LParen) {
-            // Don't consume '(', ParseCallExpression will do it
-            leftExp = ParseCallExpression(std::move(leftExp));
-        }
-        // If it's an infix expression
-        else if (GetPrecedence(peekToken.type) != LOWEST) { // Check if it's an infix operator
-            NextToken(); // Consume the operator
-            auto infix = std::make_unique<InfixExpression>();
-            infix->left = std::move(leftExp);
-            infix->op = currentToken.literal;
-            int currentPrecedence = GetPrecedence(currentToken.type);
-            NextToken(); // Consume the right-hand side of the infix expression
-            infix->right = ParseExpression(currentPrecedence);
-            leftExp = std::move(infix);
-        } else {
-            return leftExp; // Not an infix operator or call, so return
-        }
+Identifier* Parser::ParseType(const char* error) {
+    size_t pointers = 0;
+    while (currentToken.type == TokenType::Asterisk) {
+        pointers++;
+        NextToken();
+    }
+    if (currentToken.type != TokenType::Identifier) {
+        AddError(error, currentToken);
+        return nullptr;
+    }
+    Identifier* type = pointers == 0 ? MakeIdentifier(currentToken)
+                                     : MakeIdentifier(std::string(pointers, '*')
+                                                      + std::string(lexer.GetInterner().GetString(currentToken.symbol)));
+    NextToken(); // Consume the type name
+    return type;
+}
+
+Identifier* Parser::MakeIdentifier(const Token& token) {
+    auto ident = Make<Identifier>();
+    ident->symbol = token.symbol;
+    ident->value = lexer.GetInterner().GetString(token.symbol);
+    if (identifierLog) {
+        identifierLog->push_back(ident);
     }
+    return ident;
+}
 
-    return leftExp;
+Identifier* Parser::MakeIdentifier(const std::string_view name) {
+    auto ident = Make<Identifier>();
+    ident->symbol = lexer.GetInterner().Intern(name);
+    ident->value = lexer.GetInterner().GetString(ident->symbol);
+    if (identifierLog) {
+        identifierLog->push_back(ident);
+    }
+    return ident;
 }
 
-// Helper methods
 bool Parser::ExpectPeek(TokenType type) {
     if (PeekTokenIs(type)) {
         NextToken();
         return true;
     }
-    errorReporter.AddError("Expected " + TokenTypeToString(type) + ", got " + TokenTypeToString(peekToken.type), 0, 0);
+    AddError("Expected " + TokenTypeToString(type) + ", got " + TokenTypeToString(peekToken.type), peekToken);
     return false;
 }
 
@@ -465,8 +597,8 @@ Precedence Parser::GetPrecedence(TokenType type) const {
     return LOWEST;
 }
 
-std::unique_ptr<IfStatement> Parser::ParseIfStatement() {
-    auto ifStmt = std::make_unique<IfStatement>();
+IfStatement* Parser::ParseIfStatement() {
+    auto ifStmt = Make<IfStatement>();
 
     NextToken(); // Consume 'if'
 
@@ -508,8 +640,8 @@ std::unique_ptr<IfStatement> Parser::ParseIfStatement() {
     return ifStmt;
 }
 
-std::unique_ptr<WhileStatement> Parser::ParseWhileStatement() {
-    auto whileStmt = std::make_unique<WhileStatement>();
+WhileStatement* Parser::ParseWhileStatement() {
+    auto whileStmt = Make<WhileStatement>();
 
     NextToken(); // Consume 'while'
 
@@ -537,16 +669,15 @@ std::unique_ptr<WhileStatement> Parser::ParseWhileStatement() {
     return whileStmt;
 }
 
-std::unique_ptr<AssignmentStatement> Parser::ParseAssignmentStatement() {
-    auto assignStmt = std::make_unique<AssignmentStatement>();
+AssignmentStatement* Parser::ParseAssignmentStatement() {
+    auto assignStmt = Make<AssignmentStatement>();
 
     if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected identifier in assignment", 0, 0);
+        AddError("Expected identifier in assignment", currentToken);
         return nullptr;
     }
 
-    assignStmt->name = std::make_unique<Identifier>();
-    assignStmt->name->value = currentToken.literal;
+    assignStmt->name = MakeIdentifier(currentToken);
 
     if (!ExpectPeek(TokenType::Assign)) {
         return nullptr;
@@ -562,13 +693,13 @@ std::unique_ptr<AssignmentStatement> Parser::ParseAssignmentStatement() {
     return assignStmt;
 }
 
-std::unique_ptr<UnsafeStatement> Parser::ParseUnsafeStatement() {
-    auto unsafeStmt = std::make_unique<UnsafeStatement>();
+UnsafeStatement* Parser::ParseUnsafeStatement() {
+    auto unsafeStmt = Make<UnsafeStatement>();
 
     NextToken(); // Consume 'unsafe'
 
     if (currentToken.type != TokenType::LBrace) {
-        errorReporter.AddError("Expected '{' after 'unsafe'", 0, 0);
+        AddError("Expected '{' after 'unsafe'", currentToken);
         return nullptr;
     }
 
@@ -580,8 +711,8 @@ std::unique_ptr<UnsafeStatement> Parser::ParseUnsafeStatement() {
     return unsafeStmt;
 }
 
-std::unique_ptr<DereferenceAssignmentStatement> Parser::ParseDereferenceAssignmentStatement() {
-    auto derefAssign = std::make_unique<DereferenceAssignmentStatement>();
+DereferenceAssignmentStatement* Parser::ParseDereferenceAssignmentStatement() {
+    auto derefAssign = Make<DereferenceAssignmentStatement>();
 
     NextToken(); // Consume '*'
     derefAssign->pointer = ParseExpression(PREFIX);
@@ -600,13 +731,13 @@ std::unique_ptr<DereferenceAssignmentStatement> Parser::ParseDereferenceAssignme
     return derefAssign;
 }
 
-std::unique_ptr<InlineAssemblyStatement> Parser::ParseInlineAssemblyStatement() {
-    auto asmStmt = std::make_unique<InlineAssemblyStatement>();
+InlineAssemblyStatement* Parser::ParseInlineAssemblyStatement() {
+    auto asmStmt = Make<InlineAssemblyStatement>();
 
     NextToken(); // Consume 'asm'
 
     if (currentToken.type != TokenType::LBrace) {
-        errorReporter.AddError("Expected '{' after 'asm'", 0, 0);
+        AddError("Expected '{' after 'asm'", currentToken);
         return nullptr;
     }
 
@@ -637,80 +768,102 @@ std::unique_ptr<InlineAssemblyStatement> Parser::ParseInlineAssemblyStatement()
     }
 
     if (currentToken.type != TokenType::RBrace) {
-        errorReporter.AddError("Expected '}' to close asm block", 0, 0);
+        AddError("Expected '}' to close asm block", currentToken);
         return nullptr;
     }
 
-    asmStmt->assembly_code = assembly;
+    asmStmt->assembly_code = program->arena.CopyString(assembly);
     return asmStmt;
 }
 
-std::vector<std::unique_ptr<Attribute>> Parser::ParseAttributes() {
-    std::vector<std::unique_ptr<Attribute>> attributes;
+ImportDeclaration* Parser::ParseImportDeclaration() {
+    auto importDecl = Make<ImportDeclaration>();
+    const Token importToken = currentToken;
+
+    if (!ExpectPeek(TokenType::Identifier)) {
+        return nullptr;
+    }
+    importDecl->module = MakeIdentifier(currentToken);
+
+    if (PeekTokenIs(TokenType::Semicolon)) {
+        NextToken();
+    }
+
+    if (blockDepth > 0) {
+        AddError("Imports are only allowed at the top level", importToken);
+        return nullptr;
+    }
+    return importDecl;
+}
+
+std::vector<Attribute*> Parser::ParseAttributes() {
+    std::vector<Attribute*> attributes;
     
     while (currentToken.type == TokenType::Hash) {
         auto attr = ParseAttribute();
         if (attr) {
-            attributes.push_back(std::move(attr));
+            attributes.push_back(attr);
         }
     }
     
     return attributes;
 }
 
-std::unique_ptr<Attribute> Parser::ParseAttribute() {
-    auto attr = std::make_unique<Attribute>();
+Attribute* Parser::ParseAttribute() {
+    auto attr = Make<Attribute>();
     
     if (currentToken.type != TokenType::Hash) {
-        errorReporter.AddError("Expected '#' at start of attribute", 0, 0);
+        AddError("Expected '#' at start of attribute", currentToken);
         return nullptr;
     }
     
     NextToken(); // Consume '#'
     
     if (currentToken.type != TokenType::LBracket) {
-        errorReporter.AddError("Expected '[' after '#'", 0, 0);
+        AddError("Expected '[' after '#'", currentToken);
         return nullptr;
     }
     
     NextToken(); // Consume '['
     
     if (currentToken.type != TokenType::Identifier) {
-        errorReporter.AddError("Expected attribute name", 0, 0);
+        AddError("Expected attribute name", currentToken);
         return nullptr;
     }
     
-    attr->name = currentToken.literal;
+    attr->name = program->arena.CopyString(currentToken.literal);
     NextToken(); // Consume attribute name
     
     // Parse optional arguments
+    std::vector<std::string_view> arguments;
     if (currentToken.type == TokenType::LParen) {
         NextToken(); // Consume '('
         
         while (currentToken.type != TokenType::RParen && currentToken.type != TokenType::Eof) {
             if (currentToken.type == TokenType::Identifier || currentToken.type == TokenType::Integer) {
-                attr->arguments.push_back(currentToken.literal);
+                arguments.push_back(program->arena.CopyString(currentToken.literal));
                 NextToken();
                 
                 if (currentToken.type == TokenType::Comma) {
                     NextToken(); // Consume ','
                 }
             } else {
-                errorReporter.AddError("Expected argument in attribute", 0, 0);
+                AddError("Expected argument in attribute", currentToken);
                 return nullptr;
             }
         }
         
         if (currentToken.type != TokenType::RParen) {
-            errorReporter.AddError("Expected ')' after attribute arguments", 0, 0);
+            AddError("Expected ')' after attribute arguments", currentToken);
             return nullptr;
         }
         
         NextToken(); // Consume ')'
     }
+    attr->arguments = program->arena.CopyList(arguments);
     
     if (currentToken.type != TokenType::RBracket) {
-        errorReporter.AddError("Expected ']' to close attribute", 0, 0);
+        AddError("Expected ']' to close attribute", currentToken);
         return nullptr;
     }
     
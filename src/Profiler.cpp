@@ -0,0 +1,150 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <fmt/format.h>
+#include <mutex>
+
+namespace profile {
+
+    namespace {
+        struct Event {
+            std::string name;
+            const char* category;
+            uint32_t thread;
+            int64_t wallStart;
+            int64_t wallDuration;
+            int64_t cpuDuration;
+        };
+
+        std::atomic<bool> g_enabled{false};
+        std::mutex g_eventsMutex;
+        std::vector<Event> g_events;
+        std::atomic<uint32_t> g_nextThread{0};
+
+        int64_t Now(const clockid_t clock) {
+            timespec ts{};
+            ::clock_gettime(clock, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        uint32_t ThreadIndex() {
+            thread_local const uint32_t index = g_nextThread.fetch_add(1, std::memory_order_relaxed);
+            return index;
+        }
+
+        void AppendJsonString(std::string& out, const std::string_view text) {
+            out.push_back('"');
+            for (const char c : text) {
+                if (c == '"' || c == '\\') {
+                    out.push_back('\\');
+                    out.push_back(c);
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    out += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+                } else {
+                    out.push_back(c);
+                }
+            }
+            out.push_back('"');
+        }
+    }
+
+    void Enable() {
+        g_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    bool IsEnabled() {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    // CPU time is the calling thread's, so spans on worker threads add up to
+    // the work done rather than to the time the process was busy
+    Scope::Scope(const char* category, const std::string_view name)
+        : active(IsEnabled()), category(category), name(name) {
+        if (active) {
+            wallStart = Now(CLOCK_MONOTONIC);
+            cpuStart = Now(CLOCK_THREAD_CPUTIME_ID);
+        }
+    }
+
+    Scope::~Scope() {
+        if (!active) {
+            return;
+        }
+        const int64_t cpuEnd = Now(CLOCK_THREAD_CPUTIME_ID);
+        const int64_t wallEnd = Now(CLOCK_MONOTONIC);
+        Event event{std::string(name), category, ThreadIndex(), wallStart, wallEnd - wallStart, cpuEnd - cpuStart};
+        std::lock_guard<std::mutex> lock(g_eventsMutex);
+        g_events.push_back(std::move(event));
+    }
+
+    std::vector<Total> Totals() {
+        std::vector<Total> totals;
+        std::lock_guard<std::mutex> lock(g_eventsMutex);
+        for (const auto& event : g_events) {
+            // Per-function spans are summed into one row
+            const std::string_view name = std::string_view(event.category) == FUNCTION
+                                              ? std::string_view("codegen (functions)")
+                                              : std::string_view(event.name);
+            auto it = totals.begin();
+            while (it != totals.end() && it->name != name) {
+                ++it;
+            }
+            if (it == totals.end()) {
+                it = totals.insert(it, {std::string(name), event.category});
+            }
+            it->count++;
+            it->wallMilliseconds += static_cast<double>(event.wallDuration) / 1e6;
+            it->cpuMilliseconds += static_cast<double>(event.cpuDuration) / 1e6;
+        }
+        return totals;
+    }
+
+    void PrintReport() {
+        fmt::print(stderr, "{:<22} {:>8} {:>12} {:>12}\n", "phase", "count", "wall (ms)", "cpu (ms)");
+        for (const auto& total : Totals()) {
+            fmt::print(stderr, "{:<22} {:>8} {:>12.3f} {:>12.3f}\n", total.name, total.count,
+                       total.wallMilliseconds, total.cpuMilliseconds);
+        }
+    }
+
+    bool WriteTrace(const std::string& path) {
+        std::string json = "{\"traceEvents\":[";
+        {
+            std::lock_guard<std::mutex> lock(g_eventsMutex);
+            int64_t first = g_events.empty() ? 0 : g_events.front().wallStart;
+            for (const auto& event : g_events) {
+                first = std::min(first, event.wallStart);
+            }
+            bool separator = false;
+            for (const auto& event : g_events) {
+                if (separator) {
+                    json.push_back(',');
+                }
+                separator = true;
+                json += "\n{\"name\":";
+                AppendJsonString(json, event.name);
+                json += fmt::format(",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                    event.category, event.thread,
+                                    static_cast<double>(event.wallStart - first) / 1e3,
+                                    static_cast<double>(event.wallDuration) / 1e3);
+            }
+        }
+        json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    void Reset() {
+        std::lock_guard<std::mutex> lock(g_eventsMutex);
+        g_events.clear();
+        g_events.shrink_to_fit();
+    }
+
+} // namespace profile
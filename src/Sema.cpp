@@ -0,0 +1,367 @@
+#include "Sema.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr const char* FLOAT_IN_FUNCTION = "Floating-point values are not supported in functions yet";
+
+    // Integer literals are i32 when they fit and i64 otherwise
+    Type LiteralType(const int64_t value) {
+        return Type(value >= INT32_MIN && value <= INT32_MAX ? BaseType::I32 : BaseType::I64);
+    }
+
+    // Implicit conversions: integers convert to each other, integers become
+    // pointers and pointers 64-bit integers
+    bool Convertible(const Type from, const Type to) {
+        if (from == to) {
+            return true;
+        }
+        if (to.IsInteger()) {
+            return from.IsInteger() || (from.IsPointer() && to.Size() == 8);
+        }
+        return to.IsPointer() && from.IsInteger();
+    }
+
+    Operator InfixOperatorOf(const std::string_view op) {
+        if (op == "+") return Operator::Add;
+        if (op == "-") return Operator::Sub;
+        if (op == "*") return Operator::Mul;
+        if (op == "/") return Operator::Div;
+        if (op == "==") return Operator::Eq;
+        if (op == "!=") return Operator::Ne;
+        if (op == "<") return Operator::Lt;
+        if (op == ">") return Operator::Gt;
+        if (op == "<=") return Operator::Le;
+        if (op == ">=") return Operator::Ge;
+        throw std::runtime_error("Unknown infix operator: " + std::string(op));
+    }
+
+    [[noreturn]] void InvalidOperands(const std::string_view op, const Type left, const Type right) {
+        throw std::runtime_error("Invalid operands to " + std::string(op) + ": " + TypeName(left) + " and "
+                                 + TypeName(right));
+    }
+
+    // The type a type annotation names
+    Type TypeOf(const Identifier& annotation) {
+        const Type type = ParseTypeName(annotation.value);
+        if (type.base == BaseType::None) {
+            throw std::runtime_error("Unknown type: " + std::string(annotation.value));
+        }
+        annotation.type = type;
+        return type;
+    }
+}
+
+Sema::Sema(const StringInterner& interner) : interner(interner), symbolTable(interner) {}
+
+Sema::Function& Sema::FunctionAt(const Symbol name) {
+    if (functions.size() <= name) {
+        functions.resize(name + 1);
+    }
+    return functions[name];
+}
+
+void Sema::Import(const ModuleInterface& module) {
+    // Names the program never spells are not interned and cannot be used
+    for (const auto& function : module.functions) {
+        const Symbol name = interner.Find(function.name);
+        if (name == INVALID_SYMBOL) {
+            continue;
+        }
+        Function& imported = FunctionAt(name);
+        if (imported.imported) {
+            throw std::runtime_error("Function imported from more than one module: " + std::string(function.name));
+        }
+        imported.imported = true;
+        imported.returnType = function.returnType;
+        imported.parameterTypes = function.parameterTypes;
+    }
+    for (const auto& variable : module.variables) {
+        const Symbol name = interner.Find(variable.name);
+        if (name != INVALID_SYMBOL) {
+            symbolTable.DefineGlobal(name, variable.type, variable.isConst);
+        }
+    }
+}
+
+void Sema::Check(const Program& program) {
+    for (const auto* stmt : program.statements) {
+        if (const auto* varDecl = DynCast<VariableDeclaration>(stmt)) {
+            DeclareGlobal(*varDecl);
+        } else if (const auto* funcDecl = DynCast<FunctionDeclaration>(stmt)) {
+            DeclareFunction(*funcDecl);
+        }
+    }
+
+    for (const auto* stmt : program.statements) {
+        if (Is<FunctionDeclaration>(stmt)) {
+            Visit(*stmt);
+        }
+    }
+}
+
+size_t Sema::GetFunctionCount() const {
+    return static_cast<size_t>(std::count_if(functions.begin(), functions.end(),
+                                             [](const Function& function) { return function.defined; }));
+}
+
+// Globals are initialized in the data section, so only literals give them a
+// value and only literals are checked
+void Sema::DeclareGlobal(const VariableDeclaration& varDecl) {
+    Type type(BaseType::I32);
+    if (varDecl.type) {
+        type = TypeOf(*varDecl.type);
+    } else if (const auto* intLit = DynCast<IntegerLiteral>(varDecl.value)) {
+        type = LiteralType(intLit->value);
+    } else if (Is<FloatLiteral>(varDecl.value)) {
+        type = Type(BaseType::F64);
+    }
+    if (Is<FloatLiteral>(varDecl.value) && !type.IsFloat()) {
+        throw std::runtime_error("Cannot convert f64 to " + TypeName(type) + " in initialization of "
+                                 + std::string(varDecl.name->value));
+    }
+    symbolTable.DefineGlobal(varDecl.name->symbol, type, varDecl.isConst);
+    varDecl.name->storage = StorageKind::Global;
+    varDecl.name->type = type;
+}
+
+void Sema::DeclareFunction(const FunctionDeclaration& funcDecl) {
+    Function& function = FunctionAt(funcDecl.name->symbol);
+    if (function.imported) {
+        throw std::runtime_error("Redefinition of imported function: " + std::string(funcDecl.name->value));
+    }
+    if (function.defined) {
+        throw std::runtime_error("Redefinition of function: " + std::string(funcDecl.name->value));
+    }
+    function.defined = true;
+    function.returnType = TypeOf(*funcDecl.returnType);
+    function.parameterTypes.clear();
+    for (const auto* type : funcDecl.parameterTypes) {
+        function.parameterTypes.push_back(TypeOf(*type));
+    }
+    if (function.returnType.IsFloat()
+        || std::any_of(function.parameterTypes.begin(), function.parameterTypes.end(),
+                       [](const Type type) { return type.IsFloat(); })) {
+        throw std::runtime_error(std::string(FLOAT_IN_FUNCTION) + ": " + std::string(funcDecl.name->value));
+    }
+}
+
+const SymbolTable::Entry& Sema::Bind(const Identifier& ident) const {
+    // Globals win over locals of the same name, as they always have
+    const bool isGlobal = symbolTable.IsGlobal(ident.symbol);
+    const SymbolTable::Entry& entry = isGlobal ? symbolTable.GetGlobal(ident.symbol) : symbolTable.Get(ident.symbol);
+    if (entry.type.IsFloat()) {
+        throw std::runtime_error(std::string(FLOAT_IN_FUNCTION) + ": " + std::string(ident.value));
+    }
+    ident.storage = isGlobal ? StorageKind::Global : StorageKind::Frame;
+    ident.offset = entry.offset;
+    ident.type = entry.type;
+    return entry;
+}
+
+void Sema::CheckConversion(const Expression& value, const Type to, const std::string_view context,
+                           const std::string_view name) const {
+    if (!Convertible(value.type, to)) {
+        throw std::runtime_error("Cannot convert " + TypeName(value.type) + " to " + TypeName(to) + " "
+                                 + std::string(context) + std::string(name));
+    }
+}
+
+void Sema::VisitVariableDeclaration(const VariableDeclaration& varDecl) {
+    // The name comes into scope after its initializer, whose type it may take
+    CheckExpression(*varDecl.value);
+    Type type = varDecl.value->type;
+    if (varDecl.type) {
+        type = TypeOf(*varDecl.type);
+        if (type.IsFloat()) {
+            throw std::runtime_error(std::string(FLOAT_IN_FUNCTION) + ": " + std::string(varDecl.name->value));
+        }
+        CheckConversion(*varDecl.value, type, "in initialization of ", varDecl.name->value);
+    }
+    symbolTable.Define(varDecl.name->symbol, type, varDecl.isConst);
+    varDecl.name->offset = symbolTable.Get(varDecl.name->symbol).offset;
+    varDecl.name->storage = StorageKind::Frame;
+    varDecl.name->type = type;
+}
+
+void Sema::VisitReturnStatement(const ReturnStatement& returnStmt) {
+    CheckExpression(*returnStmt.returnValue);
+    CheckConversion(*returnStmt.returnValue, current->returnType->type, "in return from ", current->name->value);
+}
+
+void Sema::VisitBlockStatement(const BlockStatement& block) {
+    for (const auto* stmt : block.statements) {
+        Visit(*stmt);
+    }
+}
+
+void Sema::VisitFunctionDeclaration(const FunctionDeclaration& funcDecl) {
+    current = &funcDecl;
+    symbolTable.EnterScope();
+
+    int paramOffset = 16; // rbp + 8 is return address, rbp + 16 is first argument
+    for (size_t i = 0; i < funcDecl.parameters.size(); ++i) {
+        const Identifier& param = *funcDecl.parameters[i];
+        symbolTable.DefineParameter(param.symbol, paramOffset, funcDecl.parameterTypes[i]->type);
+        param.offset = paramOffset;
+        param.storage = StorageKind::Frame;
+        param.type = funcDecl.parameterTypes[i]->type;
+        paramOffset += 8;
+    }
+
+    for (const auto* stmt : funcDecl.body->statements) {
+        Visit(*stmt);
+        if (Is<ReturnStatement>(stmt)) {
+            break; // Nothing after a top-level return is generated
+        }
+    }
+
+    funcDecl.frameSize = symbolTable.GetFrameSize();
+    symbolTable.LeaveScope();
+    current = nullptr;
+}
+
+void Sema::VisitExpressionStatement(const ExpressionStatement& exprStmt) {
+    CheckExpression(*exprStmt.expression);
+}
+
+void Sema::VisitIfStatement(const IfStatement& ifStmt) {
+    CheckExpression(*ifStmt.condition);
+    Visit(*ifStmt.consequence);
+    if (ifStmt.alternative) {
+        Visit(*ifStmt.alternative);
+    }
+}
+
+void Sema::VisitWhileStatement(const WhileStatement& whileStmt) {
+    CheckExpression(*whileStmt.condition);
+    Visit(*whileStmt.body);
+}
+
+void Sema::VisitAssignmentStatement(const AssignmentStatement& assignStmt) {
+    CheckExpression(*assignStmt.value);
+    if (Bind(*assignStmt.name).isConst) {
+        throw std::runtime_error("Cannot assign to constant: " + std::string(assignStmt.name->value));
+    }
+    CheckConversion(*assignStmt.value, assignStmt.name->type, "in assignment to ", assignStmt.name->value);
+}
+
+void Sema::VisitUnsafeStatement(const UnsafeStatement& unsafeStmt) {
+    Visit(*unsafeStmt.body);
+}
+
+void Sema::VisitDereferenceAssignmentStatement(const DereferenceAssignmentStatement& derefAssign) {
+    CheckExpression(*derefAssign.value);
+    CheckExpression(*derefAssign.pointer);
+    CheckConversion(*derefAssign.value, PointeeOf(derefAssign.pointer->type), "in store through pointer", {});
+}
+
+// Visits operands in the order CodeGenerator evaluates them, so the first
+// error reported is the one a recursive walk would have hit. Each node is
+// typed once its operands are.
+const Expression* Sema::ResumeExpression(const Expression& expression, const uint32_t step) {
+    switch (expression.kind) {
+        case NodeKind::Identifier:
+            Bind(static_cast<const Identifier&>(expression));
+            return nullptr;
+        case NodeKind::IntegerLiteral:
+            expression.type = LiteralType(static_cast<const IntegerLiteral&>(expression).value);
+            return nullptr;
+        case NodeKind::FloatLiteral:
+            throw std::runtime_error(FLOAT_IN_FUNCTION);
+        case NodeKind::InfixExpression: {
+            const auto& infix = static_cast<const InfixExpression&>(expression);
+            if (step < 2) {
+                return step == 0 ? infix.left : infix.right;
+            }
+            CheckInfix(infix);
+            return nullptr;
+        }
+        case NodeKind::CallExpression: {
+            const auto& call = static_cast<const CallExpression&>(expression);
+            if (step < call.arguments.size()) {
+                return call.arguments[call.arguments.size() - 1 - step];
+            }
+            CheckCall(call);
+            return nullptr;
+        }
+        case NodeKind::PrefixExpression: {
+            const auto& prefix = static_cast<const PrefixExpression&>(expression);
+            if (step == 0) {
+                return prefix.right;
+            }
+            CheckPrefix(prefix);
+            return nullptr;
+        }
+        case NodeKind::DereferenceExpression: {
+            const auto& deref = static_cast<const DereferenceExpression&>(expression);
+            if (step == 0) {
+                return deref.operand;
+            }
+            deref.type = PointeeOf(deref.operand->type);
+            return nullptr;
+        }
+        case NodeKind::AddressOfExpression: {
+            const auto& addrOf = static_cast<const AddressOfExpression&>(expression);
+            if (step == 0) {
+                if (!Is<Identifier>(addrOf.operand)) {
+                    throw std::runtime_error("Address-of only supported for identifiers");
+                }
+                return addrOf.operand;
+            }
+            addrOf.type = addrOf.operand->type.PointerTo();
+            return nullptr;
+        }
+        default:
+            return nullptr;
+    }
+}
+
+void Sema::CheckInfix(const InfixExpression& infix) const {
+    const Type left = infix.left->type;
+    const Type right = infix.right->type;
+    infix.operation = InfixOperatorOf(infix.op);
+    if (left.IsInteger() && right.IsInteger()) {
+        infix.operandType = CommonType(left, right);
+    } else if (infix.operation >= Operator::Eq && left.IsPointer() && left == right) {
+        infix.operandType = left; // Pointers of one type compare
+    } else {
+        InvalidOperands(infix.op, left, right);
+    }
+    infix.type = infix.operation >= Operator::Eq ? Type(BaseType::I32) : infix.operandType;
+}
+
+void Sema::CheckPrefix(const PrefixExpression& prefix) const {
+    const Type operand = prefix.right->type;
+    if (prefix.op == "-" && operand.IsInteger()) {
+        prefix.operation = Operator::Neg;
+        prefix.type = Promote(operand);
+    } else if (prefix.op == "!") {
+        prefix.operation = Operator::Not;
+        prefix.type = Type(BaseType::I32);
+    } else {
+        throw std::runtime_error("Invalid operand to " + std::string(prefix.op) + ": " + TypeName(operand));
+    }
+}
+
+void Sema::CheckCall(const CallExpression& call) const {
+    const Symbol name = call.function->symbol;
+    if (name >= functions.size() || !(functions[name].defined || functions[name].imported)) {
+        throw std::runtime_error("Undefined function: " + std::string(interner.GetString(name)));
+    }
+    const Function& function = functions[name];
+    if (call.arguments.size() != function.parameterTypes.size()) {
+        throw std::runtime_error("Function " + std::string(call.function->value) + " takes "
+                                 + std::to_string(function.parameterTypes.size())
+                                 + (function.parameterTypes.size() == 1 ? " argument, not " : " arguments, not ")
+                                 + std::to_string(call.arguments.size()));
+    }
+    for (size_t i = 0; i < call.arguments.size(); ++i) {
+        if (!Convertible(call.arguments[i]->type, function.parameterTypes[i])) {
+            CheckConversion(*call.arguments[i], function.parameterTypes[i],
+                            "for argument " + std::to_string(i + 1) + " of ", call.function->value);
+        }
+    }
+    call.type = function.returnType;
+}
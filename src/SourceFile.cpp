@@ -0,0 +1,78 @@
+#include "SourceFile.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+SourceFile::~SourceFile() {
+    Close();
+}
+
+SourceFile::SourceFile(SourceFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+SourceFile& SourceFile::operator=(SourceFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        mapping = std::exchange(other.mapping, nullptr);
+        mappingSize = std::exchange(other.mappingSize, 0);
+        buffer = std::move(other.buffer);
+        // A view into a small buffer does not survive the move, so rebuild it
+        contents = mapping ? other.contents : std::string_view(buffer);
+        other.contents = {};
+    }
+    return *this;
+}
+
+bool SourceFile::Open(const std::string& path) {
+    Close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            ::close(fd);
+            mapping = addr;
+            mappingSize = static_cast<size_t>(st.st_size);
+            contents = std::string_view(static_cast<const char*>(mapping), mappingSize);
+            return true;
+        }
+    }
+
+    // Fall back to reading the whole stream
+    char chunk[65536];
+    ssize_t n;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            buffer.clear();
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    contents = buffer;
+    return true;
+}
+
+void SourceFile::Close() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    buffer.clear();
+    contents = {};
+}
@@ -0,0 +1,19 @@
+#include "StringInterner.h"
+
+Symbol StringInterner::Intern(const std::string_view text) {
+    if (const auto it = symbols.find(text); it != symbols.end()) {
+        return it->second;
+    }
+    const std::string_view stored = storage.CopyString(text);
+    const auto symbol = static_cast<Symbol>(strings.size());
+    strings.push_back(stored);
+    symbols.emplace(stored, symbol);
+    return symbol;
+}
+
+Symbol StringInterner::Find(const std::string_view text) const {
+    if (const auto it = symbols.find(text); it != symbols.end()) {
+        return it->second;
+    }
+    return INVALID_SYMBOL;
+}
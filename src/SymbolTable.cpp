@@ -1,44 +1,55 @@
 #include "SymbolTable.h"
+#include <algorithm>
 #include <stdexcept>
+#include <string>
 
-SymbolTable::SymbolTable() {
+SymbolTable::SymbolTable(const StringInterner& interner) : interner(interner) {
     scopes.emplace_back(); // Global scope
 }
 
-void SymbolTable::Define(const std::string& name) {
-    if (scopes.back().count(name)) {
-        throw std::runtime_error("Redefinition of variable: " + name);
+void SymbolTable::Define(const Symbol name, const Type type, const bool isConst) {
+    if (!scopes.back().emplace(name, Entry{nextOffset, type, isConst}).second) {
+        throw std::runtime_error("Redefinition of variable: " + std::string(interner.GetString(name)));
     }
-    scopes.back()[name] = nextOffset;
     nextOffset -= 8;
+    CountLocal();
 }
 
-void SymbolTable::DefineGlobal(const std::string& name) {
-    if (scopes[0].count(name)) {
-        throw std::runtime_error("Redefinition of global variable: " + name);
+void SymbolTable::DefineGlobal(const Symbol name, const Type type, const bool isConst) {
+    // Global variables use direct addressing
+    if (!scopes[0].emplace(name, Entry{0, type, isConst}).second) {
+        throw std::runtime_error("Redefinition of global variable: " + std::string(interner.GetString(name)));
+    }
+    if (globals.size() <= name) {
+        globals.resize(name + 1);
     }
-    scopes[0][name] = 0; // Global variables use direct addressing
     globals[name] = true;
 }
 
-void SymbolTable::DefineParameter(const std::string& name, int offset) {
-    if (scopes.back().count(name)) {
-        throw std::runtime_error("Redefinition of parameter: " + name);
+void SymbolTable::DefineParameter(const Symbol name, const int offset, const Type type) {
+    if (!scopes.back().emplace(name, Entry{offset, type, false}).second) {
+        throw std::runtime_error("Redefinition of parameter: " + std::string(interner.GetString(name)));
+    }
+    CountLocal();
+}
+
+void SymbolTable::CountLocal() {
+    if (scopes.size() > 1) {
+        peakLocalCount = std::max(peakLocalCount, ++localCount);
     }
-    scopes.back()[name] = offset;
 }
 
-int SymbolTable::Get(const std::string& name) {
+const SymbolTable::Entry& SymbolTable::Get(const Symbol name) const {
     for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        if (it->count(name)) {
-            return (*it)[name];
+        if (const auto found = it->find(name); found != it->end()) {
+            return found->second;
         }
     }
-    throw std::runtime_error("Undefined variable: " + name);
+    throw std::runtime_error("Undefined variable: " + std::string(interner.GetString(name)));
 }
 
-bool SymbolTable::IsGlobal(const std::string& name) {
-    return globals.count(name) > 0;
+bool SymbolTable::IsGlobal(const Symbol name) const {
+    return name < globals.size() && globals[name];
 }
 
 void SymbolTable::EnterScope() {
@@ -52,6 +63,7 @@ void SymbolTable::LeaveScope() {
     if (scopes.size() <= 1) {
         throw std::runtime_error("Cannot leave global scope");
     }
+    localCount -= scopes.back().size();
     scopes.pop_back();
     // Restore nextOffset from previous scope, or manage it relative to current frame
     // For now, a simple reset. This will need more thought for function calls.
@@ -0,0 +1,100 @@
+#include "Type.h"
+
+namespace {
+    struct NamedType {
+        std::string_view name;
+        BaseType base;
+    };
+
+    constexpr NamedType TYPE_NAMES[] = {
+        {"i8", BaseType::I8}, {"i16", BaseType::I16}, {"i32", BaseType::I32}, {"i64", BaseType::I64},
+        {"u8", BaseType::U8}, {"u16", BaseType::U16}, {"u32", BaseType::U32}, {"u64", BaseType::U64},
+        {"f32", BaseType::F32}, {"f64", BaseType::F64},
+    };
+}
+
+uint8_t Type::Size() const {
+    if (pointers > 0) {
+        return 8;
+    }
+    switch (base) {
+        case BaseType::I8:
+        case BaseType::U8:
+            return 1;
+        case BaseType::I16:
+        case BaseType::U16:
+            return 2;
+        case BaseType::I32:
+        case BaseType::U32:
+        case BaseType::F32:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+Type ParseTypeName(std::string_view name) {
+    uint8_t pointers = 0;
+    while (!name.empty() && name.front() == '*') {
+        pointers++;
+        name.remove_prefix(1);
+    }
+    for (const auto& [spelling, base] : TYPE_NAMES) {
+        if (name == spelling) {
+            return {base, pointers};
+        }
+    }
+    return {};
+}
+
+std::string TypeName(const Type type) {
+    std::string name(type.pointers, '*');
+    for (const auto& [spelling, base] : TYPE_NAMES) {
+        if (type.base == base) {
+            return name + std::string(spelling);
+        }
+    }
+    return name + "?";
+}
+
+Type Promote(const Type type) {
+    return type.IsInteger() && type.Size() < 4 ? Type(BaseType::I32) : type;
+}
+
+Type CommonType(Type left, Type right) {
+    left = Promote(left);
+    right = Promote(right);
+    if (left.Size() != right.Size()) {
+        return left.Size() > right.Size() ? left : right;
+    }
+    return left.IsUnsigned() ? left : right;
+}
+
+bool Includes(const Type to, const Type from) {
+    if (to.Size() == 8 || to == from) {
+        return true;
+    }
+    if (from.IsUnsigned()) {
+        return to.IsUnsigned() ? from.Size() <= to.Size() : from.Size() < to.Size();
+    }
+    return !to.IsUnsigned() && from.Size() <= to.Size();
+}
+
+Type PointeeOf(const Type address) {
+    return address.IsPointer() ? address.Pointee() : Type(BaseType::I64);
+}
+
+int64_t Truncate(const int64_t value, const Type type) {
+    if (type.pointers > 0) {
+        return value;
+    }
+    switch (type.base) {
+        case BaseType::I8: return static_cast<int8_t>(value);
+        case BaseType::I16: return static_cast<int16_t>(value);
+        case BaseType::I32: return static_cast<int32_t>(value);
+        case BaseType::U8: return static_cast<uint8_t>(value);
+        case BaseType::U16: return static_cast<uint16_t>(value);
+        case BaseType::U32: return static_cast<uint32_t>(value);
+        default: return value;
+    }
+}
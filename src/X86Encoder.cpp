@@ -0,0 +1,704 @@
+#include "X86Encoder.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include "NasmPrinter.h"
+
+namespace x86 {
+
+    namespace {
+        bool FitsInt8(const int64_t value) {
+            return value >= INT8_MIN && value <= INT8_MAX;
+        }
+
+        bool FitsInt32(const int64_t value) {
+            return value >= INT32_MIN && value <= INT32_MAX;
+        }
+
+        int Code(const Reg reg) {
+            return static_cast<int>(reg);
+        }
+
+        bool IsMemory(const Operand& operand) {
+            return operand.kind == Operand::Kind::Mem || operand.kind == Operand::Kind::Global;
+        }
+
+        bool IsReg(const Operand& operand) {
+            return operand.kind == Operand::Kind::Reg;
+        }
+
+        bool IsRm(const Operand& operand) {
+            return IsReg(operand) || IsMemory(operand);
+        }
+
+        // Register names the inline-assembly parser accepts
+        bool LookupRegister(const std::string_view name, Reg& reg, uint8_t& size) {
+            for (int i = 0; i < 16; ++i) {
+                for (const uint8_t candidate : {8, 4, 1}) {
+                    if (name == nasm::RegisterName(static_cast<Reg>(i), candidate)) {
+                        reg = static_cast<Reg>(i);
+                        size = candidate;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        bool LookupCondition(const std::string_view name, Cond& cond) {
+            for (const Cond candidate : {Cond::Z, Cond::NZ}) {
+                if (name == nasm::ConditionName(candidate)) {
+                    cond = candidate;
+                    return true;
+                }
+            }
+            for (int i = 0; i < 16; ++i) {
+                if (name == nasm::ConditionName(static_cast<Cond>(i))) {
+                    cond = static_cast<Cond>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::string_view Trim(std::string_view text) {
+            while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+            while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+            return text;
+        }
+
+        bool ParseInteger(std::string_view text, int64_t& value) {
+            text = Trim(text);
+            bool negative = false;
+            if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+                negative = text.front() == '-';
+                text = Trim(text.substr(1));
+            }
+            int base = 10;
+            if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+                text.remove_prefix(2);
+                base = 16;
+            }
+            uint64_t magnitude = 0;
+            const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), magnitude, base);
+            if (text.empty() || ec != std::errc() || ptr != text.data() + text.size()) {
+                return false;
+            }
+            value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+            return true;
+        }
+
+        bool IsSymbolName(const std::string_view text) {
+            if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_' || text[0] == '.')) {
+                return false;
+            }
+            for (const char c : text) {
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // One operand of an inline-assembly line: register, immediate,
+        // [reg], [reg+disp], [reg-disp], [symbol] or a bare symbol
+        bool ParseOperand(std::string_view text, Operand& operand) {
+            text = Trim(text);
+            uint8_t size = 0;
+            for (const auto& [keyword, bytes] : {std::pair<std::string_view, uint8_t>{"byte", 1}, {"dword", 4}, {"qword", 8}}) {
+                if (text.size() > keyword.size() && text.substr(0, keyword.size()) == keyword
+                    && (text[keyword.size()] == ' ' || text[keyword.size()] == '[')) {
+                    size = bytes;
+                    text = Trim(text.substr(keyword.size()));
+                    break;
+                }
+            }
+
+            Reg reg;
+            uint8_t regSize;
+            if (!text.empty() && text.front() == '[') {
+                if (text.back() != ']') {
+                    return false;
+                }
+                std::string_view inside = Trim(text.substr(1, text.size() - 2));
+                if (inside.substr(0, 4) == "rel ") {
+                    inside = Trim(inside.substr(4));
+                }
+                const size_t sign = inside.find_first_of("+-");
+                const std::string_view base = Trim(inside.substr(0, sign));
+                int64_t displacement = 0;
+                if (sign != std::string_view::npos && !ParseInteger(inside.substr(sign), displacement)) {
+                    return false;
+                }
+                if (LookupRegister(base, reg, regSize) && regSize == 8 && FitsInt32(displacement)) {
+                    operand = Operand::Memory(reg, static_cast<int32_t>(displacement), size);
+                } else if (sign == std::string_view::npos && IsSymbolName(base)) {
+                    operand = Operand::Global(base, size);
+                } else {
+                    return false;
+                }
+                // 0 marks "no size given" until the other operand decides it
+                operand.size = size;
+                return true;
+            }
+            if (size != 0) {
+                return false;
+            }
+            if (LookupRegister(text, reg, regSize)) {
+                operand = Operand::Register(reg, regSize);
+                return true;
+            }
+            int64_t value;
+            if (ParseInteger(text, value)) {
+                operand = Operand::Immediate(value);
+                return true;
+            }
+            if (IsSymbolName(text)) {
+                operand = Operand::Symbol(text);
+                return true;
+            }
+            return false;
+        }
+
+        // Instructions without operands that have no Opcode of their own
+        struct FixedEncoding {
+            std::string_view mnemonic;
+            const char* bytes;
+        };
+
+        constexpr FixedEncoding FIXED_ENCODINGS[] = {
+            {"rdtsc", "\x0F\x31"}, {"rdtscp", "\x0F\x01\xF9"}, {"cpuid", "\x0F\xA2"},
+            {"hlt", "\xF4"}, {"pause", "\xF3\x90"}, {"int3", "\xCC"}, {"ud2", "\x0F\x0B"},
+            {"cli", "\xFA"}, {"sti", "\xFB"}, {"cld", "\xFC"}, {"std", "\xFD"},
+            {"mfence", "\x0F\xAE\xF0"}, {"lfence", "\x0F\xAE\xE8"}, {"sfence", "\x0F\xAE\xF8"},
+            {"cdq", "\x99"}, {"cqo", "\x48\x99"},
+        };
+
+        struct Mnemonic {
+            std::string_view name;
+            Opcode op;
+        };
+
+        constexpr Mnemonic MNEMONICS[] = {
+            {"mov", Opcode::Mov}, {"movzx", Opcode::Movzx}, {"movsx", Opcode::Movsx}, {"movsxd", Opcode::Movsx},
+            {"lea", Opcode::Lea},
+            {"push", Opcode::Push}, {"pop", Opcode::Pop},
+            {"add", Opcode::Add}, {"or", Opcode::Or}, {"and", Opcode::And}, {"sub", Opcode::Sub},
+            {"xor", Opcode::Xor}, {"cmp", Opcode::Cmp}, {"test", Opcode::Test}, {"imul", Opcode::Imul},
+            {"neg", Opcode::Neg}, {"not", Opcode::Not}, {"idiv", Opcode::Idiv}, {"div", Opcode::Div},
+            {"jmp", Opcode::Jmp}, {"call", Opcode::Call},
+            {"leave", Opcode::Leave}, {"ret", Opcode::Ret}, {"syscall", Opcode::Syscall}, {"nop", Opcode::Nop},
+        };
+
+        bool ParseInstruction(const std::string_view line, Instruction& instruction) {
+            const std::string_view text = Trim(line);
+            const size_t space = text.find(' ');
+            const std::string_view mnemonic = text.substr(0, space);
+            const std::string_view operands = space == std::string_view::npos ? std::string_view() : Trim(text.substr(space));
+
+            instruction = {};
+            bool found = false;
+            for (const auto& [name, op] : MNEMONICS) {
+                if (mnemonic == name) {
+                    instruction.op = op;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                if (mnemonic.size() > 3 && mnemonic.substr(0, 3) == "set" && LookupCondition(mnemonic.substr(3), instruction.cond)) {
+                    instruction.op = Opcode::Set;
+                } else if (mnemonic.size() > 1 && mnemonic[0] == 'j' && LookupCondition(mnemonic.substr(1), instruction.cond)) {
+                    instruction.op = Opcode::Jcc;
+                } else {
+                    return false;
+                }
+            }
+
+            if (!operands.empty()) {
+                const size_t comma = operands.find(',');
+                if (!ParseOperand(operands.substr(0, comma), instruction.dst)) {
+                    return false;
+                }
+                if (comma != std::string_view::npos
+                    && (operands.find(',', comma + 1) != std::string_view::npos
+                        || !ParseOperand(operands.substr(comma + 1), instruction.src))) {
+                    return false;
+                }
+            }
+
+            // A memory operand takes its size from the register next to it
+            for (auto* memory : {&instruction.dst, &instruction.src}) {
+                if (IsMemory(*memory) && memory->size == 0) {
+                    const Operand& other = memory == &instruction.dst ? instruction.src : instruction.dst;
+                    if (IsReg(other) && instruction.op != Opcode::Movzx && instruction.op != Opcode::Movsx) {
+                        memory->size = other.size;
+                    } else if (instruction.op == Opcode::Lea || instruction.op == Opcode::Push
+                               || instruction.op == Opcode::Pop || instruction.op == Opcode::Jmp
+                               || instruction.op == Opcode::Call) {
+                        memory->size = 8;
+                    } else {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        class Encoder {
+        public:
+            explicit Encoder(EncodedModule& result) : result(result), text(result.text) {}
+
+            void EncodeData(const MachineModule& module) {
+                for (const auto& item : module.data) {
+                    if (item.alignment > 0) {
+                        while (result.data.size() % static_cast<size_t>(item.alignment) != 0) {
+                            result.data.push_back('\0');
+                        }
+                        result.dataAlignment = std::max<uint64_t>(result.dataAlignment, static_cast<uint64_t>(item.alignment));
+                    }
+                    Symbol& symbol = Define(item.name, Section::Data, result.data.size());
+                    symbol.size = item.size;
+
+                    // Read the value back from its NASM spelling so the object
+                    // holds exactly what nasm would assemble from the text
+                    int64_t intValue = item.intValue;
+                    double floatValue = 0;
+                    bool isFloat = false;
+                    if (item.isFloat) {
+                        const std::string spelling = nasm::FormatFloat(item.floatValue);
+                        isFloat = spelling.find_first_of(".eEni") != std::string::npos;
+                        if (isFloat) {
+                            floatValue = std::strtod(spelling.c_str(), nullptr);
+                        } else {
+                            intValue = std::strtoll(spelling.c_str(), nullptr, 10);
+                        }
+                    }
+
+                    char bytes[8];
+                    if (item.size == 4) {
+                        if (isFloat) {
+                            const auto value = static_cast<float>(floatValue);
+                            std::memcpy(bytes, &value, 4);
+                        } else {
+                            const auto value = static_cast<uint32_t>(intValue);
+                            std::memcpy(bytes, &value, 4);
+                        }
+                    } else if (isFloat) {
+                        std::memcpy(bytes, &floatValue, 8);
+                    } else {
+                        std::memcpy(bytes, &intValue, 8);
+                    }
+                    result.data.append(bytes, item.size);
+                }
+            }
+
+            void EncodeFunction(const MachineFunction& function) {
+                const size_t start = text.size();
+                Define(function.name, Section::Text, start);
+                labels.clear();
+                labelFixups.clear();
+
+                for (const auto& instruction : function.code) {
+                    Encode(instruction);
+                }
+
+                for (const auto& [position, key] : labelFixups) {
+                    const auto it = labels.find(key);
+                    if (it == labels.end()) {
+                        throw std::runtime_error("Undefined label " + std::string(key.first) + std::to_string(key.second)
+                                                 + " in " + std::string(function.name));
+                    }
+                    Patch32(position, static_cast<int64_t>(it->second) - static_cast<int64_t>(position + 4));
+                }
+                SymbolAt(Lookup(function.name)).size = text.size() - start;
+            }
+
+            // Branches to functions of this module are bound directly, the rest
+            // become relocations against undefined symbols
+            void ResolveBranches() {
+                for (const auto& [position, name] : branchFixups) {
+                    const uint32_t index = Lookup(name);
+                    const Symbol& target = result.symbols[index];
+                    if (target.section == Section::Text) {
+                        Patch32(position, static_cast<int64_t>(target.offset) - static_cast<int64_t>(position + 4));
+                    } else {
+                        result.relocations.push_back({position, index, RelocationType::PLT32, -4});
+                    }
+                }
+            }
+
+            void MarkGlobals(const MachineModule& module) {
+                for (const auto& name : module.globals) {
+                    SymbolAt(Lookup(name)).isGlobal = true;
+                }
+                // Anything still undefined has to come from another object
+                for (auto& symbol : result.symbols) {
+                    if (symbol.section == Section::Undefined) {
+                        symbol.isGlobal = true;
+                    }
+                }
+            }
+
+        private:
+            uint32_t Lookup(const std::string_view name) {
+                const auto [it, inserted] = symbolIndex.try_emplace(name, static_cast<uint32_t>(result.symbols.size()));
+                if (inserted) {
+                    result.symbols.push_back({name});
+                }
+                return it->second;
+            }
+
+            Symbol& SymbolAt(const uint32_t index) {
+                return result.symbols[index];
+            }
+
+            Symbol& Define(const std::string_view name, const Section section, const uint64_t offset) {
+                Symbol& symbol = SymbolAt(Lookup(name));
+                if (symbol.section != Section::Undefined) {
+                    throw std::runtime_error("Symbol defined more than once: " + std::string(name));
+                }
+                symbol.section = section;
+                symbol.offset = offset;
+                return symbol;
+            }
+
+            void Byte(const int value) {
+                text.push_back(static_cast<char>(value));
+            }
+
+            void Imm(const int64_t value, const size_t bytes) {
+                for (size_t i = 0; i < bytes; ++i) {
+                    Byte(static_cast<int>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+                }
+            }
+
+            void Patch32(const size_t position, const int64_t value) {
+                const auto bits = static_cast<uint32_t>(static_cast<int32_t>(value));
+                std::memcpy(&text[position], &bits, 4);
+            }
+
+            [[noreturn]] static void Unsupported(const Instruction& instruction) {
+                std::string line;
+                {
+                    OutputSink out(line, 256);
+                    nasm::PrintInstruction(out, instruction);
+                }
+                throw UnsupportedInstruction("Cannot encode instruction: " + std::string(Trim(line)));
+            }
+
+            // REX prefix, opcode and ModRM (+ SIB, displacement) for an
+            // instruction whose ModRM.reg field is reg (a register code or an
+            // opcode extension) and whose ModRM.rm operand is rm. byteReg is
+            // set when the reg field names an 8-bit register.
+            void EmitModRm(std::initializer_list<int> opcode, const int reg, const Operand& rm, const bool wide,
+                           const bool byteReg = false) {
+                int rex = wide ? 0x48 : 0;
+                if (reg >= 8) rex |= 0x44;
+                if ((IsReg(rm) || rm.kind == Operand::Kind::Mem) && Code(rm.reg) >= 8) rex |= 0x41;
+                // spl, bpl, sil and dil only exist with a REX prefix
+                if ((byteReg && reg >= 4 && reg < 8) || (IsReg(rm) && rm.size == 1 && Code(rm.reg) >= 4 && Code(rm.reg) < 8)) {
+                    rex |= 0x40;
+                }
+                if (rex) Byte(rex);
+                for (const int byte : opcode) Byte(byte);
+
+                const int regBits = (reg & 7) << 3;
+                if (IsReg(rm)) {
+                    Byte(0xC0 | regBits | (Code(rm.reg) & 7));
+                } else if (rm.kind == Operand::Kind::Global) {
+                    Byte(0x05 | regBits);
+                    pendingReloc = {text.size(), rm.name};
+                    Imm(0, 4);
+                } else {
+                    const int base = Code(rm.reg) & 7;
+                    const int64_t displacement = rm.value;
+                    int mod = 0x80;
+                    if (displacement == 0 && base != 5) {
+                        mod = 0x00;
+                    } else if (FitsInt8(displacement)) {
+                        mod = 0x40;
+                    }
+                    Byte(mod | regBits | base);
+                    if (base == 4) Byte(0x24);
+                    if (mod == 0x40) Imm(displacement, 1);
+                    if (mod == 0x80) Imm(displacement, 4);
+                }
+            }
+
+            // Completes a RIP-relative reference once the instruction length is known
+            void FinishInstruction() {
+                if (!pendingReloc.second.empty()) {
+                    const auto [position, name] = pendingReloc;
+                    result.relocations.push_back({position, Lookup(name), RelocationType::PC32,
+                                                  static_cast<int64_t>(position) - static_cast<int64_t>(text.size())});
+                    pendingReloc = {};
+                }
+            }
+
+            void BranchToLabel(const Operand& label) {
+                labelFixups.emplace_back(text.size(), std::make_pair(label.name, label.value));
+                Imm(0, 4);
+            }
+
+            void BranchToSymbol(const std::string_view name) {
+                branchFixups.emplace_back(text.size(), name);
+                Imm(0, 4);
+            }
+
+            void EncodeAlu(const Instruction& instruction, const int extension) {
+                const Operand& dst = instruction.dst;
+                const Operand& src = instruction.src;
+                const bool byte = dst.size == 1;
+                const bool wide = dst.size == 8;
+                const int base = extension << 3;
+                if (IsRm(dst) && IsReg(src) && src.size == dst.size) {
+                    EmitModRm({base | (byte ? 0 : 1)}, Code(src.reg), dst, wide, byte);
+                } else if (IsReg(dst) && IsMemory(src) && src.size == dst.size) {
+                    EmitModRm({base | (byte ? 2 : 3)}, Code(dst.reg), src, wide, byte);
+                } else if (IsRm(dst) && src.kind == Operand::Kind::Imm && FitsInt32(src.value)) {
+                    if (byte) {
+                        EmitModRm({0x80}, extension, dst, false);
+                        Imm(src.value, 1);
+                    } else if (FitsInt8(src.value)) {
+                        EmitModRm({0x83}, extension, dst, wide);
+                        Imm(src.value, 1);
+                    } else {
+                        EmitModRm({0x81}, extension, dst, wide);
+                        Imm(src.value, 4);
+                    }
+                } else {
+                    Unsupported(instruction);
+                }
+            }
+
+            void EncodeUnary(const Instruction& instruction, const int extension) {
+                const Operand& dst = instruction.dst;
+                if (!IsRm(dst) || instruction.src.kind != Operand::Kind::None) {
+                    Unsupported(instruction);
+                }
+                EmitModRm({dst.size == 1 ? 0xF6 : 0xF7}, extension, dst, dst.size == 8);
+            }
+
+            void EncodeMov(const Instruction& instruction) {
+                const Operand& dst = instruction.dst;
+                const Operand& src = instruction.src;
+                const bool byte = dst.size == 1;
+                const bool wide = dst.size == 8;
+                if (dst.size == 2) {
+                    // 16-bit operands only come from stores the code generator emits
+                    if (!IsReg(src) || src.size != 2 || !IsRm(dst)) {
+                        Unsupported(instruction);
+                    }
+                    Byte(0x66);
+                    EmitModRm({0x89}, Code(src.reg), dst, false);
+                } else if (IsRm(dst) && IsReg(src) && src.size == dst.size) {
+                    EmitModRm({byte ? 0x88 : 0x89}, Code(src.reg), dst, wide, byte);
+                } else if (IsReg(dst) && IsMemory(src) && src.size == dst.size) {
+                    EmitModRm({byte ? 0x8A : 0x8B}, Code(dst.reg), src, wide, byte);
+                } else if (IsReg(dst) && src.kind == Operand::Kind::Imm) {
+                    const int reg = Code(dst.reg);
+                    const int64_t value = src.value;
+                    if (byte) {
+                        if (reg >= 4) Byte(reg >= 8 ? 0x41 : 0x40);
+                        Byte(0xB0 | (reg & 7));
+                        Imm(value, 1);
+                    } else if (!wide || (value >= 0 && value <= UINT32_MAX)) {
+                        // A 32-bit move zero-extends, which is also what nasm picks
+                        if (reg >= 8) Byte(0x41);
+                        Byte(0xB8 | (reg & 7));
+                        Imm(value, 4);
+                    } else if (FitsInt32(value)) {
+                        EmitModRm({0xC7}, 0, dst, true);
+                        Imm(value, 4);
+                    } else {
+                        Byte(reg >= 8 ? 0x49 : 0x48);
+                        Byte(0xB8 | (reg & 7));
+                        Imm(value, 8);
+                    }
+                } else if (IsMemory(dst) && src.kind == Operand::Kind::Imm && FitsInt32(src.value)) {
+                    EmitModRm({byte ? 0xC6 : 0xC7}, 0, dst, wide);
+                    Imm(src.value, byte ? 1 : 4);
+                } else {
+                    Unsupported(instruction);
+                }
+            }
+
+            void Encode(const Instruction& instruction) {
+                const Operand& dst = instruction.dst;
+                const Operand& src = instruction.src;
+                const int cc = static_cast<int>(instruction.cond) & 0xF;
+
+                switch (instruction.op) {
+                    case Opcode::Label: {
+                        const auto [it, inserted] = labels.try_emplace({dst.name, dst.value}, text.size());
+                        if (!inserted) {
+                            throw std::runtime_error("Label defined twice: " + std::string(dst.name) + std::to_string(dst.value));
+                        }
+                        return;
+                    }
+                    case Opcode::Raw:
+                        EncodeRaw(dst.name);
+                        return;
+                    case Opcode::Mov:
+                        EncodeMov(instruction);
+                        break;
+                    case Opcode::Movzx:
+                        if (!IsReg(dst) || dst.size < 4 || !IsRm(src) || src.size > 2) {
+                            Unsupported(instruction);
+                        }
+                        EmitModRm({0x0F, src.size == 1 ? 0xB6 : 0xB7}, Code(dst.reg), src, dst.size == 8, false);
+                        break;
+                    case Opcode::Movsx:
+                        if (!IsReg(dst) || dst.size < 4 || !IsRm(src) || src.size >= dst.size) {
+                            Unsupported(instruction);
+                        }
+                        if (src.size == 4) {
+                            EmitModRm({0x63}, Code(dst.reg), src, true);
+                        } else {
+                            EmitModRm({0x0F, src.size == 1 ? 0xBE : 0xBF}, Code(dst.reg), src, dst.size == 8);
+                        }
+                        break;
+                    case Opcode::Lea:
+                        if (!IsReg(dst) || dst.size == 1 || !IsMemory(src)) {
+                            Unsupported(instruction);
+                        }
+                        EmitModRm({0x8D}, Code(dst.reg), src, dst.size == 8);
+                        break;
+                    case Opcode::Push:
+                    case Opcode::Pop: {
+                        const bool push = instruction.op == Opcode::Push;
+                        if (IsReg(dst) && dst.size == 8) {
+                            if (Code(dst.reg) >= 8) Byte(0x41);
+                            Byte((push ? 0x50 : 0x58) | (Code(dst.reg) & 7));
+                        } else if (IsMemory(dst) && dst.size == 8) {
+                            EmitModRm({push ? 0xFF : 0x8F}, push ? 6 : 0, dst, false);
+                        } else if (push && dst.kind == Operand::Kind::Imm && FitsInt32(dst.value)) {
+                            Byte(FitsInt8(dst.value) ? 0x6A : 0x68);
+                            Imm(dst.value, FitsInt8(dst.value) ? 1 : 4);
+                        } else {
+                            Unsupported(instruction);
+                        }
+                        break;
+                    }
+                    case Opcode::Add: EncodeAlu(instruction, 0); break;
+                    case Opcode::Or: EncodeAlu(instruction, 1); break;
+                    case Opcode::And: EncodeAlu(instruction, 4); break;
+                    case Opcode::Sub: EncodeAlu(instruction, 5); break;
+                    case Opcode::Xor: EncodeAlu(instruction, 6); break;
+                    case Opcode::Cmp: EncodeAlu(instruction, 7); break;
+                    case Opcode::Test:
+                        if (IsRm(dst) && IsReg(src) && src.size == dst.size) {
+                            EmitModRm({dst.size == 1 ? 0x84 : 0x85}, Code(src.reg), dst, dst.size == 8, dst.size == 1);
+                        } else if (IsRm(dst) && src.kind == Operand::Kind::Imm && FitsInt32(src.value)) {
+                            EmitModRm({dst.size == 1 ? 0xF6 : 0xF7}, 0, dst, dst.size == 8);
+                            Imm(src.value, dst.size == 1 ? 1 : 4);
+                        } else {
+                            Unsupported(instruction);
+                        }
+                        break;
+                    case Opcode::Imul:
+                        if (IsReg(dst) && dst.size != 1 && IsRm(src) && src.size == dst.size) {
+                            EmitModRm({0x0F, 0xAF}, Code(dst.reg), src, dst.size == 8);
+                        } else if (IsReg(dst) && dst.size != 1 && src.kind == Operand::Kind::Imm && FitsInt32(src.value)) {
+                            EmitModRm({FitsInt8(src.value) ? 0x6B : 0x69}, Code(dst.reg), dst, dst.size == 8);
+                            Imm(src.value, FitsInt8(src.value) ? 1 : 4);
+                        } else {
+                            Unsupported(instruction);
+                        }
+                        break;
+                    case Opcode::Neg: EncodeUnary(instruction, 3); break;
+                    case Opcode::Not: EncodeUnary(instruction, 2); break;
+                    case Opcode::Idiv: EncodeUnary(instruction, 7); break;
+                    case Opcode::Div: EncodeUnary(instruction, 6); break;
+                    case Opcode::Cqo:
+                        Byte(0x48);
+                        Byte(0x99);
+                        break;
+                    case Opcode::Cdq: Byte(0x99); break;
+                    case Opcode::Set:
+                        if (!IsRm(dst) || dst.size != 1) {
+                            Unsupported(instruction);
+                        }
+                        EmitModRm({0x0F, 0x90 | cc}, 0, dst, false);
+                        break;
+                    case Opcode::Jmp:
+                    case Opcode::Call: {
+                        const bool call = instruction.op == Opcode::Call;
+                        if (dst.kind == Operand::Kind::Label && !call) {
+                            Byte(0xE9);
+                            BranchToLabel(dst);
+                        } else if (dst.kind == Operand::Kind::Symbol) {
+                            Byte(call ? 0xE8 : 0xE9);
+                            BranchToSymbol(dst.name);
+                        } else if (IsRm(dst) && dst.size == 8) {
+                            EmitModRm({0xFF}, call ? 2 : 4, dst, false);
+                        } else {
+                            Unsupported(instruction);
+                        }
+                        break;
+                    }
+                    case Opcode::Jcc:
+                        Byte(0x0F);
+                        Byte(0x80 | cc);
+                        if (dst.kind == Operand::Kind::Label) {
+                            BranchToLabel(dst);
+                        } else if (dst.kind == Operand::Kind::Symbol) {
+                            BranchToSymbol(dst.name);
+                        } else {
+                            Unsupported(instruction);
+                        }
+                        break;
+                    case Opcode::Leave: Byte(0xC9); break;
+                    case Opcode::Ret: Byte(0xC3); break;
+                    case Opcode::Syscall: Byte(0x0F); Byte(0x05); break;
+                    case Opcode::Nop: Byte(0x90); break;
+                }
+                FinishInstruction();
+            }
+
+            void EncodeRaw(const std::string_view line) {
+                const std::string_view trimmed = Trim(line);
+                for (const auto& [mnemonic, bytes] : FIXED_ENCODINGS) {
+                    if (trimmed == mnemonic) {
+                        text.append(bytes);
+                        return;
+                    }
+                }
+                Instruction parsed;
+                if (!ParseInstruction(trimmed, parsed)) {
+                    throw UnsupportedInstruction("Cannot encode inline assembly: " + std::string(trimmed));
+                }
+                Encode(parsed);
+            }
+
+            using LabelKey = std::pair<std::string_view, int64_t>;
+
+            EncodedModule& result;
+            std::string& text;
+            std::unordered_map<std::string_view, uint32_t> symbolIndex;
+            std::map<LabelKey, size_t> labels;
+            std::vector<std::pair<size_t, LabelKey>> labelFixups;
+            std::vector<std::pair<size_t, std::string_view>> branchFixups;
+            std::pair<size_t, std::string_view> pendingReloc;
+        };
+    }
+
+    EncodedModule Encode(const MachineModule& module) {
+        EncodedModule result;
+        Encoder encoder(result);
+        encoder.EncodeData(module);
+        for (const auto& function : module.functions) {
+            encoder.EncodeFunction(function);
+        }
+        encoder.ResolveBranches();
+        encoder.MarkGlobals(module);
+        return result;
+    }
+
+} // namespace x86
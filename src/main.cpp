@@ -1,83 +1,568 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include "Lexer.h"
-#include "Parser.h"
-#include "CodeGenerator.h"
+#include <memory>
+#include <unordered_map>
+#include <fmt/format.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AllocationCounter.h"
 #include "ArgParser.h"
+#include "CompileCache.h"
+#include "CompileServer.h"
+#include "Compiler.h"
+#include "FileWatcher.h"
 #include "Logger.h"
+#include "ModuleInterface.h"
+#include "OutputSink.h"
+#include "Profiler.h"
+#include "SourceFile.h"
+#include "ThreadPool.h"
 #include "Version.h"
 
-std::mutex g_output_mutex;
+namespace {
+    // Everything one input produces. Jobs run on worker threads and only fill
+    // these in; main reports them afterwards in command-line order so the
+    // diagnostics do not depend on scheduling.
+    struct CompileJob {
+        std::string inputFile;
+        std::string outputFile;
+        apx::CompileResult result;
+        // Only for --stats and when compiled in process (not cached or remote)
+        apx::CompileStatistics statistics;
+        bool hasStatistics = false;
+    };
+
+    // Where Compile sends work: in process, or to a compile server when
+    // serverSocket is set
+    struct Backend {
+        APXC_OPERATION operation;
+        APXC_OUTPUT_FORMAT format;
+        ThreadPool* codegenPool;
+        const std::string* serverSocket;
+        const CompileCache* cache;
+        bool collectStatistics;
+        const std::vector<std::string>* importPaths;
+        // --emit-interface
+        bool emitInterface;
+    };
+
+    // Empty for a bare file name
+    std::string DirectoryOf(const std::string& path) {
+        const size_t slash = path.rfind('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash);
+    }
+
+    // The module name a source file is imported by: its file name without
+    // the extension
+    std::string ModuleNameOf(const std::string& path) {
+        const size_t slash = path.rfind('/');
+        const size_t start = slash == std::string::npos ? 0 : slash + 1;
+        const size_t dot = path.rfind('.');
+        return path.substr(start, dot == std::string::npos || dot < start ? std::string::npos : dot - start);
+    }
+
+    // The interface goes next to the output, where importers compiled to the
+    // same directory find it
+    std::string InterfacePathOf(const CompileJob& job) {
+        const std::string directory = DirectoryOf(job.outputFile);
+        return (directory.empty() ? std::string() : directory + "/") + ModuleNameOf(job.inputFile) + ".apxi";
+    }
+
+    // Identifies this apxc build for the output cache: a rebuilt compiler
+    // must not reuse entries written by the previous one. Code generation
+    // lives in libapx, which can be rebuilt or updated on its own.
+    std::string CompilerIdentity() {
+        std::string identity = std::string(APXC_VERSION) + ":" + apx::BuildIdentity();
+        struct stat st{};
+        if (::stat("/proc/self/exe", &st) == 0) {
+            identity += ":" + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtim.tv_sec) + "."
+                + std::to_string(st.st_mtim.tv_nsec);
+        }
+        return identity;
+    }
+
+    // Imported modules are looked for next to the input, next to the output,
+    // then in the -I directories
+    std::vector<std::string> SearchPathOf(const CompileJob& job, const Backend& backend) {
+        std::vector<std::string> searchPath{DirectoryOf(job.inputFile), DirectoryOf(job.outputFile)};
+        searchPath.insert(searchPath.end(), backend.importPaths->begin(), backend.importPaths->end());
+        return searchPath;
+    }
+
+    // Leaves the file and its timestamp alone when it already holds contents,
+    // so build tools do not redo the steps that depend on it
+    bool WriteFileIfChanged(const std::string& path, const std::string& contents) {
+        FileOutput file(path);
+        return file.Write(contents) && file.Finish();
+    }
+
+    // Compiles with the output written to the job's output file as it is
+    // generated, for when nothing else needs it in memory
+    void CompileToFile(CompileJob& job, const std::string_view source, apx::CompileOptions options) {
+        FileOutput file(job.outputFile);
+        bool written;
+        {
+            OutputSink sink([&file](const std::string_view buffered, const std::string_view text) {
+                return file.Write(buffered, text);
+            });
+            options.output = &sink;
+            job.result = apx::Compile(source, options);
+            written = sink.Flush();
+        }
+        if (!job.result.success) {
+            file.Abandon();
+            return;
+        }
+        PROFILE_SCOPE(profile::PHASE, "write");
+        if (!written || !file.Finish()) {
+            file.Abandon();
+            job.result.success = false;
+            job.result.diagnostics.push_back({"Could not write output file: " + job.outputFile});
+        }
+    }
+
+    // A module that stopped exporting anything loses its old interface, so
+    // importers fail instead of linking against symbols that are gone.
+    // Outputs such as /dev/stdout have no directory of their own to put the
+    // interface in.
+    void WriteInterface(CompileJob& job) {
+        const std::string path = InterfacePathOf(job);
+        struct stat st{};
+        if (::stat(job.outputFile.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            job.result.success = false;
+            job.result.diagnostics.push_back({"--emit-interface needs a regular output file, not: " + job.outputFile});
+        } else if (job.result.interface.empty()) {
+            ::unlink(path.c_str());
+        } else if (!WriteFileIfChanged(path, job.result.interface)) {
+            job.result.success = false;
+            job.result.diagnostics.push_back({"Could not write module interface: " + path});
+        }
+    }
+
+    void PrintStatistics(const CompileJob& job) {
+        const apx::CompileStatistics& stats = job.statistics;
+        size_t nodes = 0;
+        for (const size_t count : stats.nodes) {
+            nodes += count;
+        }
+        fmt::print(stderr, "{}:\n", job.inputFile);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "source bytes", stats.sourceBytes);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "tokens lexed", stats.tokens);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "AST nodes", nodes);
+        for (size_t kind = 0; kind < stats.nodes.size(); ++kind) {
+            if (stats.nodes[kind] != 0) {
+                fmt::print(stderr, "    {:<30} {:>12}\n", NodeKindName(static_cast<NodeKind>(kind)), stats.nodes[kind]);
+            }
+        }
+        fmt::print(stderr, "  {:<32} {:>12}\n", "AST bytes used", stats.astBytesUsed);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "AST bytes reserved", stats.astBytesReserved);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "interned strings", stats.internedStrings);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "functions", stats.functions);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "global symbols", stats.globalSymbols);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "peak local symbols", stats.peakLocalSymbols);
+        fmt::print(stderr, "  {:<32} {:>12}\n", "output bytes", stats.outputBytes);
+    }
+
+    // Whole-process figures, so they cover every input and the driver itself
+    void PrintProcessStatistics() {
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        fmt::print(stderr, "process:\n");
+        fmt::print(stderr, "  {:<32} {:>12}\n", "peak RSS (KiB)", usage.ru_maxrss);
+        if (memory::IsCountingAllocations()) {
+            const memory::AllocationCounts counts = memory::GetAllocationCounts();
+            fmt::print(stderr, "  {:<32} {:>12}\n", "heap allocations", counts.allocations);
+            fmt::print(stderr, "  {:<32} {:>12}\n", "heap bytes allocated", counts.bytes);
+        } else {
+            fmt::print(stderr, "  {:<32} {}\n", "heap allocations", "not counted (build with APX_COUNT_ALLOCATIONS)");
+        }
+    }
+
+    void Compile(CompileJob& job, const Backend& backend) {
+        const APXC_OPERATION operation = backend.operation;
+        SourceFile source;
+        bool opened;
+        {
+            PROFILE_SCOPE(profile::PHASE, "read");
+            opened = source.Open(job.inputFile);
+        }
+        if (!opened) {
+            job.result.diagnostics.push_back({"Could not open input file: " + job.inputFile});
+            return;
+        }
+
+        ModuleLoader modules(SearchPathOf(job, backend));
+
+        std::string cacheKey;
+        bool cached = false;
+        if (backend.cache) {
+            cacheKey = backend.cache->Key(source.GetContents(), operation, backend.format, backend.emitInterface);
+            cached = backend.cache->Load(cacheKey, modules, job.result.output, job.result.interface);
+            job.result.success = cached;
+        }
+
+        if (!cached) {
+            if (backend.serverSocket) {
+                CompileClient client;
+                if (!client.Connect(*backend.serverSocket)) {
+                    job.result.diagnostics.push_back({"Could not connect to compile server at " + *backend.serverSocket});
+                    return;
+                }
+                if (!client.Compile(source.GetContents(), operation, backend.format, job.result)) {
+                    job.result = {};
+                    job.result.diagnostics.push_back({"Compile server closed the connection"});
+                    return;
+                }
+            } else {
+                apx::CompileStatistics* statistics = backend.collectStatistics ? &job.statistics : nullptr;
+                apx::CompileOptions options{operation, backend.format, backend.codegenPool, statistics};
+                options.modules = &modules;
+                options.emitInterface = backend.emitInterface;
+                job.hasStatistics = statistics != nullptr;
+                if (!backend.cache && operation != APXC_OPERATION::APXC_PREPROCESS) {
+                    CompileToFile(job, source.GetContents(), options);
+                    if (job.result.success && backend.emitInterface) {
+                        WriteInterface(job);
+                    }
+                    return;
+                }
+                job.result = apx::Compile(source.GetContents(), options);
+            }
+            if (job.result.success && backend.cache) {
+                backend.cache->Store(cacheKey, modules.GetDependencies(), job.result.output, job.result.interface);
+            }
+        }
+        if (!job.result.success || operation == APXC_OPERATION::APXC_PREPROCESS) {
+            return;
+        }
+
+        PROFILE_SCOPE(profile::PHASE, "write");
+        if (!WriteFileIfChanged(job.outputFile, job.result.output)) {
+            job.result.success = false;
+            job.result.diagnostics.push_back({"Could not write output file: " + job.outputFile});
+            return;
+        }
+        if (backend.emitInterface) {
+            WriteInterface(job);
+        }
+    }
+
+    // Splits a batch into waves that can each be compiled in parallel: a file
+    // comes after every other input of the batch it imports, so it reads the
+    // interface compiled in this run. Files left over are in an import cycle
+    // or import one; they get a diagnostic and are not compiled.
+    //
+    // importers, when given, receives for each file the files that import it.
+    std::vector<std::vector<size_t>> OrderByImports(std::vector<CompileJob>& jobs,
+                                                    std::vector<std::vector<size_t>>* importersOut = nullptr) {
+        std::unordered_map<std::string, size_t> jobOfModule;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            jobOfModule.emplace(ModuleNameOf(jobs[i].inputFile), i);
+        }
+        std::vector<std::vector<size_t>> importers(jobs.size());
+        std::vector<size_t> pending(jobs.size(), 0);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            SourceFile source;
+            if (!source.Open(jobs[i].inputFile)) {
+                continue; // Compile reports it
+            }
+            std::vector<size_t> imported;
+            for (const auto& name : apxi::ScanImports(source.GetContents())) {
+                const auto it = jobOfModule.find(name);
+                if (it != jobOfModule.end() && it->second != i
+                    && std::find(imported.begin(), imported.end(), it->second) == imported.end()) {
+                    imported.push_back(it->second);
+                    importers[it->second].push_back(i);
+                    ++pending[i];
+                }
+            }
+        }
+
+        std::vector<std::vector<size_t>> waves;
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (pending[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+        size_t scheduled = 0;
+        while (!ready.empty()) {
+            std::vector<size_t> next;
+            for (const size_t i : ready) {
+                for (const size_t importer : importers[i]) {
+                    if (--pending[importer] == 0) {
+                        next.push_back(importer);
+                    }
+                }
+            }
+            scheduled += ready.size();
+            waves.push_back(std::move(ready));
+            ready = std::move(next);
+        }
+        if (scheduled < jobs.size()) {
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                if (pending[i] != 0) {
+                    jobs[i].result.diagnostics.push_back({"Not compiled: its imports lead into an import cycle between the inputs"});
+                }
+            }
+        }
+        if (importersOut) {
+            *importersOut = std::move(importers);
+        }
+        return waves;
+    }
+
+    // One compile of apxc --watch: reports at once, since there is no end of
+    // the run to report at
+    void Recompile(CompileJob& job, apx::IncrementalCompiler& compiler, const Backend& backend) {
+        const auto start = std::chrono::steady_clock::now();
+        job.result = {};
+        SourceFile source;
+        if (!source.Open(job.inputFile)) {
+            job.result.diagnostics.push_back({"Could not open input file: " + job.inputFile});
+        } else {
+            ModuleLoader modules(SearchPathOf(job, backend));
+            job.result = compiler.Compile(source.GetContents(), &modules);
+        }
+        if (job.result.success) {
+            if (!WriteFileIfChanged(job.outputFile, job.result.output)) {
+                job.result.success = false;
+                job.result.diagnostics.push_back({"Could not write output file: " + job.outputFile});
+            } else if (backend.emitInterface) {
+                WriteInterface(job);
+            }
+        }
+        if (!job.result.success) {
+            for (const auto& diagnostic : job.result.diagnostics) {
+                ErrorReporter::Print(diagnostic, job.inputFile);
+            }
+            return;
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        out::success("Compiled: {} from: {} in {:.1f} ms ({} of {} functions generated)", job.outputFile,
+                     job.inputFile, elapsed.count(), compiler.GetGeneratedCount(),
+                     compiler.GetGeneratedCount() + compiler.GetReusedCount());
+    }
+
+    // Prints and writes what --time-report and --trace asked for
+    bool ReportProfile(const bool timeReport, const std::string& traceFile) {
+        if (timeReport) {
+            profile::PrintReport();
+        }
+        if (!traceFile.empty() && !profile::WriteTrace(traceFile)) {
+            out::error("Could not write trace file: {}", traceFile);
+            return false;
+        }
+        return true;
+    }
+
+    // apxc --watch: compiles every input, then whenever inputs are saved
+    // recompiles them, and the inputs importing a module whose interface
+    // that changed. Only stops on an error from the watcher. Profiles cover
+    // one round each, so the trace file always holds the latest.
+    int Watch(std::vector<CompileJob>& jobs, const Backend& backend, const bool timeReport,
+              const std::string& traceFile) {
+        FileWatcher watcher;
+        for (const auto& job : jobs) {
+            if (!watcher.Add(job.inputFile)) {
+                out::error("Could not watch input file: {}", job.inputFile);
+                return 1;
+            }
+        }
+        apx::CompileOptions options{backend.operation, backend.format, backend.codegenPool};
+        // Importers are only recompiled when there are interfaces on disk for
+        // them to read
+        options.emitInterface = backend.emitInterface;
+        std::vector<std::unique_ptr<apx::IncrementalCompiler>> compilers;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            compilers.push_back(std::make_unique<apx::IncrementalCompiler>(options));
+        }
+
+        std::vector<bool> dirty(jobs.size(), true);
+        std::vector<std::string> interfaces(jobs.size());
+        for (;;) {
+            // Imports may have been edited too, so the order is found again
+            for (auto& job : jobs) {
+                job.result = {};
+            }
+            std::vector<std::vector<size_t>> importers;
+            const std::vector<std::vector<size_t>> waves = OrderByImports(jobs, &importers);
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                if (dirty[i]) {
+                    for (const auto& diagnostic : jobs[i].result.diagnostics) {
+                        ErrorReporter::Print(diagnostic, jobs[i].inputFile);
+                    }
+                }
+            }
+            for (const auto& wave : waves) {
+                for (const size_t i : wave) {
+                    if (!dirty[i]) {
+                        continue;
+                    }
+                    Recompile(jobs[i], *compilers[i], backend);
+                    if (jobs[i].result.success && jobs[i].result.interface != interfaces[i]) {
+                        interfaces[i] = std::move(jobs[i].result.interface);
+                        for (const size_t importer : importers[i]) {
+                            dirty[importer] = true;
+                        }
+                    }
+                }
+            }
+            ReportProfile(timeReport, traceFile);
+            profile::Reset();
+            // The process runs until interrupted, so redirected output must
+            // not sit in stdio buffers
+            out::flush();
+            std::fflush(nullptr);
+
+            std::fill(dirty.begin(), dirty.end(), false);
+            const std::vector<size_t> changed = watcher.Wait();
+            if (changed.empty()) {
+                out::error("Waiting for changes to the input files failed");
+                return 1;
+            }
+            for (const size_t i : changed) {
+                dirty[i] = true;
+            }
+        }
+    }
+}
 
 int main(int argc, char **argv) {
     ArgParser arg_parser(argc, argv);
-    auto [operation,
-        inputFile,
-        outputFile,
-        showHelp,
-        hasError,
-        showVersion,
-        errorMessage
-    ] = arg_parser.Parse();
-
-    if (showHelp) {
+    const CompileConfiguration config = arg_parser.Parse();
+
+    if (config.showHelp) {
         ArgParser::PrintUsage(argv[0]);
         return 0;
     }
 
-    if (showVersion) {
+    if (config.showVersion) {
         out::info(APXC_VERSION);
         return 0;
     }
 
-    if (hasError) {
-        out::error(errorMessage);
+    if (config.hasError) {
+        out::error(config.errorMessage);
         ArgParser::PrintUsage(argv[0]);
         return 1;
     }
 
-    std::ifstream file(inputFile);
-    if (!file.is_open()) {
-        out::error("Could not open input file: {}", inputFile);
+    if (config.timeReport || !config.traceFile.empty()) {
+#ifdef PROFILE_DISABLE
+        out::error("--time-report and --trace need a build without PROFILE_DISABLE");
         return 1;
+#else
+        profile::Enable();
+#endif
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string code = buffer.str();
-
-    Lexer lexer(code);
-    ErrorReporter errorReporter;
-    Parser parser(lexer, errorReporter);
-    auto program = parser.ParseProgram();
+    const std::string socketPath = config.socketPath.empty() ? DefaultServerSocketPath() : config.socketPath;
+    if (config.server) {
+        CompileServer server(socketPath);
+        return server.Run();
+    }
 
-    if (errorReporter.HasErrors()) {
-        errorReporter.PrintErrors();
-        return 1;
+    if (config.run || config.interpret) {
+        SourceFile source;
+        if (!source.Open(config.inputFiles[0])) {
+            out::error("Could not open input file: {}", config.inputFiles[0]);
+            return 1;
+        }
+        int exitCode = 0;
+        const apx::CompileResult result = config.run ? apx::Run(source.GetContents(), exitCode)
+                                                     : apx::Interpret(source.GetContents(), exitCode);
+        for (const auto& diagnostic : result.diagnostics) {
+            if (result.success) {
+                out::warn("{}", diagnostic.message);
+            } else {
+                ErrorReporter::Print(diagnostic);
+            }
+        }
+        if (config.stats) {
+            PrintProcessStatistics();
+        }
+        return result.success ? exitCode : 1;
     }
 
-    if (operation == APXC_OPERATION::APXC_PREPROCESS) {
-        std::cout << program->ToString() << std::endl;
-        return 0;
+    const char* defaultExtension = config.format == APXC_OUTPUT_FORMAT::APXC_OBJECT ? ".o" : ".asm";
+    std::vector<CompileJob> jobs(config.inputFiles.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].inputFile = config.inputFiles[i];
+        jobs[i].outputFile = config.outputFiles.empty() ? config.inputFiles[i] + defaultExtension : config.outputFiles[i];
     }
 
-    CodeGenerator generator;
-    std::string assembly = generator.Generate(*program, operation);
+    std::unique_ptr<CompileCache> cache;
+    if (!config.cacheDir.empty()) {
+        cache = std::make_unique<CompileCache>(config.cacheDir, CompilerIdentity());
+    }
+    const std::string* serverSocket = config.connect ? &socketPath : nullptr;
 
-    if (outputFile.empty()) {
-        outputFile = inputFile + ".asm";
+    // A single file spends the workers on its items and functions, a batch on
+    // its files
+    const unsigned threads = config.jobs == 0 ? std::max(1u, std::thread::hardware_concurrency()) : config.jobs;
+    if (config.watch) {
+        // Saves usually touch one file, so its own items and functions get
+        // the workers
+        std::unique_ptr<ThreadPool> pool;
+        if (threads > 1) {
+            pool = std::make_unique<ThreadPool>(threads);
+        }
+        return Watch(jobs, {config.operation, config.format, pool.get(), nullptr, nullptr, false, &config.importPaths,
+                            config.emitInterface},
+                     config.timeReport, config.traceFile);
+    }
+    if (jobs.size() == 1) {
+        std::unique_ptr<ThreadPool> pool;
+        if (threads > 1) {
+            pool = std::make_unique<ThreadPool>(threads);
+        }
+        Compile(jobs[0], {config.operation, config.format, pool.get(), serverSocket, cache.get(), config.stats,
+                          &config.importPaths, config.emitInterface});
+    } else {
+        ThreadPool pool(static_cast<unsigned>(std::min<size_t>(threads, jobs.size())));
+        const Backend backend{config.operation, config.format, nullptr, serverSocket, cache.get(), config.stats,
+                              &config.importPaths, config.emitInterface};
+        if (config.operation == APXC_OPERATION::APXC_PREPROCESS) {
+            pool.ParallelFor(jobs.size(), [&](const size_t i) { Compile(jobs[i], backend); });
+        } else {
+            for (const auto& wave : OrderByImports(jobs)) {
+                pool.ParallelFor(wave.size(), [&](const size_t i) { Compile(jobs[wave[i]], backend); });
+            }
+        }
     }
 
-    std::ofstream outFile(outputFile);
-    if (!outFile.is_open()) {
-        out::error("Could not open output file: {}", outputFile);
-        return 1;
+    // Diagnostics name the file only when there is more than one to tell apart
+    const bool batch = jobs.size() > 1;
+    int status = 0;
+    for (const auto& job : jobs) {
+        if (!job.result.success) {
+            for (const auto& diagnostic : job.result.diagnostics) {
+                ErrorReporter::Print(diagnostic, batch ? job.inputFile : std::string_view());
+            }
+            status = 1;
+        } else if (config.operation == APXC_OPERATION::APXC_PREPROCESS) {
+            out::flush(); // Keep the output in order with the diagnostics
+            std::cout << job.result.output << std::endl;
+        } else {
+            out::success("Compiled: {} from: {}", job.outputFile, job.inputFile);
+        }
     }
 
-    outFile << assembly;
-    out::success("Compiled: {} from: {}", outputFile, inputFile);
+    if (config.stats) {
+        for (const auto& job : jobs) {
+            if (job.hasStatistics) {
+                PrintStatistics(job);
+            }
+        }
+        PrintProcessStatistics();
+    }
+    if (!ReportProfile(config.timeReport, config.traceFile)) {
+        status = 1;
+    }
 
-    return 0;
+    return status;
 }
-